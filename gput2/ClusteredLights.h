@@ -0,0 +1,327 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "UniformBlocks.h"
+
+// Point light of the clustered lists, attenuated like the one of the Point Light menu
+struct FClusteredLight
+{
+	glm::vec3 Position;
+	glm::vec3 Ambient;
+	glm::vec3 Diffuse;
+	glm::vec3 Specular;
+	float Constant;
+	float Linear;
+	float Quadratic;
+};
+
+// Light indices are 16 bits in the froxel lists
+const int ClusteredLightsMax = 65535;
+
+// Clustered forward shading of many point lights. The view frustum is split in froxels, screen tiles by depth slices
+// growing exponentially away from the camera, and each light is listed in the froxels its range touches. The lists are
+// made on worker threads started right after the camera moves and joined before the draw, a slice per worker at a time.
+// Terrain.frag finds the froxel of its fragment and only runs the lights listed there. Lights, froxel ranges and light
+// indices are texture buffers, bound to three units in a row.
+class GClusteredLights
+{
+public:
+	GClusteredLights(int TilesX, int TilesY, int Slices);
+
+	// Starts listing the lights, which can't change until Finish
+	void Start(const glm::mat4 &Projection, const glm::mat4 &View, float NearPlane, float FarPlane, int Width, int Height);
+	// Waits for the lists and sends them with the lights
+	void Finish();
+
+	// UClusters of the last lists
+	const FClustersBlock &GetBlock() const;
+	// Lights, froxel ranges and indices on Unit, Unit + 1 and Unit + 2
+	void Bind(int Unit) const;
+	// The four texels of every light, also read as instance attributes by the deferred light volumes
+	unsigned int GetLightsBuffer() const;
+	void Delete();
+
+public:
+	// At most ClusteredLightsMax
+	std::vector<FClusteredLight> Lights;
+	// Intensity at which a light is cut off, its range ends there
+	float Cutoff;
+	// Whether Start lists the lights per froxel, without it only the lights are sent
+	bool bBinning;
+
+	// Last lists
+	int IndicesCount;
+	int MaxLightsPerCluster;
+	float BinMilliseconds;
+
+private:
+	// Lists the lights of every froxel of a slice
+	void Bin(int Slice);
+
+	int TilesX;
+	int TilesY;
+	int Slices;
+
+	// View space bounds of the froxels, separable since the tiles split the frustum in rows and columns. Per slice, the
+	// depths (positive) and the x bounds of each column and y bounds of each row over those depths.
+	std::vector<glm::vec2> SliceDepths;
+	std::vector<glm::vec2> ColumnBounds;
+	std::vector<glm::vec2> RowBounds;
+
+	// View space lights, center and range
+	std::vector<glm::vec4> Spheres;
+	// Lights sent as four texels: position and range, then ambient, diffuse and specular with the attenuation factors
+	std::vector<glm::vec4> Texels;
+
+	// Each slice lists its froxels on its own, offsets into its indices until Finish joins them
+	std::vector<std::vector<uint16_t>> SliceIndices;
+	std::vector<unsigned int> Ranges;
+
+	std::vector<std::thread> Workers;
+	std::chrono::high_resolution_clock::time_point StartTime;
+	// Between Start and Finish, and whether that Start is listing
+	bool bStarted;
+	bool bBinned;
+
+	FClustersBlock Block;
+	unsigned int Buffers[3];
+	unsigned int Textures[3];
+};
+
+__forceinline GClusteredLights::GClusteredLights(int InTilesX, int InTilesY, int InSlices) : Cutoff(1.f / 256.f), bBinning(true), IndicesCount(0), MaxLightsPerCluster(0),
+	BinMilliseconds(0.f), TilesX(InTilesX), TilesY(InTilesY), Slices(InSlices), SliceIndices(InSlices), Ranges(2 * InTilesX * InTilesY * InSlices, 0),
+	bStarted(false), bBinned(false)
+{
+	Block.Grid = glm::ivec4(TilesX, TilesY, Slices, 0);
+	Block.Mapping = glm::vec4(0.f);
+
+	// Empty lists until the first Finish
+	const GLenum Formats[] = { GL_RGBA32F, GL_RG32UI, GL_R16UI };
+	glGenBuffers(3, Buffers);
+	glGenTextures(3, Textures);
+	for (int i = 0; i < 3; ++i)
+	{
+		glBindBuffer(GL_TEXTURE_BUFFER, Buffers[i]);
+		glBufferData(GL_TEXTURE_BUFFER, 16, NULL, GL_STREAM_DRAW);
+		glBindTexture(GL_TEXTURE_BUFFER, Textures[i]);
+		glTexBuffer(GL_TEXTURE_BUFFER, Formats[i], Buffers[i]);
+	}
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
+
+__forceinline void GClusteredLights::Start(const glm::mat4 &Projection, const glm::mat4 &View, float NearPlane, float FarPlane, int Width, int Height)
+{
+	StartTime = std::chrono::high_resolution_clock::now();
+
+	if ((int)Lights.size() > ClusteredLightsMax)
+	{
+		Lights.resize(ClusteredLightsMax);
+	}
+	float DepthRatio = glm::log(FarPlane / NearPlane);
+	Block.Grid.w = (int)Lights.size();
+	Block.Mapping = glm::vec4(Slices / DepthRatio, -Slices * glm::log(NearPlane) / DepthRatio, (float)TilesX / glm::max(Width, 1), (float)TilesY / glm::max(Height, 1));
+
+	// A point at view depth d and normalized x is at x * d / Projection[0][0], the bounds are at the nearest or farthest depth
+	SliceDepths.resize(Slices);
+	ColumnBounds.resize(Slices * TilesX);
+	RowBounds.resize(Slices * TilesY);
+	for (int Slice = 0; Slice < Slices; ++Slice)
+	{
+		glm::vec2 Depths(NearPlane * glm::pow(FarPlane / NearPlane, (float)Slice / Slices), NearPlane * glm::pow(FarPlane / NearPlane, (float)(Slice + 1) / Slices));
+		SliceDepths[Slice] = Depths;
+		for (int Axis = 0; Axis < 2; ++Axis)
+		{
+			int Tiles = Axis == 0 ? TilesX : TilesY;
+			glm::vec2* Bounds = Axis == 0 ? &ColumnBounds[Slice * TilesX] : &RowBounds[Slice * TilesY];
+			float Scale = 1.f / Projection[Axis][Axis];
+			for (int Tile = 0; Tile < Tiles; ++Tile)
+			{
+				float Low = (-1.f + 2.f * Tile / Tiles) * Scale;
+				float High = (-1.f + 2.f * (Tile + 1) / Tiles) * Scale;
+				Bounds[Tile] = glm::vec2(glm::min(Low * Depths.x, Low * Depths.y), glm::max(High * Depths.x, High * Depths.y));
+			}
+		}
+	}
+
+	// The range is where the brightest channel falls under the cutoff, solving Constant + Linear * d + Quadratic * d^2 = Intensity / Cutoff
+	Spheres.resize(Lights.size());
+	Texels.resize(4 * Lights.size());
+	for (size_t i = 0; i < Lights.size(); ++i)
+	{
+		const FClusteredLight &Light = Lights[i];
+		glm::vec3 Brightest = glm::max(Light.Ambient, glm::max(Light.Diffuse, Light.Specular));
+		float Attenuation = glm::max(Brightest.x, glm::max(Brightest.y, Brightest.z)) / Cutoff;
+		float Range = FarPlane;
+		if (Light.Quadratic > 0.f)
+		{
+			Range = (-Light.Linear + glm::sqrt(glm::max(Light.Linear * Light.Linear - 4.f * Light.Quadratic * (Light.Constant - Attenuation), 0.f))) / (2.f * Light.Quadratic);
+		}
+		else if (Light.Linear > 0.f)
+		{
+			Range = (Attenuation - Light.Constant) / Light.Linear;
+		}
+		Range = glm::clamp(Range, 0.f, FarPlane);
+
+		glm::vec4 Center = View * glm::vec4(Light.Position, 1.f);
+		Spheres[i] = glm::vec4(Center.x, Center.y, -Center.z, Range);
+		Texels[4 * i] = glm::vec4(Light.Position, Range);
+		Texels[4 * i + 1] = glm::vec4(Light.Ambient, Light.Constant);
+		Texels[4 * i + 2] = glm::vec4(Light.Diffuse, Light.Linear);
+		Texels[4 * i + 3] = glm::vec4(Light.Specular, Light.Quadratic);
+	}
+
+	bStarted = true;
+	bBinned = bBinning;
+	int WorkersCount = bBinned ? glm::max(1, (int)std::thread::hardware_concurrency() - 1) : 0;
+	for (int Worker = 0; Worker < WorkersCount; ++Worker)
+	{
+		Workers.emplace_back([this, Worker, WorkersCount]()
+		{
+			for (int Slice = Worker; Slice < Slices; Slice += WorkersCount)
+			{
+				Bin(Slice);
+			}
+		});
+	}
+}
+
+__forceinline void GClusteredLights::Finish()
+{
+	if (!bStarted)
+	{
+		return;
+	}
+	bStarted = false;
+	for (std::thread &Worker : Workers)
+	{
+		Worker.join();
+	}
+	Workers.clear();
+
+	// Orphaned every frame, the draws still reading the previous lists keep them
+	glBindBuffer(GL_TEXTURE_BUFFER, Buffers[0]);
+	glBufferData(GL_TEXTURE_BUFFER, glm::max(Texels.size() * sizeof(glm::vec4), (size_t)16), Texels.empty() ? NULL : Texels.data(), GL_STREAM_DRAW);
+	if (bBinned)
+	{
+		// The slices one after the other, their ranges moved past the previous ones
+		std::vector<uint16_t> Indices;
+		int FroxelsPerSlice = TilesX * TilesY;
+		MaxLightsPerCluster = 0;
+		for (int Slice = 0; Slice < Slices; ++Slice)
+		{
+			unsigned int Offset = (unsigned int)Indices.size();
+			for (int Froxel = Slice * FroxelsPerSlice; Froxel < (Slice + 1) * FroxelsPerSlice; ++Froxel)
+			{
+				Ranges[2 * Froxel] += Offset;
+				MaxLightsPerCluster = glm::max(MaxLightsPerCluster, (int)Ranges[2 * Froxel + 1]);
+			}
+			Indices.insert(Indices.end(), SliceIndices[Slice].begin(), SliceIndices[Slice].end());
+		}
+		IndicesCount = (int)Indices.size();
+
+		glBindBuffer(GL_TEXTURE_BUFFER, Buffers[1]);
+		glBufferData(GL_TEXTURE_BUFFER, Ranges.size() * sizeof(unsigned int), Ranges.data(), GL_STREAM_DRAW);
+		glBindBuffer(GL_TEXTURE_BUFFER, Buffers[2]);
+		glBufferData(GL_TEXTURE_BUFFER, glm::max(Indices.size() * sizeof(uint16_t), (size_t)16), Indices.empty() ? NULL : Indices.data(), GL_STREAM_DRAW);
+	}
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	BinMilliseconds = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - StartTime).count();
+}
+
+__forceinline const FClustersBlock &GClusteredLights::GetBlock() const
+{
+	return Block;
+}
+
+__forceinline void GClusteredLights::Bind(int Unit) const
+{
+	for (int i = 0; i < 3; ++i)
+	{
+		glActiveTexture(GL_TEXTURE0 + Unit + i);
+		glBindTexture(GL_TEXTURE_BUFFER, Textures[i]);
+	}
+	glActiveTexture(GL_TEXTURE0);
+}
+
+__forceinline unsigned int GClusteredLights::GetLightsBuffer() const
+{
+	return Buffers[0];
+}
+
+__forceinline void GClusteredLights::Delete()
+{
+	for (std::thread &Worker : Workers)
+	{
+		Worker.join();
+	}
+	Workers.clear();
+	glDeleteTextures(3, Textures);
+	glDeleteBuffers(3, Buffers);
+}
+
+__forceinline void GClusteredLights::Bin(int Slice)
+{
+	std::vector<uint16_t> &Indices = SliceIndices[Slice];
+	Indices.clear();
+	glm::vec2 Depths = SliceDepths[Slice];
+	const glm::vec2* Columns = &ColumnBounds[Slice * TilesX];
+	const glm::vec2* Rows = &RowBounds[Slice * TilesY];
+
+	// Squared distances from the lights to the slice, then to each row of it, which the columns only add to
+	std::vector<int> SliceLights;
+	std::vector<float> SliceDistances;
+	for (int i = 0; i < (int)Spheres.size(); ++i)
+	{
+		const glm::vec4 &Sphere = Spheres[i];
+		float Distance = glm::max(glm::max(Depths.x - Sphere.z, Sphere.z - Depths.y), 0.f);
+		if (Distance < Sphere.w)
+		{
+			SliceLights.push_back(i);
+			SliceDistances.push_back(Distance * Distance);
+		}
+	}
+
+	std::vector<int> RowLights;
+	std::vector<float> RowDistances;
+	for (int Row = 0; Row < TilesY; ++Row)
+	{
+		RowLights.clear();
+		RowDistances.clear();
+		for (size_t i = 0; i < SliceLights.size(); ++i)
+		{
+			const glm::vec4 &Sphere = Spheres[SliceLights[i]];
+			float Distance = glm::max(glm::max(Rows[Row].x - Sphere.y, Sphere.y - Rows[Row].y), 0.f);
+			float Squared = SliceDistances[i] + Distance * Distance;
+			if (Squared < Sphere.w * Sphere.w)
+			{
+				RowLights.push_back(SliceLights[i]);
+				RowDistances.push_back(Squared);
+			}
+		}
+
+		for (int Column = 0; Column < TilesX; ++Column)
+		{
+			int Froxel = (Slice * TilesY + Row) * TilesX + Column;
+			Ranges[2 * Froxel] = (unsigned int)Indices.size();
+			for (size_t i = 0; i < RowLights.size(); ++i)
+			{
+				const glm::vec4 &Sphere = Spheres[RowLights[i]];
+				float Distance = glm::max(glm::max(Columns[Column].x - Sphere.x, Sphere.x - Columns[Column].y), 0.f);
+				if (RowDistances[i] + Distance * Distance < Sphere.w * Sphere.w)
+				{
+					Indices.push_back((uint16_t)RowLights[i]);
+				}
+			}
+			Ranges[2 * Froxel + 1] = (unsigned int)Indices.size() - Ranges[2 * Froxel];
+		}
+	}
+}
@@ -0,0 +1,183 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <iostream>
+
+#include "Utils.h"
+
+// Deferred shading of the terrain, selectable against the forward path. The DEFERRED permutation of Terrain.frag writes
+// the height band color and the normal to the G-buffer, with the depth. The lights then run once per visible pixel
+// whatever the overdraw: a full screen pass for the lights of ULights, then a sphere per clustered light covering its
+// range, added over the pixels it reaches.
+class GDeferred
+{
+public:
+	GDeferred();
+
+	// Matches the G-buffer to the framebuffer, then binds and clears it for the terrain
+	void Begin(int Width, int Height);
+	// Copies the depth to the default framebuffer and binds it back, the lights and the rest of the scene test against it
+	void End();
+
+	// Albedo, normal and depth on Unit, Unit + 1 and Unit + 2
+	void Bind(int Unit) const;
+	// Every pixel, DeferredLight.frag discards the background
+	void DrawFullScreen() const;
+	// A sphere per light of LightsBuffer, laid out like the lights of GClusteredLights, added to the lit pixels
+	void DrawVolumes(unsigned int LightsBuffer, int Count) const;
+
+	void Delete();
+
+private:
+	void Resize(int InWidth, int InHeight);
+
+	int Width;
+	int Height;
+	unsigned int FBO;
+	// Albedo RGBA8, normal RGBA16F, and depth with stencil like the default framebuffer so it can be copied there
+	unsigned int Textures[3];
+
+	// Empty, for the full screen triangle
+	unsigned int ScreenVAO;
+	unsigned int VolumeVAO;
+	unsigned int VolumeVBO;
+	unsigned int VolumeEBO;
+	int VolumeIndicesSize;
+};
+
+__forceinline GDeferred::GDeferred() : Width(0), Height(0)
+{
+	glGenFramebuffers(1, &FBO);
+	glGenTextures(3, Textures);
+	glGenVertexArrays(1, &ScreenVAO);
+
+	// Unit sphere, DeferredVolume.vert scales it past the range
+	float* Sphere;
+	int* SphereIndices;
+	int SphereSize;
+	GenerateSphere(Sphere, SphereIndices, 16, 8, 1.f, SphereSize, VolumeIndicesSize);
+
+	glGenVertexArrays(1, &VolumeVAO);
+	glGenBuffers(1, &VolumeVBO);
+	glGenBuffers(1, &VolumeEBO);
+	glBindVertexArray(VolumeVAO);
+	glBindBuffer(GL_ARRAY_BUFFER, VolumeVBO);
+	glBufferData(GL_ARRAY_BUFFER, SphereSize * sizeof(float), Sphere, GL_STATIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, VolumeEBO);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, VolumeIndicesSize * sizeof(int), SphereIndices, GL_STATIC_DRAW);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
+	glEnableVertexAttribArray(0);
+	for (int Texel = 0; Texel < 4; ++Texel)
+	{
+		glEnableVertexAttribArray(2 + Texel);
+		glVertexAttribDivisor(2 + Texel, 1);
+	}
+	glBindVertexArray(0);
+
+	delete[] Sphere;
+	delete[] SphereIndices;
+}
+
+__forceinline void GDeferred::Begin(int InWidth, int InHeight)
+{
+	if (InWidth != Width || InHeight != Height)
+	{
+		Resize(InWidth, InHeight);
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+__forceinline void GDeferred::End()
+{
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, FBO);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	glBlitFramebuffer(0, 0, Width, Height, 0, 0, Width, Height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+__forceinline void GDeferred::Bind(int Unit) const
+{
+	for (int i = 0; i < 3; ++i)
+	{
+		glActiveTexture(GL_TEXTURE0 + Unit + i);
+		glBindTexture(GL_TEXTURE_2D, Textures[i]);
+	}
+	glActiveTexture(GL_TEXTURE0);
+}
+
+__forceinline void GDeferred::DrawFullScreen() const
+{
+	glDisable(GL_DEPTH_TEST);
+	glBindVertexArray(ScreenVAO);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glEnable(GL_DEPTH_TEST);
+}
+
+__forceinline void GDeferred::DrawVolumes(unsigned int LightsBuffer, int Count) const
+{
+	if (Count == 0)
+	{
+		return;
+	}
+	glBindVertexArray(VolumeVAO);
+	glBindBuffer(GL_ARRAY_BUFFER, LightsBuffer);
+	for (int Texel = 0; Texel < 4; ++Texel)
+	{
+		glVertexAttribPointer(2 + Texel, 4, GL_FLOAT, GL_FALSE, 16 * sizeof(float), (void*)(4 * Texel * sizeof(float)));
+	}
+
+	// Only the far side of each sphere, once per pixel even with the camera inside. GenerateSphere winds the triangles
+	// clockwise seen from outside, so the far side faces the camera.
+	glEnable(GL_CULL_FACE);
+	glCullFace(GL_BACK);
+	glDepthFunc(GL_GEQUAL);
+	glDepthMask(GL_FALSE);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_ONE, GL_ONE);
+	glDrawElementsInstanced(GL_TRIANGLES, VolumeIndicesSize, GL_UNSIGNED_INT, 0, Count);
+	glDisable(GL_BLEND);
+	glDepthMask(GL_TRUE);
+	glDepthFunc(GL_LESS);
+	glDisable(GL_CULL_FACE);
+}
+
+__forceinline void GDeferred::Delete()
+{
+	glDeleteFramebuffers(1, &FBO);
+	glDeleteTextures(3, Textures);
+	glDeleteVertexArrays(1, &ScreenVAO);
+	glDeleteVertexArrays(1, &VolumeVAO);
+	glDeleteBuffers(1, &VolumeVBO);
+	glDeleteBuffers(1, &VolumeEBO);
+}
+
+__forceinline void GDeferred::Resize(int InWidth, int InHeight)
+{
+	Width = InWidth;
+	Height = InHeight;
+
+	const GLenum InternalFormats[] = { GL_RGBA8, GL_RGBA16F, GL_DEPTH24_STENCIL8 };
+	const GLenum Formats[] = { GL_RGBA, GL_RGBA, GL_DEPTH_STENCIL };
+	const GLenum Types[] = { GL_UNSIGNED_BYTE, GL_FLOAT, GL_UNSIGNED_INT_24_8 };
+	for (int i = 0; i < 3; ++i)
+	{
+		glBindTexture(GL_TEXTURE_2D, Textures[i]);
+		glTexImage2D(GL_TEXTURE_2D, 0, InternalFormats[i], Width, Height, 0, Formats[i], Types[i], NULL);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, Textures[0], 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, Textures[1], 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, Textures[2], 0);
+	const GLenum DrawBuffers[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+	glDrawBuffers(2, DrawBuffers);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "ERROR::FRAMEBUFFER::GBUFFER_NOT_COMPLETE" << std::endl;
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
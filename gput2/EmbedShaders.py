@@ -0,0 +1,76 @@
+"""Embeds every file in Shaders/ into ShaderSources.h as a constexpr FShaderSource.
+
+Runs before each build (pre-build event of gput2.vcxproj), and by hand on other platforms:
+
+    python EmbedShaders.py
+
+The header is only rewritten when its contents change, so it doesn't trigger rebuilds on its own.
+"""
+
+import os
+import sys
+
+ROOT = os.path.dirname(os.path.abspath(__file__))
+SHADERS = os.path.join(ROOT, "Shaders")
+OUTPUT = os.path.join(ROOT, "ShaderSources.h")
+
+# MSVC rejects string literals longer than 16380 bytes, longer sources are split in adjacent literals
+CHUNK = 16000
+DELIMITER = "GLSL"
+
+
+def hash_bytes(data):
+    """64-bit FNV-1a, HashBytes in Utils.h"""
+    value = 14695981039346656037
+    for byte in data:
+        value = ((value ^ byte) * 1099511628211) & 0xFFFFFFFFFFFFFFFF
+    return value
+
+
+def variable_name(file_name):
+    """Arrow.vert -> ArrowVert"""
+    stem, extension = os.path.splitext(file_name)
+    return stem + extension[1:].capitalize()
+
+
+def chunks(code):
+    """Whole lines up to CHUNK bytes each"""
+    current = ""
+    for line in code.splitlines(keepends=True):
+        if current and len(current) + len(line) > CHUNK:
+            yield current
+            current = ""
+        current += line
+    yield current
+
+
+def embed(file_name):
+    with open(os.path.join(SHADERS, file_name), "rb") as file:
+        # The compiler reads the literal with \n line endings whatever the checkout has
+        code = file.read().replace(b"\r\n", b"\n").decode("ascii")
+    if ")" + DELIMITER + '"' in code:
+        sys.exit("EmbedShaders: %s contains the raw string delimiter" % file_name)
+
+    lines = ["// " + file_name, "constexpr FShaderSource %s =" % variable_name(file_name), "{", '\t"%s",' % file_name]
+    lines += ['\tR"%s(%s)%s"' % (DELIMITER, chunk, DELIMITER) for chunk in chunks(code)]
+    lines[-1] += ","
+    lines += ["\t0x%016xull" % hash_bytes(code.encode("ascii")), "};", ""]
+    return "\n".join(lines)
+
+
+def main():
+    files = sorted(name for name in os.listdir(SHADERS) if os.path.isfile(os.path.join(SHADERS, name)))
+    header = "// Generated by EmbedShaders.py from the files in Shaders/, edit those and run it again\n"
+    header += "#pragma once\n\n#include \"Shader.h\"\n\n"
+    header += "\n".join(embed(name) for name in files)
+
+    if os.path.exists(OUTPUT):
+        with open(OUTPUT, "r", encoding="utf-8", newline="") as file:
+            if file.read() == header:
+                return
+    with open(OUTPUT, "w", encoding="utf-8", newline="") as file:
+        file.write(header)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+// View frustum planes extracted from a projection * view matrix, normals pointing inside
+struct FFrustum
+{
+	glm::vec4 Planes[6];
+
+	explicit FFrustum(const glm::mat4 &ViewProjection);
+
+	// Conservative, a few boxes near the corners of the frustum pass without being inside
+	bool IntersectsBox(glm::vec3 Min, glm::vec3 Max) const;
+};
+
+__forceinline FFrustum::FFrustum(const glm::mat4 &ViewProjection)
+{
+	glm::vec4 Rows[4];
+	for (int i = 0; i < 4; ++i)
+	{
+		Rows[i] = glm::vec4(ViewProjection[0][i], ViewProjection[1][i], ViewProjection[2][i], ViewProjection[3][i]);
+	}
+
+	// Left, right, bottom, top, near and far
+	for (int i = 0; i < 3; ++i)
+	{
+		Planes[2 * i] = Rows[3] + Rows[i];
+		Planes[2 * i + 1] = Rows[3] - Rows[i];
+	}
+}
+
+__forceinline bool FFrustum::IntersectsBox(glm::vec3 Min, glm::vec3 Max) const
+{
+	for (int i = 0; i < 6; ++i)
+	{
+		// Corner of the box farthest along the plane normal
+		glm::vec3 Corner(Planes[i].x >= 0.f ? Max.x : Min.x, Planes[i].y >= 0.f ? Max.y : Min.y, Planes[i].z >= 0.f ? Max.z : Min.z);
+		if (glm::dot(glm::vec3(Planes[i]), Corner) + Planes[i].w < 0.f)
+		{
+			return false;
+		}
+	}
+	return true;
+}
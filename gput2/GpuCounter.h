@@ -0,0 +1,76 @@
+#pragma once
+
+#include <glad/glad.h>
+
+// Counts the samples that pass the depth test between Begin and End with GL_SAMPLES_PASSED queries, the fragments shaded
+// once early depth testing has rejected the hidden ones. Read a few frames later like GGpuTimer, only one counter can be
+// running at a time, but it can run inside a GGpuTimer.
+class GGpuCounter
+{
+public:
+	GGpuCounter();
+
+	void Begin();
+	void End();
+
+	// Last available count, smoothed over a few frames
+	float GetSamples() const;
+
+	void Delete();
+
+private:
+	static const int QueriesCount = 4;
+
+	unsigned int Queries[QueriesCount];
+	bool bPending[QueriesCount];
+	int Current;
+	float Samples;
+};
+
+__forceinline GGpuCounter::GGpuCounter() : Current(0), Samples(0.f)
+{
+	glGenQueries(QueriesCount, Queries);
+	for (int i = 0; i < QueriesCount; ++i)
+	{
+		bPending[i] = false;
+	}
+}
+
+__forceinline void GGpuCounter::Begin()
+{
+	// Collect every finished query before reusing the oldest one
+	for (int i = 0; i < QueriesCount; ++i)
+	{
+		if (!bPending[i])
+		{
+			continue;
+		}
+		int bAvailable = 0;
+		glGetQueryObjectiv(Queries[i], GL_QUERY_RESULT_AVAILABLE, &bAvailable);
+		if (bAvailable || i == Current)
+		{
+			GLuint Passed;
+			glGetQueryObjectuiv(Queries[i], GL_QUERY_RESULT, &Passed);
+			Samples = 0.9f * Samples + 0.1f * (float)Passed;
+			bPending[i] = false;
+		}
+	}
+	glBeginQuery(GL_SAMPLES_PASSED, Queries[Current]);
+}
+
+__forceinline void GGpuCounter::End()
+{
+	glEndQuery(GL_SAMPLES_PASSED);
+	bPending[Current] = true;
+	Current = (Current + 1) % QueriesCount;
+}
+
+__forceinline float GGpuCounter::GetSamples() const
+{
+	return Samples;
+}
+
+__forceinline void GGpuCounter::Delete()
+{
+	glDeleteQueries(QueriesCount, Queries);
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <glad/glad.h>
+
+// Measures the GPU time spent between Begin and End with GL_TIME_ELAPSED queries.
+// Results are read a few frames later so the CPU never waits for the GPU, only one timer can be running at a time.
+class GGpuTimer
+{
+public:
+	GGpuTimer();
+
+	void Begin();
+	void End();
+
+	// Last available measure, smoothed over a few frames
+	float GetMilliseconds() const;
+
+	void Delete();
+
+private:
+	static const int QueriesCount = 4;
+
+	unsigned int Queries[QueriesCount];
+	bool bPending[QueriesCount];
+	int Current;
+	float Milliseconds;
+};
+
+__forceinline GGpuTimer::GGpuTimer() : Current(0), Milliseconds(0.f)
+{
+	glGenQueries(QueriesCount, Queries);
+	for (int i = 0; i < QueriesCount; ++i)
+	{
+		bPending[i] = false;
+	}
+}
+
+__forceinline void GGpuTimer::Begin()
+{
+	// Collect every finished query before reusing the oldest one
+	for (int i = 0; i < QueriesCount; ++i)
+	{
+		if (!bPending[i])
+		{
+			continue;
+		}
+		int bAvailable = 0;
+		glGetQueryObjectiv(Queries[i], GL_QUERY_RESULT_AVAILABLE, &bAvailable);
+		if (bAvailable || i == Current)
+		{
+			GLuint64 Nanoseconds;
+			glGetQueryObjectui64v(Queries[i], GL_QUERY_RESULT, &Nanoseconds);
+			Milliseconds = 0.9f * Milliseconds + 0.1f * (float)(Nanoseconds / 1e6);
+			bPending[i] = false;
+		}
+	}
+	glBeginQuery(GL_TIME_ELAPSED, Queries[Current]);
+}
+
+__forceinline void GGpuTimer::End()
+{
+	glEndQuery(GL_TIME_ELAPSED);
+	bPending[Current] = true;
+	Current = (Current + 1) % QueriesCount;
+}
+
+__forceinline float GGpuTimer::GetMilliseconds() const
+{
+	return Milliseconds;
+}
+
+__forceinline void GGpuTimer::Delete()
+{
+	glDeleteQueries(QueriesCount, Queries);
+}
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "Noise.h"
+
+// fbm_9 of the terrain baked on the CPU into a RGB32F texture: value in red, gradient in green and blue.
+// The height scale and the width are applied by Terrain.vert, so only a new time needs a new bake.
+class GHeightMap
+{
+public:
+	// The texture covers grid coordinates in [-Range / 2, Range / 2]
+	GHeightMap(int Resolution, float Range);
+
+	// Bakes again when the time or the resolution changed since the last bake, returns true when it did
+	bool Update(float Time);
+	void SetResolution(int Resolution);
+	void Bind(int Unit) const;
+
+	// Lowest and highest fbm the linear filter can return between grid coordinates Min and Max, from the last bake
+	glm::vec2 GetBounds(glm::vec2 Min, glm::vec2 Max) const;
+	// Fbm, gradient x and gradient y of every texel of the last bake, row after row
+	const std::vector<float> &GetTexels() const;
+
+	void Delete();
+
+public:
+	unsigned int Texture;
+	int Resolution;
+	float Range;
+
+	int Bakes;
+	float BakeMilliseconds;
+
+private:
+	void Bake(float Time);
+
+	bool bValid;
+	float Time;
+	std::vector<float> Texels;
+};
+
+__forceinline GHeightMap::GHeightMap(int InResolution, float InRange) : Resolution(InResolution), Range(InRange), Bakes(0), BakeMilliseconds(0.f), bValid(false), Time(0.f)
+{
+	glGenTextures(1, &Texture);
+	glBindTexture(GL_TEXTURE_2D, Texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+}
+
+__forceinline bool GHeightMap::Update(float InTime)
+{
+	if (bValid && Time == InTime)
+	{
+		return false;
+	}
+	Bake(InTime);
+	return true;
+}
+
+__forceinline void GHeightMap::SetResolution(int InResolution)
+{
+	if (Resolution != InResolution)
+	{
+		Resolution = InResolution;
+		bValid = false;
+	}
+}
+
+__forceinline void GHeightMap::Bind(int Unit) const
+{
+	glActiveTexture(GL_TEXTURE0 + Unit);
+	glBindTexture(GL_TEXTURE_2D, Texture);
+}
+
+__forceinline glm::vec2 GHeightMap::GetBounds(glm::vec2 Min, glm::vec2 Max) const
+{
+	// Texels around the corners of the region, the filter never goes past them
+	float Separation = Range / Resolution;
+	int FirstX = glm::clamp((int)glm::floor((Min.x + Range / 2.f) / Separation - 0.5f), 0, Resolution - 1);
+	int FirstY = glm::clamp((int)glm::floor((Min.y + Range / 2.f) / Separation - 0.5f), 0, Resolution - 1);
+	int LastX = glm::clamp((int)glm::floor((Max.x + Range / 2.f) / Separation - 0.5f) + 1, 0, Resolution - 1);
+	int LastY = glm::clamp((int)glm::floor((Max.y + Range / 2.f) / Separation - 0.5f) + 1, 0, Resolution - 1);
+
+	glm::vec2 Bounds(Texels[3 * (FirstY * Resolution + FirstX)]);
+	for (int j = FirstY; j <= LastY; ++j)
+	{
+		for (int i = FirstX; i <= LastX; ++i)
+		{
+			float Fbm = Texels[3 * (j * Resolution + i)];
+			Bounds.x = glm::min(Bounds.x, Fbm);
+			Bounds.y = glm::max(Bounds.y, Fbm);
+		}
+	}
+	return Bounds;
+}
+
+__forceinline const std::vector<float> &GHeightMap::GetTexels() const
+{
+	return Texels;
+}
+
+__forceinline void GHeightMap::Delete()
+{
+	glDeleteTextures(1, &Texture);
+}
+
+__forceinline void GHeightMap::Bake(float InTime)
+{
+	auto Start = std::chrono::high_resolution_clock::now();
+
+	Time = InTime;
+	int TexelsCount = Resolution * Resolution;
+	float Separation = Range / Resolution;
+
+	// Texel centers, row j is the grid coordinate y
+	std::vector<float> X(TexelsCount), Y(TexelsCount), Fbm(TexelsCount);
+	for (int j = 0; j < Resolution; ++j)
+	{
+		for (int i = 0; i < Resolution; ++i)
+		{
+			X[j * Resolution + i] = (i + 0.5f) * Separation - Range / 2.f;
+			Y[j * Resolution + i] = (j + 0.5f) * Separation - Range / 2.f;
+		}
+	}
+
+	// Whole rows per thread
+	int ThreadsCount = glm::max(1, (int)std::thread::hardware_concurrency());
+	int RowsPerThread = (Resolution + ThreadsCount - 1) / ThreadsCount;
+	std::vector<std::thread> Threads;
+	for (int t = 0; t < ThreadsCount; ++t)
+	{
+		int First = t * RowsPerThread * Resolution;
+		int Count = std::min(RowsPerThread * Resolution, TexelsCount - First);
+		if (Count <= 0)
+		{
+			break;
+		}
+		Threads.emplace_back(Fbm9Batch, X.data() + First, Y.data() + First, Fbm.data() + First, Count, Time, GetNoiseISA());
+	}
+	for (std::thread &Thread : Threads)
+	{
+		Thread.join();
+	}
+
+	// Gradient by central differences, one sided on the borders
+	Texels.resize(3 * TexelsCount);
+	for (int j = 0; j < Resolution; ++j)
+	{
+		int Down = glm::max(j - 1, 0);
+		int Up = glm::min(j + 1, Resolution - 1);
+		for (int i = 0; i < Resolution; ++i)
+		{
+			int Left = glm::max(i - 1, 0);
+			int Right = glm::min(i + 1, Resolution - 1);
+			int Index = j * Resolution + i;
+			Texels[3 * Index] = Fbm[Index];
+			Texels[3 * Index + 1] = (Fbm[j * Resolution + Right] - Fbm[j * Resolution + Left]) / ((Right - Left) * Separation);
+			Texels[3 * Index + 2] = (Fbm[Up * Resolution + i] - Fbm[Down * Resolution + i]) / ((Up - Down) * Separation);
+		}
+	}
+
+	glBindTexture(GL_TEXTURE_2D, Texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB32F, Resolution, Resolution, 0, GL_RGB, GL_FLOAT, Texels.data());
+
+	bValid = true;
+	++Bakes;
+
+	auto End = std::chrono::high_resolution_clock::now();
+	BakeMilliseconds = std::chrono::duration<float, std::milli>(End - Start).count();
+}
@@ -0,0 +1,219 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cfloat>
+#include <chrono>
+#include <vector>
+
+#include "HeightMap.h"
+
+// Max mip pyramid of the baked height map, for the heightfield shadows. Level 0 holds the highest fbm the linear filter can
+// return inside each texel, every next level the highest of 2x2 texels of the previous one, so a ray towards the light that
+// passes above a texel of level L clears 2^L x 2^L texels of the height map in one step. A new bake only rebuilds the blocks
+// whose fbm changed, with their neighbors, and uploads the rectangle they cover on each level.
+class GHeightMaxPyramid
+{
+public:
+	GHeightMaxPyramid();
+
+	// Follows a new bake of HeightMap, returns true when it rebuilt something
+	bool Update(const GHeightMap &HeightMap);
+	void Bind(int Unit) const;
+
+	int GetLevelsCount() const;
+	// Highest fbm of the whole map, the top level
+	float GetMax() const;
+
+	void Delete();
+
+public:
+	unsigned int Texture;
+	int Resolution;
+
+	int Builds;
+	// Level 0 texels rebuilt by the last build, out of Resolution x Resolution
+	int RebuiltTexels;
+	float BuildMilliseconds;
+
+private:
+	void Allocate(int Resolution);
+
+	// Texels per side of the blocks compared after a bake
+	static const int BlockSize = 16;
+
+	int Bakes;
+	std::vector<float> Fbm;
+	std::vector<std::vector<float>> Levels;
+};
+
+__forceinline GHeightMaxPyramid::GHeightMaxPyramid() : Resolution(0), Builds(0), RebuiltTexels(0), BuildMilliseconds(0.f), Bakes(0)
+{
+	glGenTextures(1, &Texture);
+}
+
+__forceinline bool GHeightMaxPyramid::Update(const GHeightMap &HeightMap)
+{
+	if (HeightMap.Bakes == 0 || HeightMap.Bakes == Bakes)
+	{
+		return false;
+	}
+	Bakes = HeightMap.Bakes;
+
+	auto Start = std::chrono::high_resolution_clock::now();
+
+	bool bAll = HeightMap.Resolution != Resolution;
+	if (bAll)
+	{
+		Allocate(HeightMap.Resolution);
+	}
+
+	// Blocks with a different fbm, then their neighbors, whose texels on the border take the max over the changed ones
+	const std::vector<float> &Texels = HeightMap.GetTexels();
+	int Blocks = (Resolution + BlockSize - 1) / BlockSize;
+	std::vector<char> Changed(Blocks * Blocks, bAll);
+	for (int j = 0; j < Resolution; ++j)
+	{
+		for (int i = 0; i < Resolution; ++i)
+		{
+			int Index = j * Resolution + i;
+			if (bAll || Fbm[Index] != Texels[3 * Index])
+			{
+				Fbm[Index] = Texels[3 * Index];
+				Changed[(j / BlockSize) * Blocks + i / BlockSize] = true;
+			}
+		}
+	}
+	std::vector<glm::ivec2> Dirty;
+	for (int BlockY = 0; BlockY < Blocks; ++BlockY)
+	{
+		for (int BlockX = 0; BlockX < Blocks; ++BlockX)
+		{
+			bool bDirty = false;
+			for (int y = glm::max(BlockY - 1, 0); y <= glm::min(BlockY + 1, Blocks - 1) && !bDirty; ++y)
+			{
+				for (int x = glm::max(BlockX - 1, 0); x <= glm::min(BlockX + 1, Blocks - 1) && !bDirty; ++x)
+				{
+					bDirty = Changed[y * Blocks + x] != 0;
+				}
+			}
+			if (bDirty)
+			{
+				Dirty.push_back(glm::ivec2(BlockX, BlockY));
+			}
+		}
+	}
+	if (Dirty.empty())
+	{
+		RebuiltTexels = 0;
+		return false;
+	}
+
+	glBindTexture(GL_TEXTURE_2D, Texture);
+	RebuiltTexels = 0;
+	for (int Level = 0; Level < GetLevelsCount(); ++Level)
+	{
+		int Size = Resolution >> Level;
+		int MinX = Size, MinY = Size, MaxX = 0, MaxY = 0;
+		for (glm::ivec2 Block : Dirty)
+		{
+			// Texels of the level under the block, a single one on the levels coarser than it
+			int FirstX = (Block.x * BlockSize) >> Level;
+			int FirstY = (Block.y * BlockSize) >> Level;
+			int LastX = glm::min(((Block.x + 1) * BlockSize - 1) >> Level, Size - 1);
+			int LastY = glm::min(((Block.y + 1) * BlockSize - 1) >> Level, Size - 1);
+			MinX = glm::min(MinX, FirstX);
+			MinY = glm::min(MinY, FirstY);
+			MaxX = glm::max(MaxX, LastX);
+			MaxY = glm::max(MaxY, LastY);
+			for (int j = FirstY; j <= LastY; ++j)
+			{
+				for (int i = FirstX; i <= LastX; ++i)
+				{
+					float Max = -FLT_MAX;
+					if (Level == 0)
+					{
+						// The filter blends the texel with its neighbors up to half a texel away
+						for (int y = glm::max(j - 1, 0); y <= glm::min(j + 1, Resolution - 1); ++y)
+						{
+							for (int x = glm::max(i - 1, 0); x <= glm::min(i + 1, Resolution - 1); ++x)
+							{
+								Max = glm::max(Max, Fbm[y * Resolution + x]);
+							}
+						}
+						++RebuiltTexels;
+					}
+					else
+					{
+						const std::vector<float> &Previous = Levels[Level - 1];
+						int PreviousSize = Size * 2;
+						Max = glm::max(glm::max(Previous[2 * j * PreviousSize + 2 * i], Previous[2 * j * PreviousSize + 2 * i + 1]),
+							glm::max(Previous[(2 * j + 1) * PreviousSize + 2 * i], Previous[(2 * j + 1) * PreviousSize + 2 * i + 1]));
+					}
+					Levels[Level][j * Size + i] = Max;
+				}
+			}
+		}
+
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, Size);
+		glPixelStorei(GL_UNPACK_SKIP_PIXELS, MinX);
+		glPixelStorei(GL_UNPACK_SKIP_ROWS, MinY);
+		glTexSubImage2D(GL_TEXTURE_2D, Level, MinX, MinY, MaxX - MinX + 1, MaxY - MinY + 1, GL_RED, GL_FLOAT, Levels[Level].data());
+	}
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+	glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+
+	++Builds;
+	auto End = std::chrono::high_resolution_clock::now();
+	BuildMilliseconds = std::chrono::duration<float, std::milli>(End - Start).count();
+	return true;
+}
+
+__forceinline void GHeightMaxPyramid::Bind(int Unit) const
+{
+	glActiveTexture(GL_TEXTURE0 + Unit);
+	glBindTexture(GL_TEXTURE_2D, Texture);
+	glActiveTexture(GL_TEXTURE0);
+}
+
+__forceinline int GHeightMaxPyramid::GetLevelsCount() const
+{
+	return (int)Levels.size();
+}
+
+__forceinline float GHeightMaxPyramid::GetMax() const
+{
+	return Levels.empty() ? 0.f : Levels.back()[0];
+}
+
+__forceinline void GHeightMaxPyramid::Delete()
+{
+	glDeleteTextures(1, &Texture);
+}
+
+__forceinline void GHeightMaxPyramid::Allocate(int InResolution)
+{
+	// Power of two sides from GHeightMap, down to a single texel
+	Resolution = InResolution;
+	Fbm.assign(Resolution * Resolution, 0.f);
+	Levels.clear();
+	for (int Size = Resolution; Size > 0; Size /= 2)
+	{
+		Levels.emplace_back(Size * Size, 0.f);
+	}
+
+	// Read with texelFetch, level by level
+	glBindTexture(GL_TEXTURE_2D, Texture);
+	for (int Level = 0; Level < GetLevelsCount(); ++Level)
+	{
+		glTexImage2D(GL_TEXTURE_2D, Level, GL_R32F, Resolution >> Level, Resolution >> Level, 0, GL_RED, GL_FLOAT, NULL);
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, GetLevelsCount() - 1);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+}
@@ -0,0 +1,255 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "Noise.h"
+
+// Min-max pyramid of the fbm at the vertices of the grid made by GenerateGrid. Level 0 holds the bounds of each grid cell,
+// every next level the bounds of 2x2 cells of the previous one. Values are fbm, before the height scale, so only a new time
+// needs a new build, which runs on worker threads while the previous build stays usable for its own time.
+class GHeightPyramid
+{
+public:
+	GHeightPyramid(int Vertices, float SeparationFactor);
+
+	// Drops the pyramid for a grid of another resolution, the next update builds it again
+	void SetGrid(int Vertices, float SeparationFactor);
+
+	// Starts a build for Time when the last one is for another time, and picks up finished builds
+	void Update(float Time);
+	bool IsValid(float Time) const;
+
+	// Lowest and highest fbm of the grid between grid coordinates Min and Max
+	glm::vec2 GetBounds(glm::vec2 Min, glm::vec2 Max) const;
+
+	int GetLevelsCount() const;
+	int GetLevelSize(int Level) const;
+	glm::vec2 GetCellBounds(int Level, int i, int j) const;
+	// Grid coordinates of a cell, min in xy and max in zw
+	glm::vec4 GetCellRegion(int Level, int i, int j) const;
+
+	// Waits for the build in flight
+	void Delete();
+
+public:
+	int Builds;
+	float BuildMilliseconds;
+
+private:
+	void Build(float Time);
+
+	int Vertices;
+	float SeparationFactor;
+
+	// Rows follow GenerateGrid, row i is at grid coordinate y = SeparationFactor * (Vertices - i)
+	std::vector<std::vector<glm::vec2>> Levels;
+	std::vector<int> Sizes;
+	bool bValid;
+	float Time;
+
+	std::thread Builder;
+	std::atomic<bool> bBuilt;
+	std::vector<std::vector<glm::vec2>> BuildLevels;
+	float BuildTime;
+	float BuildDuration;
+};
+
+__forceinline GHeightPyramid::GHeightPyramid(int InVertices, float InSeparationFactor) : Builds(0), BuildMilliseconds(0.f), bValid(false), Time(0.f), bBuilt(false), BuildTime(0.f), BuildDuration(0.f)
+{
+	SetGrid(InVertices, InSeparationFactor);
+}
+
+__forceinline void GHeightPyramid::SetGrid(int InVertices, float InSeparationFactor)
+{
+	Delete();
+	Vertices = InVertices;
+	SeparationFactor = InSeparationFactor;
+	bValid = false;
+	Levels.clear();
+
+	int Size = 2 * Vertices;
+	Sizes.assign(1, Size);
+	while (Size > 1)
+	{
+		Size = (Size + 1) / 2;
+		Sizes.push_back(Size);
+	}
+}
+
+__forceinline void GHeightPyramid::Update(float InTime)
+{
+	if (Builder.joinable())
+	{
+		if (!bBuilt)
+		{
+			return;
+		}
+		Builder.join();
+		Levels.swap(BuildLevels);
+		Time = BuildTime;
+		bValid = true;
+		++Builds;
+		BuildMilliseconds = BuildDuration;
+	}
+
+	if (!bValid || Time != InTime)
+	{
+		bBuilt = false;
+		BuildTime = InTime;
+		Builder = std::thread(&GHeightPyramid::Build, this, InTime);
+	}
+}
+
+__forceinline bool GHeightPyramid::IsValid(float InTime) const
+{
+	return bValid && Time == InTime;
+}
+
+__forceinline glm::vec2 GHeightPyramid::GetBounds(glm::vec2 Min, glm::vec2 Max) const
+{
+	int Cells = 2 * Vertices;
+	int FirstJ = glm::clamp((int)glm::floor(Min.x / SeparationFactor + Vertices), 0, Cells - 1);
+	int LastJ = glm::clamp((int)glm::ceil(Max.x / SeparationFactor + Vertices), FirstJ + 1, Cells);
+	int FirstI = glm::clamp((int)glm::floor(Vertices - Max.y / SeparationFactor), 0, Cells - 1);
+	int LastI = glm::clamp((int)glm::ceil(Vertices - Min.y / SeparationFactor), FirstI + 1, Cells);
+
+	// Coarsest level whose cells line up with the region
+	int Level = 0;
+	while (Level + 1 < GetLevelsCount() && ((FirstI | FirstJ | LastI | LastJ) & ((2 << Level) - 1)) == 0)
+	{
+		++Level;
+	}
+
+	glm::vec2 Bounds(FLT_MAX, -FLT_MAX);
+	for (int i = FirstI >> Level; i < (LastI + (1 << Level) - 1) >> Level; ++i)
+	{
+		for (int j = FirstJ >> Level; j < (LastJ + (1 << Level) - 1) >> Level; ++j)
+		{
+			glm::vec2 Cell = GetCellBounds(Level, i, j);
+			Bounds.x = glm::min(Bounds.x, Cell.x);
+			Bounds.y = glm::max(Bounds.y, Cell.y);
+		}
+	}
+	return Bounds;
+}
+
+__forceinline int GHeightPyramid::GetLevelsCount() const
+{
+	return (int)Sizes.size();
+}
+
+__forceinline int GHeightPyramid::GetLevelSize(int Level) const
+{
+	return Sizes[Level];
+}
+
+__forceinline glm::vec2 GHeightPyramid::GetCellBounds(int Level, int i, int j) const
+{
+	return Levels[Level][i * Sizes[Level] + j];
+}
+
+__forceinline glm::vec4 GHeightPyramid::GetCellRegion(int Level, int i, int j) const
+{
+	int Cells = 2 * Vertices;
+	int FirstI = i << Level;
+	int FirstJ = j << Level;
+	int LastI = glm::min((i + 1) << Level, Cells);
+	int LastJ = glm::min((j + 1) << Level, Cells);
+	return SeparationFactor * glm::vec4((float)(FirstJ - Vertices), (float)(Vertices - LastI), (float)(LastJ - Vertices), (float)(Vertices - FirstI));
+}
+
+__forceinline void GHeightPyramid::Delete()
+{
+	if (Builder.joinable())
+	{
+		Builder.join();
+	}
+}
+
+__forceinline void GHeightPyramid::Build(float InTime)
+{
+	auto Start = std::chrono::high_resolution_clock::now();
+
+	// Fbm of every grid vertex, whole rows per thread
+	int Size = 2 * Vertices + 1;
+	int VerticesCount = Size * Size;
+	std::vector<float> X(VerticesCount), Y(VerticesCount), Fbm(VerticesCount);
+	for (int i = 0; i < Size; ++i)
+	{
+		for (int j = 0; j < Size; ++j)
+		{
+			X[i * Size + j] = SeparationFactor * (j - Vertices);
+			Y[i * Size + j] = SeparationFactor * (Vertices - i);
+		}
+	}
+
+	int ThreadsCount = glm::max(1, (int)std::thread::hardware_concurrency() - 1);
+	int RowsPerThread = (Size + ThreadsCount - 1) / ThreadsCount;
+	std::vector<std::thread> Threads;
+	for (int t = 0; t < ThreadsCount; ++t)
+	{
+		int First = t * RowsPerThread * Size;
+		int Count = std::min(RowsPerThread * Size, VerticesCount - First);
+		if (Count <= 0)
+		{
+			break;
+		}
+		Threads.emplace_back(Fbm9Batch, X.data() + First, Y.data() + First, Fbm.data() + First, Count, InTime, GetNoiseISA());
+	}
+	for (std::thread &Thread : Threads)
+	{
+		Thread.join();
+	}
+
+	// Each cell bounds its two triangles. The GPU evaluates the fbm with its own rounding, hence the margin.
+	const float Margin = 0.01f;
+	BuildLevels.resize(Sizes.size());
+	BuildLevels[0].resize(Sizes[0] * Sizes[0]);
+	for (int i = 0; i < Sizes[0]; ++i)
+	{
+		for (int j = 0; j < Sizes[0]; ++j)
+		{
+			float Corner0 = Fbm[i * Size + j];
+			float Corner1 = Fbm[i * Size + j + 1];
+			float Corner2 = Fbm[(i + 1) * Size + j];
+			float Corner3 = Fbm[(i + 1) * Size + j + 1];
+			BuildLevels[0][i * Sizes[0] + j] = glm::vec2(std::min({ Corner0, Corner1, Corner2, Corner3 }) - Margin, std::max({ Corner0, Corner1, Corner2, Corner3 }) + Margin);
+		}
+	}
+
+	for (size_t Level = 1; Level < Sizes.size(); ++Level)
+	{
+		int Previous = Sizes[Level - 1];
+		BuildLevels[Level].resize(Sizes[Level] * Sizes[Level]);
+		for (int i = 0; i < Sizes[Level]; ++i)
+		{
+			for (int j = 0; j < Sizes[Level]; ++j)
+			{
+				glm::vec2 Bounds(FLT_MAX, -FLT_MAX);
+				for (int Child = 0; Child < 4; ++Child)
+				{
+					int ChildI = 2 * i + Child / 2;
+					int ChildJ = 2 * j + Child % 2;
+					if (ChildI < Previous && ChildJ < Previous)
+					{
+						glm::vec2 ChildBounds = BuildLevels[Level - 1][ChildI * Previous + ChildJ];
+						Bounds.x = glm::min(Bounds.x, ChildBounds.x);
+						Bounds.y = glm::max(Bounds.y, ChildBounds.y);
+					}
+				}
+				BuildLevels[Level][i * Sizes[Level] + j] = Bounds;
+			}
+		}
+	}
+
+	auto End = std::chrono::high_resolution_clock::now();
+	BuildDuration = std::chrono::duration<float, std::milli>(End - Start).count();
+	bBuilt = true;
+}
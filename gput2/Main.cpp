@@ -1,6 +1,7 @@
 ﻿#include <iostream>
 #include <algorithm>
 #include <string>
+#include <unordered_map>
 #include <sstream>
 #include <utility>
 
@@ -14,14 +15,33 @@
 #include "Shader.h"
 #include "Camera.h"
 #include "Utils.h"
+#include "Noise.h"
+#include "GpuTimer.h"
+#include "GpuCounter.h"
+#include "Terrain.h"
+#include "TerrainCache.h"
+#include "HeightMap.h"
+#include "TerrainQuadtree.h"
+#include "TerrainClipmap.h"
+#include "TerrainTiles.h"
+#include "TerrainPatches.h"
+#include "HeightPyramid.h"
+#include "TerrainOcclusion.h"
+#include "UniformBlocks.h"
+#include "ClusteredLights.h"
+#include "Deferred.h"
+#include "ShadowCascades.h"
+#include "HeightMaxPyramid.h"
+#include "SceneState.h"
+#include "ShaderWatcher.h"
+#include "ShaderSources.h"
+#include "TextureLoader.h"
 
 #include "imgui/imgui.h"
 #include "imgui/imgui_internal.h"
 #include "imgui/imgui_impl_glfw.h"
 #include "imgui/imgui_impl_opengl3.h"
 
-#include "resource.h"
-
 // Show console
 //#define  _CONSOLE
 
@@ -43,7 +63,9 @@ EState CurrentState = EState::OnGame;
 void Init(GLFWwindow* &Window, const char* Title);
 void ArrowInit(unsigned int &VAO, unsigned int &VBO, unsigned int &EBO, int &ArrowIndicesSize, int Vertices, float Radius, float Legth, void(*Generate)(float*&, int*&, int, float, float, int&, int&, bool));
 void PointLightInit(unsigned int &VAO, unsigned int &VBO, unsigned int &EBO, int &PointLightIndicesSize, int Segments, int Rings, float Radius, void(*Generate)(float*&, int*&, int, int, float, int&, int&));
-void GridInit(unsigned int &GridVAO, unsigned int &GridVBO, unsigned int &GridEBO, int &GridIndicesSize, float &SeparationFactor);
+void ClusteredMarkersInit(unsigned int &VAO, unsigned int &InstancesVBO, unsigned int VBO, unsigned int EBO);
+void GridInit(unsigned int &GridVAO, int Cells, int &GridVertices, float &SeparationFactor);
+void DrawGridStrips(const GShader &Shader, const FTerrainHandles &Handles, int Cells);
 
 // Callbacks
 void FramebufferSizeCallback(GLFWwindow* Window, int Width, int Height);
@@ -54,6 +76,16 @@ void ScrollCallback(GLFWwindow* Window, double OffsetX, double OffsetY);
 void ProcessInput(GLFWwindow *Window);
 void ErrorCallback(int Error, const char* Description);
 
+// Noise
+FNoiseParity NoiseParityCheck(GShader &FeedbackShader, FTerrainHandles &FeedbackHandles, float Width, float Height, float Time, float SeparationFactor, int Samples);
+float MeasureDrawMilliseconds(const GShader &Shader, const FTerrainHandles &Handles, int Cells, int Repetitions);
+
+// Lights
+void AnimateClusteredLights(std::vector<FClusteredLight> &Lights, int Count, float Height, float Time);
+
+// Meshes
+std::vector<FMeshCacheReport> VertexCacheReport(int GridPatchQuads);
+
 // ImGui
 bool SliderRotation(const char* label, void* v);
 void ShowHelp();
@@ -75,10 +107,39 @@ float TerrainTime = 10.f;
 bool bShowHelp = true;
 float FPSValues[120] = { 0 };
 int FPSValuesOffset = 0;
+float TerrainMilliseconds = 0.f;
+float LightingMilliseconds = 0.f;
+float PrePassMilliseconds = 0.f;
+// Samples that passed the depth test in the terrain draws over the pixels of the framebuffer
+float FragmentsPerPixel = 0.f;
+float PrePassFragmentsPerPixel = 0.f;
+FCullingStats TerrainCulling = { 0, 0, 0, 0, 0, 0 };
+// What the last frame sent to the shaders
+struct FUploadStats
+{
+	int NameLookups;
+	int Uniforms;
+	int Blocks;
+	int BlockBytes;
+	unsigned int SceneVersion;
+	int SceneFieldsChanged;
+};
+FUploadStats Uploads = { 0, 0, 0, 0, 0, 0 };
+
+// Sources of a program in the Shaders folder, edited ones are rebuilt while running
+struct FShaderFiles
+{
+	GShader* Shader;
+	const FShaderSource* Vertex;
+	const FShaderSource* Fragment;
+	// Spliced in the fragment shader, NULL without it
+	const FShaderSource* FragmentInclude;
+};
 
 bool bDLDemo = false;
 bool bPLDemo = false;
 bool bSLDemo = false;
+bool bCLDemo = false;
 
 #ifdef _CONSOLE
 int main()
@@ -89,15 +150,78 @@ int CALLBACK WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLi
 	GLFWwindow* Window;
 	Init(Window, u8"(/· - ·)/");
 
+	// As many driver threads as it wants for the programs built in the background
+	if (GShader::IsParallelCompileSupported())
+	{
+		typedef void (APIENTRY *FMaxShaderCompilerThreads)(GLuint Count);
+		FMaxShaderCompilerThreads MaxShaderCompilerThreads = (FMaxShaderCompilerThreads)glfwGetProcAddress("glMaxShaderCompilerThreadsKHR");
+		if (!MaxShaderCompilerThreads)
+		{
+			MaxShaderCompilerThreads = (FMaxShaderCompilerThreads)glfwGetProcAddress("glMaxShaderCompilerThreadsARB");
+		}
+		if (MaxShaderCompilerThreads)
+		{
+			MaxShaderCompilerThreads(0xFFFFFFFF);
+		}
+	}
+
 	// Shaders
 	//GShader ArrowShader("Shaders/Arrow.vert", "Shaders/Arrow.frag");
 	//GShader PointLightShader("Shaders/PointLight.vert", "Shaders/PointLight.frag");
 	//GShader TerrainShader("Shaders/Terrain.vert", "Shaders/Terrain.frag");
 
-	// To create stand-alone .exe
+	// Embedded by EmbedShaders.py, the stand-alone .exe reads no files
 	GShader ArrowShader(ArrowVert, ArrowFrag);
 	GShader PointLightShader(PointLightVert, PointLightFrag);
-	GShader TerrainShader(TerrainVert, TerrainFrag);
+	// The lit programs share the lights and shadows of Lighting.glsl
+	GShader TerrainShader(TerrainVert, TerrainFrag, LightingGlsl);
+	GShader TerrainCachedShader(TerrainCachedVert, TerrainFrag, LightingGlsl);
+	GShader DeferredLightShader(DeferredLightVert, DeferredLightFrag, LightingGlsl);
+	GShader DeferredVolumeShader(DeferredVolumeVert, DeferredVolumeFrag);
+	GShader ShadowShader(ShadowVert, ShadowFrag);
+
+	// Captures the displaced terrain vertices, used to compare the CPU noise against the vertex shader
+	const char* TerrainFeedbackVaryings[] = { "FPosition", "FNormal" };
+	GShader TerrainFeedbackShader(TerrainVert, TerrainFrag, LightingGlsl, TerrainFeedbackVaryings, 2);
+
+	// Cold start cost, the binary cache makes the second launch skip the GLSL compiler
+	const FShaderLoads ShadersCompiled = GShader::Compiled;
+	const FShaderLoads ShadersCached = GShader::Cached;
+	std::cout << "Shaders compiled: " << ShadersCompiled.Count << " (" << ShadersCompiled.Milliseconds << " ms), from cache: " << ShadersCached.Count << " (" << ShadersCached.Milliseconds << " ms)" << std::endl;
+
+	// Camera and lights shared by every program, sent at most once per frame. Every program binds them once linked.
+	GUniformBlock CameraBlock(EUniformBlock::Camera, sizeof(FCameraBlock));
+	GUniformBlock LightsBlock(EUniformBlock::Lights, sizeof(FLightsBlock));
+	GUniformBlock ClustersBlock(EUniformBlock::Clusters, sizeof(FClustersBlock));
+	GUniformBlock ShadowsBlock(EUniformBlock::Shadows, sizeof(FShadowsBlock));
+	FLightsBlock Lights = {};
+	PointLightShader.SetOnLink([](GShader &Shader) { BindUniformBlocks(Shader); });
+
+	// Rebuilt in the background when their files change, the running programs stay until the new ones link
+	GShaderWatcher ShaderWatcher("Shaders");
+	const FShaderFiles ShaderFiles[] =
+	{
+		{ &ArrowShader, &ArrowVert, &ArrowFrag, NULL },
+		{ &PointLightShader, &PointLightVert, &PointLightFrag, NULL },
+		{ &TerrainShader, &TerrainVert, &TerrainFrag, &LightingGlsl },
+		{ &TerrainCachedShader, &TerrainCachedVert, &TerrainFrag, &LightingGlsl },
+		{ &TerrainFeedbackShader, &TerrainVert, &TerrainFrag, &LightingGlsl },
+		{ &DeferredLightShader, &DeferredLightVert, &DeferredLightFrag, &LightingGlsl },
+		{ &DeferredVolumeShader, &DeferredVolumeVert, &DeferredVolumeFrag, NULL },
+		{ &ShadowShader, &ShadowVert, &ShadowFrag, NULL }
+	};
+	int ShaderReloads = 0;
+	int ShaderSwaps = 0;
+
+	// Uniforms set every frame outside the blocks, by location
+	FUniform ArrowModel = ArrowShader.GetUniform("UModel");
+	FUniform ArrowLightPosition = ArrowShader.GetUniform("USpotLight.Position");
+	FUniform ArrowLightDirection = ArrowShader.GetUniform("USpotLight.Direction");
+	FUniform PointLightModel = PointLightShader.GetUniform("UModel");
+	FUniform DeferredLightInverse = DeferredLightShader.GetUniform("UInverseViewProjection");
+	FUniform DeferredVolumeInverse = DeferredVolumeShader.GetUniform("UInverseViewProjection");
+	FUniform ShadowLightSpace = ShadowShader.GetUniform("ULightSpace");
+	FTerrainHandles TerrainFeedbackHandles(TerrainFeedbackShader);
 
 	//// Directional Light Arrow
 	//  Cylinder
@@ -112,79 +236,191 @@ int CALLBACK WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLi
 
 	///// Terrain
 	// Grid
-	unsigned int GridVAO, GridVBO, GridEBO;
-	int GridIndicesSize;
+	unsigned int GridVAO;
+	int GridVertices;
 	float SeparationFactor;
-	GridInit(GridVAO, GridVBO, GridEBO, GridIndicesSize, SeparationFactor);
+	const int GridPatchQuads = 50;
+	int GridResolution = 1; // 10 << GridResolution patches per side
+	GridInit(GridVAO, (10 << GridResolution) * GridPatchQuads, GridVertices, SeparationFactor);
 
-	// PointLight
-	unsigned int PointLightVAO, PointLightVBO, PointLightEBO;
-	int PointLightIndicesSize;
-	PointLightInit(PointLightVAO, PointLightVBO, PointLightEBO, PointLightIndicesSize, 32, 16, 1.f, GenerateSphere);
+	// One patch template instanced over the grid, a patch per culling tile
+	GTerrainPatches TerrainPatches(GridPatchQuads, 10 << GridResolution);
+	GTerrainTiles TerrainTiles(GridVertices, SeparationFactor, GridPatchQuads);
 
-	ArrowShader.Use();
+	// Fbm bounds of the grid, the culling skips the tiles hidden behind the terrain
+	GHeightPyramid HeightPyramid(GridVertices, SeparationFactor);
+	GTerrainOcclusion TerrainOcclusion;
 
-	ArrowShader.Set3f("UMaterial.Ambient", 0.1745f, 0.01175f, 0.01175f);
-	ArrowShader.Set3f("UMaterial.Diffuse", 0.61424f, 0.04136f, 0.04136f);
-	ArrowShader.Set3f("UMaterial.Specular", 0.727811f, 0.626959f, 0.626959f);
-	ArrowShader.Set1f("UMaterial.Shininess", 76.8f);
+	// Displaced grid reused while the terrain doesn't change
+	GTerrainCache TerrainCache(TerrainPatches);
 
-	ArrowShader.SetVec3("USpotLight.Light.Ambient", glm::vec3(1.f));
-	ArrowShader.SetVec3("USpotLight.Light.Diffuse", glm::vec3(1.f));
-	ArrowShader.SetVec3("USpotLight.Light.Specular", glm::vec3(1.f));
-	ArrowShader.Set1f("USpotLight.Constant", 1.f);
-	ArrowShader.Set1f("USpotLight.Linear", 0.09f);
-	ArrowShader.Set1f("USpotLight.Quadratic", 0.032f);
-	ArrowShader.Set1f("USpotLight.CutOff", glm::cos(glm::radians(12.5f)));
-	ArrowShader.Set1f("USpotLight.OuterCutOff", glm::cos(glm::radians(15.f)));
+	// Baked fbm, covers the whole grid
+	GHeightMap HeightMap(1024, 5.f);
 
-	TerrainShader.Use();
-	TerrainShader.Set3f("UMaterial.Specular", 0.333333f, 0.333333f, 0.333333f);
-	TerrainShader.Set3f("UMaterial.Emission", 1.f, 0.f, 0.f);
-	TerrainShader.Set1f("UMaterial.Shininess", 9.84615f);
+	// Level of detail over a terrain much larger than the grid
+	GTerrainQuadtree TerrainQuadtree(32, 1.f, 10);
 
-	TerrainShader.Set1f("USeparationFactor", SeparationFactor);
+	// Rings around the camera, never runs out of terrain
+	GTerrainClipmap TerrainClipmap(32, 1.f / 16.f, 10);
+
+	// PointLight
+	unsigned int PointLightVAO, PointLightVBO, PointLightEBO;
+	int PointLightIndicesSize;
+	PointLightInit(PointLightVAO, PointLightVBO, PointLightEBO, PointLightIndicesSize, 32, 16, 1.f, GenerateSphere);
+
+	// Clustered point lights in 16x9 tiles by 24 slices, each drawn as a small instance of the point light sphere
+	GClusteredLights ClusteredLights(16, 9, 24);
+	int ClusteredLightsCount = 1024;
+	float ClusteredLightsTime = 0.f;
+	bool bClusteredLightsMotion = true;
+	bool bClusteredMarkers = true;
+	std::vector<glm::vec4> ClusteredMarkers;
+	unsigned int ClusteredMarkersVAO, ClusteredMarkersVBO;
+	ClusteredMarkersInit(ClusteredMarkersVAO, ClusteredMarkersVBO, PointLightVBO, PointLightEBO);
+
+	ArrowShader.SetOnLink([](GShader &Shader)
+	{
+		BindUniformBlocks(Shader);
+		Shader.Set3f("UMaterial.Ambient", 0.1745f, 0.01175f, 0.01175f);
+		Shader.Set3f("UMaterial.Diffuse", 0.61424f, 0.04136f, 0.04136f);
+		Shader.Set3f("UMaterial.Specular", 0.727811f, 0.626959f, 0.626959f);
+		Shader.Set1f("UMaterial.Shininess", 76.8f);
+
+		Shader.SetVec3("USpotLight.Light.Ambient", glm::vec3(1.f));
+		Shader.SetVec3("USpotLight.Light.Diffuse", glm::vec3(1.f));
+		Shader.SetVec3("USpotLight.Light.Specular", glm::vec3(1.f));
+		Shader.Set1f("USpotLight.Constant", 1.f);
+		Shader.Set1f("USpotLight.Linear", 0.09f);
+		Shader.Set1f("USpotLight.Quadratic", 0.032f);
+		Shader.Set1f("USpotLight.CutOff", glm::cos(glm::radians(12.5f)));
+		Shader.Set1f("USpotLight.OuterCutOff", glm::cos(glm::radians(15.f)));
+	});
+
+	// Terrain programs and their permutations, set up once they link
+	auto TerrainSetup = [&](GShader &Shader)
+	{
+		BindUniformBlocks(Shader);
+		Shader.Set3f("UMaterial.Specular", 0.333333f, 0.333333f, 0.333333f);
+		Shader.Set3f("UMaterial.Emission", 1.f, 0.f, 0.f);
+		Shader.Set1f("UMaterial.Shininess", 9.84615f);
+
+		Shader.Set1f("USeparationFactor", SeparationFactor);
+		Shader.Set1i("UHeightMap", 0);
+		Shader.Set1f("UHeightMapRange", HeightMap.Range);
+		Shader.Set1i("UGridVertices", GridVertices);
+
+		Shader.Set1i("UClusterLights", 1);
+		Shader.Set1i("UClusterRanges", 2);
+		Shader.Set1i("UClusterIndices", 3);
+		Shader.Set1i("UShadowMap", 7);
+		Shader.Set1i("UShadowHeights", 8);
+	};
+	TerrainShader.SetOnLink(TerrainSetup);
+	TerrainCachedShader.SetOnLink(TerrainSetup);
+
+	auto TerrainFeedbackSetup = [&](GShader &Shader)
+	{
+		BindUniformBlocks(Shader);
+		Shader.Set1i("UGridVertices", GridVertices);
+		Shader.Set1i("UHeightMap", 0);
+		Shader.Set1f("UHeightMapRange", HeightMap.Range);
+	};
+	TerrainFeedbackShader.SetOnLink(TerrainFeedbackSetup);
+
+	// Terrain material and G-buffer units of the deferred lights
+	auto DeferredSetup = [](GShader &Shader)
+	{
+		BindUniformBlocks(Shader);
+		Shader.Set3f("UMaterial.Specular", 0.333333f, 0.333333f, 0.333333f);
+		Shader.Set1f("UMaterial.Shininess", 9.84615f);
+
+		Shader.Set1i("UAlbedo", 4);
+		Shader.Set1i("UNormal", 5);
+		Shader.Set1i("UDepth", 6);
+		Shader.Set1i("UShadowMap", 7);
+		Shader.Set1i("UShadowHeights", 8);
+		Shader.Set1i("UHeightMap", 0);
+	};
+	DeferredLightShader.SetOnLink(DeferredSetup);
+	DeferredVolumeShader.SetOnLink(DeferredSetup);
+
+	// G-buffer of the deferred path, sized on first use
+	GDeferred Deferred;
+
+	// Shadows of the directional light, the cascades drawn from the cached terrain vertices, or the march over the pyramid
+	// of the baked heights
+	ETerrainShadows TerrainShadows = ETerrainShadows::Cascades;
+	int ShadowCascadesCount = 3;
+	int ShadowResolution = 2; // 512 << ShadowResolution
+	float ShadowDistance = 100.f;
+	GShadowCascades ShadowCascades(ShadowCascadesCount, 512 << ShadowResolution);
+	std::vector<int> ShadowTiles;
+	int HeightfieldSteps = 64;
+	GHeightMaxPyramid HeightMaxPyramid;
+
+	// Textures decoded by workers and sent through 3 buffers of 4 MB, the loop only polls them
+	GTextureLoader TextureLoader(3, 4 << 20);
+	std::vector<FTextureHandle> Textures;
+	float LongestLoadingFrame = 0.f;
+
+	// Terrain permutations, the defines of the active lights and normals are rebuilt when those change
+	bool bTerrainPermutations = true;
+	std::string TerrainDefines;
+	std::string TerrainGBufferDefines;
+	std::string TerrainDepthDefines;
+	std::string TerrainOverdrawDefines;
+	// A single set per GL program, GetPermutation returns the base program while a permutation builds, so the values
+	// SetTerrainUniforms skips are always the ones the program holds
+	std::unordered_map<const GShader*, FTerrainHandles> TerrainProgramHandles;
+	auto GetTerrainHandles = [&](const GShader &Shader) -> FTerrainHandles&
+	{
+		return TerrainProgramHandles.try_emplace(&Shader, Shader).first->second;
+	};
 
 	//// ImGui variables
 	ImVec4 ClearColor = ImVec4(0.45f, 0.55f, 0.60f, 1.00f);
 
-	// Direction Light
-	bool bUseDirectionalLight = true;
-	glm::vec2 DLDirection(0.f, -45.f);
-	glm::vec3 DLAmbient(0.5f);
-	glm::vec3 DLDiffuse(0.5f);
-	glm::vec3 DLSpectular(0.5f);
-
-	// Point Light
-	bool bUsePointLight = true;
-	glm::vec3 PLPosition(0.f, 7.f, 10.f);
-	glm::vec3 PLAmbient(0.25f);
-	glm::vec3 PLDiffuse(0.75f);
-	glm::vec3 PLSpectular(1.f);
-	float PLConstant = 1.f;
-	float PLLinear = 0.022f;
-	float PLQuadratic = 0.0019f;
-
-	// Spot Light
-	bool bUseSpotLight = true;
-	glm::vec3 SLAmbient(0.f);
-	glm::vec3 SLDiffuse(1.f);
-	glm::vec3 SLSpectular(1.f);
-	float SLConstant = 1.f;
-	float SLLinear = 0.09f;
-	float SLQuadratic = 0.032f;
-	float SLCutOff = 12.5f;
-	float SLOuterCutOff = 15.f;
+	// Lights and terrain, sent to the GPU only when they change
+	GSceneState Scene;
 
 	// Terrain
 	bool bTerrainWireframe = false;
 	bool bTerrainLiveMotion = false;
 	float TerrainMotionSpeed = 1.f;
-	float Lenght = 10.f;
-	float UHeight = 10.f;
+	ETerrainGeometry TerrainGeometry = ETerrainGeometry::Grid;
+	ETerrainShading TerrainShading = ETerrainShading::Forward;
+	bool bTerrainDepthPrePass = false;
+	bool bTerrainOverdraw = false;
+	int ClipmapCellSize = 2; // 1 / (64 >> ClipmapCellSize)
+	bool bTerrainCached = false;
+	bool bTerrainPatches = true;
+	bool bTerrainCulling = true;
+	bool bTerrainOcclusion = true;
+	bool bTerrainBaked = false;
+	int HeightMapResolution = 1; // 512 << HeightMapResolution
+	bool bTerrainBenchmark = false;
+	float ProceduralMilliseconds = 0.f;
+	float BakedMilliseconds = 0.f;
+
+	GGpuTimer TerrainTimer;
+	GGpuTimer LightingTimer;
+	GGpuTimer PrePassTimer;
+	GGpuCounter TerrainFragments;
+	GGpuCounter PrePassFragments;
+
+	// CPU Noise
+	const ENoiseISA NoiseISAs[] = { ENoiseISA::Scalar, ENoiseISA::SSE2, ENoiseISA::AVX2 };
+	double NoiseThroughput[3] = { 0.0 };
+	FNoiseParity NoiseParity = {};
+	bool bNoiseParity = false;
+
+	// Vertex cache
+	std::vector<FMeshCacheReport> MeshCacheReports;
 
 	float CameraSpeed = Camera.MovementSpeed;
 
+	GShader::NameLookups = 0;
+	GShader::Uploads = 0;
 	while (!glfwWindowShouldClose(Window))
 	{
 		ImGui::CaptureMouseFromApp(false);
@@ -198,6 +434,52 @@ int CALLBACK WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLi
 			ShowHelp();
 		}
 
+		// Edited shaders
+		for (const std::string &File : ShaderWatcher.Poll())
+		{
+			for (const FShaderFiles &Files : ShaderFiles)
+			{
+				std::string Vertex, Fragment, Include;
+				bool bInclude = Files.FragmentInclude != NULL;
+				if ((File == Files.Vertex->Name || File == Files.Fragment->Name || (bInclude && File == Files.FragmentInclude->Name)) &&
+					ShaderWatcher.Read(Files.Vertex->Name, Vertex) && ShaderWatcher.Read(Files.Fragment->Name, Fragment) && (!bInclude || ShaderWatcher.Read(Files.FragmentInclude->Name, Include)))
+				{
+					if (bInclude)
+					{
+						Fragment = GShader::IncludeSource(Fragment, Include);
+					}
+					Files.Shader->Reload(Vertex.c_str(), Fragment.c_str());
+					++ShaderReloads;
+				}
+			}
+		}
+		if (TextureLoader.GetPendingCount() > 0)
+		{
+			LongestLoadingFrame = glm::max(LongestLoadingFrame, DeltaTime * 1000.f);
+		}
+		TextureLoader.Update();
+
+		bool bShadersSwapped = false;
+		for (const FShaderFiles &Files : ShaderFiles)
+		{
+			bShadersSwapped = Files.Shader->Update() || bShadersSwapped;
+		}
+		if (bShadersSwapped)
+		{
+			// The new programs may have moved their uniforms
+			++ShaderSwaps;
+			ArrowModel = ArrowShader.GetUniform("UModel");
+			ArrowLightPosition = ArrowShader.GetUniform("USpotLight.Position");
+			ArrowLightDirection = ArrowShader.GetUniform("USpotLight.Direction");
+			PointLightModel = PointLightShader.GetUniform("UModel");
+			DeferredLightInverse = DeferredLightShader.GetUniform("UInverseViewProjection");
+			DeferredVolumeInverse = DeferredVolumeShader.GetUniform("UInverseViewProjection");
+			ShadowLightSpace = ShadowShader.GetUniform("ULightSpace");
+			TerrainFeedbackHandles = FTerrainHandles(TerrainFeedbackShader);
+			TerrainProgramHandles.clear();
+			TerrainCache.Invalidate();
+		}
+
 		if (CurrentState == EState::OnMenu)
 		{
 			// Main GUI
@@ -212,46 +494,237 @@ int CALLBACK WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLi
 				ImGui::Checkbox("Wireframe", &bTerrainWireframe); ImGui::SameLine(ImGui::GetContentRegionAvailWidth() > 300 ? 150 : ImGui::GetContentRegionAvailWidth() * 0.5f);
 				ImGui::Checkbox("Live motion", &bTerrainLiveMotion);
 				ImGui::SliderFloat("Motion Speed", &TerrainMotionSpeed, -2.5f, 2.5f);
-				ImGui::SliderFloat("Lenght", &Lenght, 0.f, 100.f);
-				ImGui::SliderFloat("Height", &UHeight, 0.f, 100.f);
+				ImGui::SliderFloat("Lenght", &Scene.Lenght, 0.f, 100.f);
+				ImGui::SliderFloat("Height", &Scene.UHeight, 0.f, 100.f);
+				ImGui::Combo("Normals", (int*)&Scene.TerrainNormals, "Finite differences\0Analytic\0Difference\0");
+				ImGui::Combo("Geometry", (int*)&TerrainGeometry, "Grid\0Quadtree LOD\0Clipmap\0");
+				ImGui::Combo("Shading", (int*)&TerrainShading, "Forward\0Deferred\0");
+				ImGui::Checkbox("Depth pre-pass", &bTerrainDepthPrePass); ImGui::SameLine(ImGui::GetContentRegionAvailWidth() > 300 ? 150 : ImGui::GetContentRegionAvailWidth() * 0.5f);
+				ImGui::Checkbox("Overdraw", &bTerrainOverdraw);
+				ImGui::Text("Terrain GPU: %.3f ms, pre-pass: %.3f ms, deferred lights: %.3f ms", TerrainMilliseconds, PrePassMilliseconds, LightingMilliseconds);
+				ImGui::Text("Fragments per pixel: %.2f, pre-pass: %.2f", FragmentsPerPixel, PrePassFragmentsPerPixel);
+				if (TerrainGeometry == ETerrainGeometry::Grid && ImGui::TreeNode("Grid"))
+				{
+					if (ImGui::Combo("Resolution", &GridResolution, "500\0" "1000\0" "2000\0"))
+					{
+						GridVertices = (10 << GridResolution) * GridPatchQuads / 2;
+						SeparationFactor = GetGridSeparationFactor(GridVertices, 5.f);
+
+						TerrainPatches.Delete();
+						TerrainPatches = GTerrainPatches(GridPatchQuads, 10 << GridResolution);
+						TerrainTiles = GTerrainTiles(GridVertices, SeparationFactor, GridPatchQuads);
+						if (HeightMap.Bakes > 0)
+						{
+							TerrainTiles.UpdateBakedBounds(HeightMap);
+						}
+						HeightPyramid.SetGrid(GridVertices, SeparationFactor);
+						TerrainCache.Delete();
+						TerrainCache = GTerrainCache(TerrainPatches);
+
+						TerrainShader.SetOnLink(TerrainSetup);
+						TerrainCachedShader.SetOnLink(TerrainSetup);
+						TerrainFeedbackShader.SetOnLink(TerrainFeedbackSetup);
+					}
+					ImGui::Checkbox("Instanced patches", &bTerrainPatches); ImGui::SameLine(ImGui::GetContentRegionAvailWidth() > 300 ? 150 : ImGui::GetContentRegionAvailWidth() * 0.5f);
+					ImGui::Text("Patches: %d", TerrainPatches.GetPatchesCount());
+					ImGui::TreePop();
+				}
+				if (TerrainGeometry == ETerrainGeometry::Quadtree && ImGui::TreeNode("Quadtree LOD"))
+				{
+					ImGui::SliderFloat("Error Threshold", &TerrainQuadtree.ErrorThreshold, 1.f, 64.f, "%.1f px");
+					ImGui::SliderInt("Levels", &TerrainQuadtree.Levels, 1, 16);
+					ImGui::SliderFloat("Leaf Size", &TerrainQuadtree.LeafSize, 0.25f, 8.f);
+					ImGui::SliderFloat("Morph Start", &TerrainQuadtree.MorphStartRatio, 0.f, 0.95f);
+					ImGui::Text("Terrain size: %.0f, view distance: %.0f", TerrainQuadtree.GetRootSize(), TerrainQuadtree.GetViewDistance());
+					ImGui::Text("Nodes: %d, triangles: %d", TerrainQuadtree.NodesCount, TerrainQuadtree.TrianglesCount);
+					ImGui::TreePop();
+				}
+				if (TerrainGeometry == ETerrainGeometry::Clipmap && ImGui::TreeNode("Clipmap"))
+				{
+					if (ImGui::Combo("Cell Size", &ClipmapCellSize, "1/64\0" "1/32\0" "1/16\0" "1/8\0" "1/4\0"))
+					{
+						TerrainClipmap.CellSize = 1.f / (float)(64 >> ClipmapCellSize);
+					}
+					ImGui::SliderInt("Levels", &TerrainClipmap.Levels, 1, 16);
+					ImGui::SliderInt("Transition", &TerrainClipmap.TransitionWidth, 1, 31);
+					ImGui::Text("View distance: %.0f", TerrainClipmap.GetViewDistance());
+					ImGui::Text("Levels drawn: %d, triangles: %d", TerrainClipmap.LevelsDrawn, TerrainClipmap.TrianglesCount);
+					ImGui::TreePop();
+				}
+				ImGui::Checkbox("Frustum culling", &bTerrainCulling); ImGui::SameLine(ImGui::GetContentRegionAvailWidth() > 300 ? 150 : ImGui::GetContentRegionAvailWidth() * 0.5f);
+				ImGui::Text("Tiles culled: %d", TerrainCulling.TilesCulled);
+				ImGui::Checkbox("Occlusion culling", &bTerrainOcclusion); ImGui::SameLine(ImGui::GetContentRegionAvailWidth() > 300 ? 150 : ImGui::GetContentRegionAvailWidth() * 0.5f);
+				ImGui::Text("Tiles occluded: %d", TerrainCulling.TilesOccluded);
+				ImGui::Text("Pyramid builds: %d (%.1f ms)%s", HeightPyramid.Builds, HeightPyramid.BuildMilliseconds, HeightPyramid.IsValid(TerrainTime) ? "" : ", building");
+				ImGui::Checkbox("Cached geometry", &bTerrainCached); ImGui::SameLine(ImGui::GetContentRegionAvailWidth() > 300 ? 150 : ImGui::GetContentRegionAvailWidth() * 0.5f);
+				ImGui::Text("Captures: %d", TerrainCache.Captures);
+				ImGui::Checkbox("Baked heights", &bTerrainBaked); ImGui::SameLine(ImGui::GetContentRegionAvailWidth() > 300 ? 150 : ImGui::GetContentRegionAvailWidth() * 0.5f);
+				ImGui::Text("Bakes: %d (%.1f ms)", HeightMap.Bakes, HeightMap.BakeMilliseconds);
+				if (ImGui::Combo("Bake Resolution", &HeightMapResolution, "512\0" "1024\0" "2048\0" "4096\0"))
+				{
+					HeightMap.SetResolution(512 << HeightMapResolution);
+				}
+				if (ImGui::Button("Benchmark Heights"))
+				{
+					bTerrainBenchmark = true;
+				}
+				ImGui::SameLine();
+				ImGui::Text("Procedural: %.3f ms, Baked: %.3f ms", ProceduralMilliseconds, BakedMilliseconds);
+				if (ImGui::TreeNode("CPU Noise"))
+				{
+					ImGui::Text("Dispatch: %s", GetNoiseISAName(GetNoiseISA()));
+					if (ImGui::Button("Benchmark"))
+					{
+						for (int i = 0; i < IM_ARRAYSIZE(NoiseISAs); ++i)
+						{
+							NoiseThroughput[i] = IsNoiseISASupported(NoiseISAs[i]) ? Fbm9Benchmark(NoiseISAs[i]) : 0.0;
+						}
+					}
+					for (int i = 0; i < IM_ARRAYSIZE(NoiseISAs); ++i)
+					{
+						ImGui::Text("%-6s %8.2f Mpoints/s per core", GetNoiseISAName(NoiseISAs[i]), NoiseThroughput[i] / 1e6);
+					}
+					if (ImGui::Button("Check GPU parity"))
+					{
+						NoiseParity = NoiseParityCheck(TerrainFeedbackShader, TerrainFeedbackHandles, Scene.Lenght, Scene.UHeight, TerrainTime, SeparationFactor, 1 << 14);
+						bNoiseParity = true;
+					}
+					if (bNoiseParity)
+					{
+						ImGui::SameLine();
+						ImGui::Text("%s, tolerance %g height, %g deg", NoiseParity.bPass ? "Pass" : "FAIL", NoiseParityHeightTolerance * Scene.UHeight, NoiseParityNormalTolerance);
+						for (int i = 0; i < IM_ARRAYSIZE(NoiseISAs); ++i)
+						{
+							if (NoiseParity.HeightErrors[i] >= 0.f)
+							{
+								ImGui::Text("%-6s fbm_9 height error: %g", GetNoiseISAName(NoiseISAs[i]), NoiseParity.HeightErrors[i]);
+							}
+						}
+						ImGui::Text("Scalar fbmd_9 height error: %g, normal error: %g deg", NoiseParity.FbmdHeightError, NoiseParity.NormalError);
+					}
+					ImGui::TreePop();
+				}
+				if (ImGui::TreeNode("Vertex Cache"))
+				{
+					if (ImGui::Button("Report"))
+					{
+						MeshCacheReports = VertexCacheReport(GridPatchQuads);
+					}
+					for (const FMeshCacheReport &Report : MeshCacheReports)
+					{
+						ImGui::Text("%-14s ACMR %.3f -> %.3f, ATVR %.3f -> %.3f", Report.Name, Report.Before.ACMR, Report.After.ACMR, Report.Before.ATVR, Report.After.ATVR);
+					}
+					ImGui::TreePop();
+				}
 			}
 			if (!ImGui::CollapsingHeader("Directional Light"))
 			{
 				ImGui::PushID(0);
-				ImGui::Checkbox("Active", &bUseDirectionalLight);
-				SliderRotation("Direction", (float*)&DLDirection);
-				ImGui::ColorEdit3("Ambient", (float*)&DLAmbient);
-				ImGui::ColorEdit3("Diffuse", (float*)&DLDiffuse);
-				ImGui::ColorEdit3("Specular", (float*)&DLSpectular);
+				ImGui::Checkbox("Active", &Scene.bUseDirectionalLight);
+				SliderRotation("Direction", (float*)&Scene.DLDirection);
+				ImGui::ColorEdit3("Ambient", (float*)&Scene.DLAmbient);
+				ImGui::ColorEdit3("Diffuse", (float*)&Scene.DLDiffuse);
+				ImGui::ColorEdit3("Specular", (float*)&Scene.DLSpectular);
+				ImGui::Combo("Shadows", (int*)&TerrainShadows, "None\0Cascaded maps\0Heightfield march\0");
+				if (TerrainShadows == ETerrainShadows::Cascades)
+				{
+					ImGui::SliderInt("Cascades", &ShadowCascadesCount, 1, ShadowCascadesMax);
+					ImGui::Combo("Resolution", &ShadowResolution, "512\0" "1024\0" "2048\0" "4096\0");
+					ImGui::SliderFloat("Distance", &ShadowDistance, 10.f, 500.f);
+					ImGui::SliderFloat("Split blend", &ShadowCascades.SplitLambda, 0.f, 1.f);
+					ImGui::Text("Cascade renders: %d", ShadowCascades.Renders);
+					if (TerrainGeometry != ETerrainGeometry::Grid)
+					{
+						ImGui::Text("Off, the casters come from the Grid geometry");
+					}
+				}
+				else if (TerrainShadows == ETerrainShadows::Heightfield)
+				{
+					// Fewer steps give up earlier on the long shadows of a low sun, lit past the budget
+					ImGui::SliderInt("Step budget", &HeightfieldSteps, 8, 256);
+					ImGui::Text("Pyramid builds: %d (%.1f ms), texels rebuilt: %d", HeightMaxPyramid.Builds, HeightMaxPyramid.BuildMilliseconds, HeightMaxPyramid.RebuiltTexels);
+				}
 				ImGui::PopID();
 			}
 			if (!ImGui::CollapsingHeader("Point Light"))
 			{
 				ImGui::PushID(1);
-				ImGui::Checkbox("Active", &bUsePointLight);
-				ImGui::DragFloat3("Position", (float*)&PLPosition, 0.1f);
-				ImGui::ColorEdit3("Ambient", (float*)&PLAmbient);
-				ImGui::ColorEdit3("Diffuse", (float*)&PLDiffuse);
-				ImGui::ColorEdit3("Specular", (float*)&PLSpectular);
-				ImGui::DragFloat("Constant", &PLConstant, 0.01f);
-				ImGui::DragFloat("Linear", &PLLinear, 0.001f);
-				ImGui::DragFloat("Quadratic", &PLQuadratic, 0.0001f, 0.f, 0.f, "%.4f");
+				ImGui::Checkbox("Active", &Scene.bUsePointLight);
+				ImGui::DragFloat3("Position", (float*)&Scene.PLPosition, 0.1f);
+				ImGui::ColorEdit3("Ambient", (float*)&Scene.PLAmbient);
+				ImGui::ColorEdit3("Diffuse", (float*)&Scene.PLDiffuse);
+				ImGui::ColorEdit3("Specular", (float*)&Scene.PLSpectular);
+				ImGui::DragFloat("Constant", &Scene.PLConstant, 0.01f);
+				ImGui::DragFloat("Linear", &Scene.PLLinear, 0.001f);
+				ImGui::DragFloat("Quadratic", &Scene.PLQuadratic, 0.0001f, 0.f, 0.f, "%.4f");
 				ImGui::PopID();
 			}
 			if (!ImGui::CollapsingHeader("Spot Light"))
 			{
 				ImGui::PushID(2);
-				ImGui::Checkbox("Active", &bUseSpotLight);
-				ImGui::ColorEdit3("Ambient", (float*)&SLAmbient);
-				ImGui::ColorEdit3("Diffuse", (float*)&SLDiffuse);
-				ImGui::ColorEdit3("Specular", (float*)&SLSpectular);
-				ImGui::DragFloat("Constant", &SLConstant, 0.01f);
-				ImGui::DragFloat("Linear", &SLLinear, 0.001f);
-				ImGui::DragFloat("Quadratic", &SLQuadratic, 0.0001f, 0.f, 0.f, "%.4f");
-				ImGui::DragFloat("Cut Off", &SLCutOff, 0.1f);
-				ImGui::DragFloat("Outer Cut Off", &SLOuterCutOff, 0.1f);
+				ImGui::Checkbox("Active", &Scene.bUseSpotLight);
+				ImGui::ColorEdit3("Ambient", (float*)&Scene.SLAmbient);
+				ImGui::ColorEdit3("Diffuse", (float*)&Scene.SLDiffuse);
+				ImGui::ColorEdit3("Specular", (float*)&Scene.SLSpectular);
+				ImGui::DragFloat("Constant", &Scene.SLConstant, 0.01f);
+				ImGui::DragFloat("Linear", &Scene.SLLinear, 0.001f);
+				ImGui::DragFloat("Quadratic", &Scene.SLQuadratic, 0.0001f, 0.f, 0.f, "%.4f");
+				ImGui::DragFloat("Cut Off", &Scene.SLCutOff, 0.1f);
+				ImGui::DragFloat("Outer Cut Off", &Scene.SLOuterCutOff, 0.1f);
+				ImGui::PopID();
+			}
+			if (!ImGui::CollapsingHeader("Clustered Lights"))
+			{
+				ImGui::PushID(3);
+				ImGui::Checkbox("Active", &Scene.bUseClusteredLights); ImGui::SameLine(ImGui::GetContentRegionAvailWidth() > 300 ? 150 : ImGui::GetContentRegionAvailWidth() * 0.5f);
+				ImGui::Checkbox("Markers", &bClusteredMarkers);
+				ImGui::SliderInt("Lights", &ClusteredLightsCount, 0, 4096);
+				ImGui::Checkbox("Motion", &bClusteredLightsMotion);
+				const FClustersBlock &Clusters = ClusteredLights.GetBlock();
+				ImGui::Text("Froxels: %dx%dx%d, listed lights: %d, most in one: %d", Clusters.Grid.x, Clusters.Grid.y, Clusters.Grid.z, ClusteredLights.IndicesCount, ClusteredLights.MaxLightsPerCluster);
+				ImGui::Text("Binning: %.2f ms", ClusteredLights.BinMilliseconds);
 				ImGui::PopID();
 			}
+			if (!ImGui::CollapsingHeader("Shaders"))
+			{
+				ImGui::Text("Startup, compiled: %d (%.1f ms), from cache: %d (%.1f ms)", ShadersCompiled.Count, ShadersCompiled.Milliseconds, ShadersCached.Count, ShadersCached.Milliseconds);
+				ImGui::Text("Binary cache: %s", GShader::CacheDirectory.empty() ? "disabled" : GShader::CacheDirectory.c_str());
+				ImGui::Text("Parallel compile: %s", GShader::IsParallelCompileSupported() ? "yes" : "no");
+				if (ShaderWatcher.IsWatching())
+				{
+					ImGui::Text("Watching %s/, reloads: %d, swapped: %d", ShaderWatcher.Directory.c_str(), ShaderReloads, ShaderSwaps);
+				}
+				else
+				{
+					ImGui::Text("Hot reload off, no %s/ folder", ShaderWatcher.Directory.c_str());
+				}
+				ImGui::Checkbox("Terrain permutations", &bTerrainPermutations); ImGui::SameLine(ImGui::GetContentRegionAvailWidth() > 300 ? 150 : ImGui::GetContentRegionAvailWidth() * 0.5f);
+				ImGui::Text("Built: %d", TerrainShader.GetPermutationsCount() + TerrainCachedShader.GetPermutationsCount());
+				if (bTerrainPermutations)
+				{
+					ImGui::TextUnformatted(TerrainDefines.c_str());
+				}
+			}
+			if (!ImGui::CollapsingHeader("Textures"))
+			{
+				if (ImGui::Button("Load Textures/"))
+				{
+					std::error_code Error;
+					for (const std::filesystem::directory_entry &Entry : std::filesystem::directory_iterator("Textures", Error))
+					{
+						Textures.push_back(TextureLoader.Load(Entry.path().string().c_str()));
+					}
+					LongestLoadingFrame = 0.f;
+				}
+				ImGui::SameLine();
+				ImGui::Text("Loading: %d, longest frame meanwhile: %.1f ms", TextureLoader.GetPendingCount(), LongestLoadingFrame);
+				ImGui::Text("Baked .gtex in BC1/BC3: %s", GTextureLoader::IsBlockCompressionSupported() ? "Supported" : "Not supported");
+				const char* States[] = { "Decoding", "Uploading", "Ready", "Failed" };
+				for (FTextureHandle Texture : Textures)
+				{
+					ImGui::Text("%s: %s", TextureLoader.GetPath(Texture).c_str(), States[(int)TextureLoader.GetState(Texture)]);
+				}
+			}
 			ImGui::End();
 
 			// Demos
@@ -282,6 +755,11 @@ int CALLBACK WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLi
 				CurrentState = EState::OnDemo;
 				bSLDemo = true;
 			}
+			if (ImGui::Button("Clustered Lights Demo", ImVec2(300.f - 2.f * Style.WindowPadding.x, 0.f)))
+			{
+				CurrentState = EState::OnDemo;
+				bCLDemo = true;
+			}
 
 			ImGui::End();
 		}
@@ -305,22 +783,23 @@ int CALLBACK WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLi
 			Camera.Pitch = -23.f;
 			Camera.WorldUp = glm::vec3(0.f, 1.f, 0.f);
 			Camera.UpdateCameraVectors();
-			DLDirection = glm::vec2(45.f * glm::sin(CurrentFrame), -90.f + 22.5f * glm::cos(CurrentFrame));
+			Scene.DLDirection = glm::vec2(45.f * glm::sin(CurrentFrame), -90.f + 22.5f * glm::cos(CurrentFrame));
 
-			bUseDirectionalLight = true;
-			bUsePointLight = false;
-			bUseSpotLight = false;
+			Scene.bUseDirectionalLight = true;
+			Scene.bUsePointLight = false;
+			Scene.bUseSpotLight = false;
+			Scene.bUseClusteredLights = false;
 
 			// Terrain
 			bTerrainWireframe = false;
 			bTerrainLiveMotion = false;
-			Lenght = 10.f;
-			UHeight = 10.f;
+			Scene.Lenght = 10.f;
+			Scene.UHeight = 10.f;
 
 			// Direction Light
-			DLAmbient = glm::vec3(0.5f);
-			DLDiffuse = glm::vec3(0.5f);
-			DLSpectular = glm::vec3(0.5f);
+			Scene.DLAmbient = glm::vec3(0.5f);
+			Scene.DLDiffuse = glm::vec3(0.5f);
+			Scene.DLSpectular = glm::vec3(0.5f);
 		}
 		if (bPLDemo)
 		{
@@ -331,25 +810,26 @@ int CALLBACK WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLi
 			Camera.UpdateCameraVectors();
 			float PLPX = 2.2f * glm::sin(3.5f * CurrentFrame) + 3.8f * glm::cos(1.4f * CurrentFrame) + 5.3f * glm::sin(2.6f * CurrentFrame);
 			float PLPZ = 7.f + 3.7f * glm::sin(2.6f * CurrentFrame) + 2.1f * glm::cos(1.9f * CurrentFrame) + 3.8f * glm::cos(2.4f * CurrentFrame);
-			PLPosition = glm::vec3(PLPX, 9.f, PLPZ);
+			Scene.PLPosition = glm::vec3(PLPX, 9.f, PLPZ);
 
-			bUseDirectionalLight = false;
-			bUsePointLight = true;
-			bUseSpotLight = false;
+			Scene.bUseDirectionalLight = false;
+			Scene.bUsePointLight = true;
+			Scene.bUseSpotLight = false;
+			Scene.bUseClusteredLights = false;
 
 			// Terrain
 			bTerrainWireframe = false;
 			bTerrainLiveMotion = false;
-			Lenght = 10.f;
-			UHeight = 10.f;
+			Scene.Lenght = 10.f;
+			Scene.UHeight = 10.f;
 
 			// Point Light
-			PLAmbient = glm::vec3(0.25f);
-			PLDiffuse = glm::vec3(0.75f);
-			PLSpectular = glm::vec3(1.f);
-			PLConstant = 1.f;
-			PLLinear = 0.022f;
-			PLQuadratic = 0.0019f;
+			Scene.PLAmbient = glm::vec3(0.25f);
+			Scene.PLDiffuse = glm::vec3(0.75f);
+			Scene.PLSpectular = glm::vec3(1.f);
+			Scene.PLConstant = 1.f;
+			Scene.PLLinear = 0.022f;
+			Scene.PLQuadratic = 0.0019f;
 		}
 		if (bSLDemo)
 		{
@@ -359,149 +839,439 @@ int CALLBACK WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLi
 			Camera.WorldUp = glm::vec3(0.f, 1.f, 0.f);
 			Camera.UpdateCameraVectors();
 
-			bUseDirectionalLight = false;
-			bUsePointLight = false;
-			bUseSpotLight = true;
+			Scene.bUseDirectionalLight = false;
+			Scene.bUsePointLight = false;
+			Scene.bUseSpotLight = true;
+			Scene.bUseClusteredLights = false;
 
 			// Terrain
 			bTerrainWireframe = false;
 			bTerrainLiveMotion = false;
-			Lenght = 10.f;
-			UHeight = 10.f;
+			Scene.Lenght = 10.f;
+			Scene.UHeight = 10.f;
 
 			// Spot Light
-			SLAmbient = glm::vec3(0.f);
-			SLDiffuse = glm::vec3(1.f);
-			SLSpectular = glm::vec3(1.f);
-			SLConstant = 1.f;
-			SLLinear = 0.09f;
-			SLQuadratic = 0.032f;
-			SLCutOff = 12.5f;
-			SLOuterCutOff = 15.f;
+			Scene.SLAmbient = glm::vec3(0.f);
+			Scene.SLDiffuse = glm::vec3(1.f);
+			Scene.SLSpectular = glm::vec3(1.f);
+			Scene.SLConstant = 1.f;
+			Scene.SLLinear = 0.09f;
+			Scene.SLQuadratic = 0.032f;
+			Scene.SLCutOff = 12.5f;
+			Scene.SLOuterCutOff = 15.f;
+		}
+		if (bCLDemo)
+		{
+			Camera.Position = glm::vec3(0.f, 12.f, 26.f);
+			Camera.Yaw = -90.f;
+			Camera.Pitch = -23.f;
+			Camera.WorldUp = glm::vec3(0.f, 1.f, 0.f);
+			Camera.UpdateCameraVectors();
+
+			Scene.bUseDirectionalLight = false;
+			Scene.bUsePointLight = false;
+			Scene.bUseSpotLight = false;
+			Scene.bUseClusteredLights = true;
+
+			// Terrain
+			bTerrainWireframe = false;
+			bTerrainLiveMotion = false;
+			Scene.Lenght = 10.f;
+			Scene.UHeight = 10.f;
+
+			// Clustered Lights, as many as the menu asks for
+			bClusteredLightsMotion = true;
+			bClusteredMarkers = true;
 		}
 
 		ProcessInput(Window);
 
-		glClearColor(ClearColor.x, ClearColor.y, ClearColor.z, ClearColor.w);
+		Scene.Commit();
+
+		// The overdraw heat map adds up from black
+		if (bTerrainOverdraw)
+		{
+			glClearColor(0.f, 0.f, 0.f, 1.f);
+		}
+		else
+		{
+			glClearColor(ClearColor.x, ClearColor.y, ClearColor.z, ClearColor.w);
+		}
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 		int Width, Height;
 		glfwGetFramebufferSize(Window, &Width, &Height);
 
-		glm::mat4 Projection = glm::perspective(glm::radians(Camera.Zoom), (float)Width / (float)Height, 0.1f, 100.f);
+		const float NearPlane = 0.1f;
+		float FarPlane = 100.f;
+		if (TerrainGeometry == ETerrainGeometry::Quadtree)
+		{
+			TerrainQuadtree.Select(Camera.Position, Camera.Zoom, Height, Scene.UHeight);
+			FarPlane = glm::max(FarPlane, TerrainQuadtree.GetViewDistance());
+		}
+		else if (TerrainGeometry == ETerrainGeometry::Clipmap)
+		{
+			TerrainClipmap.Update(Camera.Position, Scene.UHeight);
+			FarPlane = glm::max(FarPlane, TerrainClipmap.GetViewDistance());
+		}
+
+		glm::mat4 Projection = glm::perspective(glm::radians(Camera.Zoom), (float)Width / (float)Height, NearPlane, FarPlane);
 		glm::mat4 View = Camera.GetViewMatrix();
 		glm::mat4 Model(1.f);
 
-		// TerrainShader
-		glBindVertexArray(GridVAO);
-		TerrainShader.Use();
+		FCameraBlock CameraUniforms = { Projection, View, Camera.Position, 0.f };
+		bool bCameraChanged = CameraBlock.Update(&CameraUniforms);
 
-		//// Lights
-		// Directional Light
-		if (bUseDirectionalLight)
+		// Only the lights whose fields changed are written again, the spot light follows the camera. Inactive lights are black.
+		bool bDirectionalLightChanged = Scene.IsDirty(ESceneField::UseDirectionalLight, ESceneField::DLSpectular);
+		if (bDirectionalLightChanged)
 		{
-			TerrainShader.SetVec3("UDirectionalLight.Light.Ambient", DLAmbient);
-			TerrainShader.SetVec3("UDirectionalLight.Light.Diffuse", DLDiffuse);
-			TerrainShader.SetVec3("UDirectionalLight.Light.Specular", DLSpectular);
+			FDirectionalLightBlock &Light = Lights.DirectionalLight;
+			Light.Direction = GetNormal(Scene.DLDirection);
+			Light.Light.Ambient = Scene.bUseDirectionalLight ? Scene.DLAmbient : glm::vec3(0.f);
+			Light.Light.Diffuse = Scene.bUseDirectionalLight ? Scene.DLDiffuse : glm::vec3(0.f);
+			Light.Light.Specular = Scene.bUseDirectionalLight ? Scene.DLSpectular : glm::vec3(0.f);
 		}
-		else
+		bool bPointLightChanged = Scene.IsDirty(ESceneField::UsePointLight, ESceneField::PLQuadratic);
+		if (bPointLightChanged)
+		{
+			FPointLightBlock &Light = Lights.PointLights[0];
+			Light.Position = Scene.PLPosition;
+			Light.Constant = Scene.PLConstant;
+			Light.Linear = Scene.PLLinear;
+			Light.Quadratic = Scene.PLQuadratic;
+			Light.Light.Ambient = Scene.bUsePointLight ? Scene.PLAmbient : glm::vec3(0.f);
+			Light.Light.Diffuse = Scene.bUsePointLight ? Scene.PLDiffuse : glm::vec3(0.f);
+			Light.Light.Specular = Scene.bUsePointLight ? Scene.PLSpectular : glm::vec3(0.f);
+		}
+		bool bSpotLightChanged = bCameraChanged || Scene.IsDirty(ESceneField::UseSpotLight, ESceneField::SLOuterCutOff);
+		if (bSpotLightChanged)
+		{
+			FSpotLightBlock &Light = Lights.SpotLight;
+			Light.Position = Camera.Position;
+			Light.Direction = Camera.Front;
+			Light.Constant = Scene.SLConstant;
+			Light.Linear = Scene.SLLinear;
+			Light.Quadratic = Scene.SLQuadratic;
+			Light.CutOff = glm::cos(glm::radians(Scene.SLCutOff));
+			Light.OuterCutOff = glm::cos(glm::radians(Scene.SLOuterCutOff));
+			Light.Light.Ambient = Scene.bUseSpotLight ? Scene.SLAmbient : glm::vec3(0.f);
+			Light.Light.Diffuse = Scene.bUseSpotLight ? Scene.SLDiffuse : glm::vec3(0.f);
+			Light.Light.Specular = Scene.bUseSpotLight ? Scene.SLSpectular : glm::vec3(0.f);
+		}
+		if (bDirectionalLightChanged || bPointLightChanged || bSpotLightChanged)
 		{
-			TerrainShader.SetVec3("UDirectionalLight.Light.Ambient", glm::vec3(0.f));
-			TerrainShader.SetVec3("UDirectionalLight.Light.Diffuse", glm::vec3(0.f));
-			TerrainShader.SetVec3("UDirectionalLight.Light.Specular", glm::vec3(0.f));
+			LightsBlock.Update(&Lights);
 		}
-		TerrainShader.SetVec2r("UDirectionalLight.Direction", DLDirection);
 
-		// Point Light
-		if (bUsePointLight)
+		// The cache and the height map only cover the grid
+		bool bTerrainGrid = TerrainGeometry == ETerrainGeometry::Grid;
+		bool bTerrainCachedDraw = bTerrainCached && bTerrainGrid;
+		FTerrainUniforms TerrainUniforms = { Scene.Lenght, Scene.UHeight, TerrainTime, SeparationFactor, Scene.TerrainNormals, bTerrainBaked && bTerrainGrid ? ETerrainHeights::Baked : ETerrainHeights::Procedural };
+		if (Scene.IsDirty(ESceneField::UseDirectionalLight) || Scene.IsDirty(ESceneField::UsePointLight) || Scene.IsDirty(ESceneField::UseSpotLight) ||
+			Scene.IsDirty(ESceneField::UseClusteredLights) || Scene.IsDirty(ESceneField::TerrainNormals))
 		{
-			TerrainShader.SetVec3("UPointLights[0].Light.Ambient", PLAmbient);
-			TerrainShader.SetVec3("UPointLights[0].Light.Diffuse", PLDiffuse);
-			TerrainShader.SetVec3("UPointLights[0].Light.Specular", PLSpectular);
+			TerrainDefines = "#define DIRECTIONAL_LIGHT " + std::to_string((int)Scene.bUseDirectionalLight) + "\n"
+				"#define POINT_LIGHT " + std::to_string((int)Scene.bUsePointLight) + "\n"
+				"#define SPOT_LIGHT " + std::to_string((int)Scene.bUseSpotLight) + "\n"
+				"#define CLUSTERED_LIGHTS " + std::to_string((int)Scene.bUseClusteredLights) + "\n"
+				"#define NORMAL_MODE " + std::to_string((int)Scene.TerrainNormals) + "\n";
+			TerrainGBufferDefines = "#define DEFERRED 1\n"
+				"#define NORMAL_MODE " + std::to_string((int)Scene.TerrainNormals) + "\n";
+			TerrainDepthDefines = "#define DEPTH_ONLY 1\n"
+				"#define NORMAL_MODE " + std::to_string((int)Scene.TerrainNormals) + "\n";
+			TerrainOverdrawDefines = "#define OVERDRAW 1\n"
+				"#define NORMAL_MODE " + std::to_string((int)Scene.TerrainNormals) + "\n";
 		}
-		else
+		// The permutation without the math of the inactive lights, or the program that runs it on black lights
+		GShader &TerrainBaseShader = bTerrainCachedDraw ? TerrainCachedShader : TerrainShader;
+		// The heat map, then the G-buffer permutation, each drawn forward until it has linked
+		GShader* TerrainOverdrawShader = bTerrainOverdraw ? &TerrainBaseShader.GetPermutation(TerrainOverdrawDefines) : nullptr;
+		bool bTerrainOverdrawDraw = TerrainOverdrawShader && TerrainOverdrawShader != &TerrainBaseShader;
+		GShader* TerrainGBufferShader = TerrainShading == ETerrainShading::Deferred && !bTerrainOverdraw ? &TerrainBaseShader.GetPermutation(TerrainGBufferDefines) : nullptr;
+		bool bTerrainDeferredDraw = TerrainGBufferShader && TerrainGBufferShader != &TerrainBaseShader;
+		GShader &TerrainDrawShader = bTerrainOverdrawDraw ? *TerrainOverdrawShader : bTerrainDeferredDraw ? *TerrainGBufferShader :
+			bTerrainPermutations ? TerrainBaseShader.GetPermutation(TerrainDefines) : TerrainBaseShader;
+		FTerrainHandles &TerrainDrawHandles = GetTerrainHandles(TerrainDrawShader);
+		// Depth only, without the normals, skipped until it has linked
+		GShader* TerrainDepthShader = bTerrainDepthPrePass ? &TerrainBaseShader.GetPermutation(TerrainDepthDefines) : nullptr;
+		bool bTerrainPrePassDraw = TerrainDepthShader && TerrainDepthShader != &TerrainBaseShader;
+
+		// The clustered lights are listed on the workers while the terrain is culled
+		if (bClusteredLightsMotion)
+		{
+			ClusteredLightsTime += DeltaTime;
+		}
+		if (Scene.bUseClusteredLights)
 		{
-			TerrainShader.SetVec3("UPointLights[0].Light.Ambient", glm::vec3(0.f));
-			TerrainShader.SetVec3("UPointLights[0].Light.Diffuse", glm::vec3(0.f));
-			TerrainShader.SetVec3("UPointLights[0].Light.Specular", glm::vec3(0.f));
+			// The deferred volumes only need the lights, the forward frames drawn while the G-buffer links still need the clusters
+			ClusteredLights.bBinning = !bTerrainDeferredDraw;
+			AnimateClusteredLights(ClusteredLights.Lights, ClusteredLightsCount, Scene.UHeight, ClusteredLightsTime);
+			ClusteredLights.Start(Projection, View, NearPlane, FarPlane, Width, Height);
 		}
-		TerrainShader.SetVec3("UPointLights[0].Position", PLPosition);
-		TerrainShader.Set1f("UPointLights[0].Constant", PLConstant);
-		TerrainShader.Set1f("UPointLights[0].Linear", PLLinear);
-		TerrainShader.Set1f("UPointLights[0].Quadratic", PLQuadratic);
 
-		// Spot Light
-		if (bUseSpotLight)
+		// The heightfield shadows march over the baked heights whatever the terrain is drawn from
+		bool bHeightfieldShadows = TerrainShadows == ETerrainShadows::Heightfield && Scene.bUseDirectionalLight;
+		if (bTerrainBaked || bTerrainBenchmark || bHeightfieldShadows)
 		{
-			TerrainShader.SetVec3("USpotLight.Light.Ambient", SLAmbient);
-			TerrainShader.SetVec3("USpotLight.Light.Diffuse", SLDiffuse);
-			TerrainShader.SetVec3("USpotLight.Light.Specular", SLSpectular);
+			if (HeightMap.Update(TerrainTime))
+			{
+				TerrainCache.Invalidate();
+				TerrainTiles.UpdateBakedBounds(HeightMap);
+			}
+			HeightMap.Bind(0);
 		}
-		else
+		if (bHeightfieldShadows)
+		{
+			HeightMaxPyramid.Update(HeightMap);
+		}
+
+		// GPU time of the whole grid with each height source, drawn over the cleared frame, which is cleared again after it
+		if (bTerrainBenchmark)
 		{
-			TerrainShader.SetVec3("USpotLight.Light.Ambient", glm::vec3(0.f));
-			TerrainShader.SetVec3("USpotLight.Light.Diffuse", glm::vec3(0.f));
-			TerrainShader.SetVec3("USpotLight.Light.Specular", glm::vec3(0.f));
+			glBindVertexArray(GridVAO);
+			FTerrainHandles &BenchmarkHandles = GetTerrainHandles(TerrainShader);
+			TerrainShader.Use();
+			TerrainShader.SetMat4(BenchmarkHandles.Model, Model);
+			TerrainShader.Set1i(BenchmarkHandles.GridSource, (int)ETerrainGridSource::Strips);
+
+			FTerrainUniforms BenchmarkUniforms = TerrainUniforms;
+			BenchmarkUniforms.Heights = ETerrainHeights::Procedural;
+			SetTerrainUniforms(TerrainShader, BenchmarkHandles, BenchmarkUniforms);
+			ProceduralMilliseconds = MeasureDrawMilliseconds(TerrainShader, BenchmarkHandles, 2 * GridVertices, 10);
+			BenchmarkUniforms.Heights = ETerrainHeights::Baked;
+			SetTerrainUniforms(TerrainShader, BenchmarkHandles, BenchmarkUniforms);
+			BakedMilliseconds = MeasureDrawMilliseconds(TerrainShader, BenchmarkHandles, 2 * GridVertices, 10);
+			// Every program sends its uniforms again after the benchmark heights
+			for (auto &Handles : TerrainProgramHandles)
+			{
+				Handles.second.bUploaded = false;
+			}
+
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			bTerrainBenchmark = false;
 		}
-		TerrainShader.SetVec3("USpotLight.Position", Camera.Position);
-		TerrainShader.SetVec3("USpotLight.Direction", Camera.Front);
-		TerrainShader.Set1f("USpotLight.Constant", SLConstant);
-		TerrainShader.Set1f("USpotLight.Linear", SLLinear);
-		TerrainShader.Set1f("USpotLight.Quadratic", SLQuadratic);
-		TerrainShader.Set1f("USpotLight.CutOff", glm::cos(glm::radians(SLCutOff)));
-		TerrainShader.Set1f("USpotLight.OuterCutOff", glm::cos(glm::radians(SLOuterCutOff)));
 
-		TerrainShader.SetVec3("UViewPosition", Camera.Position);
+		// TerrainShader
+		// The casters are the cached grid, the quadtree and the clipmap draw other heights past and inside it
+		bool bShadowsDraw = TerrainShadows == ETerrainShadows::Cascades && Scene.bUseDirectionalLight && bTerrainGrid;
+		if (bTerrainCachedDraw || bShadowsDraw)
+		{
+			TerrainCache.Update(TerrainFeedbackShader, TerrainFeedbackHandles, TerrainUniforms);
+		}
 
-		TerrainShader.SetMat4("UProjection", Projection);
-		TerrainShader.SetMat4("UView", View);
-		TerrainShader.SetMat4("UModel", Model);
+		// The cascades take the casters from the cache instead of evaluating the fbm again. A cascade is drawn only when it
+		// moved to other texels or the cache captured new vertices, the others keep their depth.
+		if (bShadowsDraw)
+		{
+			ShadowCascades.SetCascades(ShadowCascadesCount, 512 << ShadowResolution);
+			glm::vec3 BoundsMin, BoundsMax;
+			TerrainTiles.GetBounds(TerrainUniforms, BoundsMin, BoundsMax);
+			ShadowCascades.Update(Camera, (float)Width / (float)Height, NearPlane, glm::min(FarPlane, ShadowDistance), Lights.DirectionalLight.Direction,
+				BoundsMin, BoundsMax, TerrainCache.Captures);
+
+			ShadowShader.Use();
+			for (int Cascade = 0; Cascade < ShadowCascades.Count; ++Cascade)
+			{
+				if (!ShadowCascades.NeedsRender(Cascade))
+				{
+					continue;
+				}
+				TerrainTiles.Select(ShadowCascades.GetLightSpace(Cascade), TerrainUniforms, ShadowTiles);
+				ShadowCascades.Begin(Cascade);
+				ShadowShader.SetMat4(ShadowLightSpace, ShadowCascades.GetLightSpace(Cascade));
+				TerrainCache.Draw(ShadowTiles);
+				ShadowCascades.End(Width, Height);
+			}
+		}
+		FShadowsBlock Shadows = ShadowCascades.GetBlock();
+		Shadows.Params.x = bShadowsDraw ? Shadows.Params.x : 0.f;
+		if (bHeightfieldShadows && HeightMaxPyramid.GetLevelsCount() > 0)
+		{
+			Shadows.Params.z = (float)HeightfieldSteps;
+			Shadows.Heightfield = glm::vec4(TerrainUniforms.Width != 0.f ? 1.f / (TerrainUniforms.Width * HeightMap.Range) : 0.f, TerrainUniforms.Height / 2.f,
+				(float)(HeightMaxPyramid.GetLevelsCount() - 1), (float)HeightMaxPyramid.Resolution);
+		}
+		ShadowsBlock.Update(&Shadows);
+		ShadowCascades.Bind(7);
+		HeightMaxPyramid.Bind(8);
+		bool bTerrainCulled = bTerrainCulling && bTerrainGrid;
+		if (bTerrainCulled)
+		{
+			TerrainTiles.Cull(Projection * View * Model, TerrainUniforms);
 
-		TerrainShader.Set1f("UWidth", Lenght);
-		TerrainShader.Set1f("UHeight", UHeight);
-		TerrainShader.Set1f("UTime", TerrainTime);
+			// The pyramid holds the procedural heights, builds for a new time run in the background
+			if (bTerrainOcclusion && !bTerrainBaked)
+			{
+				HeightPyramid.Update(TerrainTime);
+				TerrainOcclusion.Start(TerrainTiles, HeightPyramid, Camera.Position, NearPlane, TerrainUniforms);
+			}
+		}
+		else if (bTerrainGrid)
+		{
+			TerrainTiles.KeepAll();
+		}
 
 		if (bTerrainWireframe)
 		{
 			glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 		}
-		glDrawElements(GL_TRIANGLES, GridIndicesSize, GL_UNSIGNED_INT, 0);
+		if (bTerrainCulled)
+		{
+			TerrainOcclusion.Finish(TerrainTiles);
+		}
+		// No lights for the program that runs the clustered lights while they're off
+		if (Scene.bUseClusteredLights)
+		{
+			ClusteredLights.Finish();
+		}
+		FClustersBlock Clusters = ClusteredLights.GetBlock();
+		Clusters.Grid.w = Scene.bUseClusteredLights && ClusteredLights.bBinning ? Clusters.Grid.w : 0;
+		ClustersBlock.Update(&Clusters);
+		ClusteredLights.Bind(1);
+		TerrainCulling = bTerrainCulled ? TerrainTiles.Stats : FCullingStats{ 0, 0, 0, 0, 0, 0 };
+		if (bTerrainDeferredDraw)
+		{
+			Deferred.Begin(Width, Height);
+		}
+		// The same geometry for the pre-pass and the color pass
+		auto DrawTerrain = [&](GShader &Shader, FTerrainHandles &Handles)
+		{
+			Shader.Use();
+
+			Shader.SetMat4(Handles.Model, Model);
+
+			SetTerrainUniforms(Shader, Handles, TerrainUniforms);
+
+			if (bTerrainCachedDraw)
+			{
+				TerrainCache.Draw(TerrainTiles.GetVisibleTiles());
+			}
+			else if (bTerrainGrid && bTerrainPatches)
+			{
+				Shader.Set1i(Handles.GridSource, (int)ETerrainGridSource::Patches);
+				TerrainPatches.Draw(TerrainTiles.GetVisibleTiles());
+			}
+			else if (bTerrainGrid)
+			{
+				// Without buffers, a single draw while nothing is culled
+				Shader.Set1i(Handles.GridSource, (int)ETerrainGridSource::Strips);
+				glBindVertexArray(GridVAO);
+				if (bTerrainCulled)
+				{
+					TerrainTiles.DrawStrips(Shader, Handles);
+				}
+				else
+				{
+					DrawGridStrips(Shader, Handles, 2 * GridVertices);
+				}
+			}
+			else if (TerrainGeometry == ETerrainGeometry::Quadtree)
+			{
+				TerrainQuadtree.Draw(Shader, Handles);
+			}
+			else
+			{
+				TerrainClipmap.Draw(Shader, Handles);
+			}
+		};
+
+		// Lays the nearest depth of each pixel so the color pass shades it once, at the cost of transforming the terrain twice
+		PrePassMilliseconds = 0.f;
+		PrePassFragmentsPerPixel = 0.f;
+		if (bTerrainPrePassDraw)
+		{
+			glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+			PrePassTimer.Begin();
+			PrePassFragments.Begin();
+			DrawTerrain(*TerrainDepthShader, GetTerrainHandles(*TerrainDepthShader));
+			PrePassFragments.End();
+			PrePassTimer.End();
+			PrePassMilliseconds = PrePassTimer.GetMilliseconds();
+			PrePassFragmentsPerPixel = PrePassFragments.GetSamples() / (float)(Width * Height);
+			glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+			glDepthFunc(GL_EQUAL);
+			glDepthMask(GL_FALSE);
+		}
+		if (bTerrainOverdrawDraw)
+		{
+			glEnable(GL_BLEND);
+			glBlendFunc(GL_ONE, GL_ONE);
+		}
+		TerrainTimer.Begin();
+		TerrainFragments.Begin();
+		DrawTerrain(TerrainDrawShader, TerrainDrawHandles);
+		TerrainFragments.End();
+		TerrainTimer.End();
+		TerrainMilliseconds = TerrainTimer.GetMilliseconds();
+		FragmentsPerPixel = TerrainFragments.GetSamples() / (float)(Width * Height);
+		glDisable(GL_BLEND);
+		glDepthMask(GL_TRUE);
+		glDepthFunc(GL_LESS);
 		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 
-		if (bUsePointLight)
+		// The lights of the G-buffer, each pixel lit once whatever the overdraw of the terrain
+		LightingMilliseconds = 0.f;
+		if (bTerrainDeferredDraw)
 		{
-			PointLightShader.Use();
+			Deferred.End();
+			glm::mat4 InverseViewProjection = glm::inverse(Projection * View);
+			LightingTimer.Begin();
+			Deferred.Bind(4);
+			DeferredLightShader.Use();
+			DeferredLightShader.SetMat4(DeferredLightInverse, InverseViewProjection);
+			Deferred.DrawFullScreen();
+			if (Scene.bUseClusteredLights)
+			{
+				DeferredVolumeShader.Use();
+				DeferredVolumeShader.SetMat4(DeferredVolumeInverse, InverseViewProjection);
+				Deferred.DrawVolumes(ClusteredLights.GetLightsBuffer(), (int)ClusteredLights.Lights.size());
+			}
+			LightingTimer.End();
+			LightingMilliseconds = LightingTimer.GetMilliseconds();
+		}
 
-			PointLightShader.SetVec3("UViewPosition", Camera.Position);
+		if (Scene.bUsePointLight)
+		{
+			PointLightShader.Use();
 
-			PointLightShader.SetMat4("UProjection", Projection);
-			PointLightShader.SetMat4("UView", View);
 			Model = glm::mat4(1.f);
-			Model = glm::translate(Model, PLPosition);
-			PointLightShader.SetMat4("UModel", Model);
+			Model = glm::translate(Model, Scene.PLPosition);
+			PointLightShader.SetMat4(PointLightModel, Model);
 
 			glBindVertexArray(PointLightVAO);
 			glDrawElements(GL_TRIANGLES, PointLightIndicesSize, GL_UNSIGNED_INT, 0);
 		}
+		if (Scene.bUseClusteredLights && bClusteredMarkers && !ClusteredLights.Lights.empty())
+		{
+			ClusteredMarkers.resize(ClusteredLights.Lights.size());
+			for (size_t i = 0; i < ClusteredMarkers.size(); ++i)
+			{
+				ClusteredMarkers[i] = glm::vec4(ClusteredLights.Lights[i].Position, 0.1f);
+			}
+			glBindBuffer(GL_ARRAY_BUFFER, ClusteredMarkersVBO);
+			glBufferData(GL_ARRAY_BUFFER, ClusteredMarkers.size() * sizeof(glm::vec4), ClusteredMarkers.data(), GL_STREAM_DRAW);
+
+			PointLightShader.Use();
+			PointLightShader.SetMat4(PointLightModel, glm::mat4(1.f));
+			glBindVertexArray(ClusteredMarkersVAO);
+			glDrawElementsInstanced(GL_TRIANGLES, PointLightIndicesSize, GL_UNSIGNED_INT, 0, (GLsizei)ClusteredMarkers.size());
+		}
 
 		glClear(GL_DEPTH_BUFFER_BIT);
 
-		if (bUseDirectionalLight)
+		if (Scene.bUseDirectionalLight)
 		{
 			ArrowShader.Use();
 
-			ArrowShader.SetVec3("USpotLight.Position", Camera.Position);
-			ArrowShader.SetVec3("USpotLight.Direction", 2.f * Camera.Front + glm::vec3(0.f, 0.5f, 0.f));
-
-			ArrowShader.SetVec3("UViewPosition", Camera.Position);
-
-			ArrowShader.SetMat4("UProjection", Projection);
-			ArrowShader.SetMat4("UView", View);
+			ArrowShader.SetVec3(ArrowLightPosition, Camera.Position);
+			ArrowShader.SetVec3(ArrowLightDirection, 2.f * Camera.Front + glm::vec3(0.f, 0.5f, 0.f));
 
 			Model = glm::mat4(1.f);
 			Model = glm::translate(Model, Camera.Position + 2.f * Camera.Front + glm::vec3(0.f, 0.5f, 0.f));
 
-			glm::vec3 Direction = -GetNormal(DLDirection);
+			glm::vec3 Direction = -GetNormal(Scene.DLDirection);
 			glm::vec3 Front = Direction;
 			glm::vec3 Right = glm::normalize(glm::cross(Front, glm::vec3(0.f, 1.f, 0.f)));
 			glm::vec3 Up = glm::normalize(glm::cross(Right, Front));
@@ -512,12 +1282,12 @@ int CALLBACK WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLi
 			Model = glm::rotate(Model, glm::radians(270.f), glm::vec3(0.f, 1.f, 0.f));
 			Model = glm::rotate(Model, glm::radians(270.f), glm::vec3(0.f, 0.f, 1.f));
 
-			ArrowShader.SetMat4("UModel", Model);
+			ArrowShader.SetMat4(ArrowModel, Model);
 			glBindVertexArray(CylinderVAO);
 			glDrawElements(GL_TRIANGLES, CylinderIndicesSize, GL_UNSIGNED_INT, 0);
 
 			Model = glm::translate(Model, glm::vec3(0.f, 0.1f, 0.f));
-			ArrowShader.SetMat4("UModel", Model);
+			ArrowShader.SetMat4(ArrowModel, Model);
 			glBindVertexArray(ConeVAO);
 			glDrawElements(GL_TRIANGLES, ConeIndicesSize, GL_UNSIGNED_INT, 0);
 		}
@@ -529,19 +1299,47 @@ int CALLBACK WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLi
 
 		glfwSwapBuffers(Window);
 		glfwPollEvents();
+
+		Uploads = { GShader::NameLookups, GShader::Uploads, GUniformBlock::Uploads, GUniformBlock::UploadedBytes, Scene.Version, Scene.GetDirtyCount() };
+		GShader::NameLookups = 0;
+		GShader::Uploads = 0;
+		GUniformBlock::Uploads = 0;
+		GUniformBlock::UploadedBytes = 0;
 	}
 
 	glDeleteVertexArrays(1, &PointLightVAO);
 	glDeleteBuffers(1, &PointLightVBO);
 	glDeleteBuffers(1, &PointLightEBO);
+	glDeleteVertexArrays(1, &ClusteredMarkersVAO);
+	glDeleteBuffers(1, &ClusteredMarkersVBO);
 
 	glDeleteVertexArrays(1, &CylinderVAO);
 	glDeleteBuffers(1, &CylinderVBO);
 	glDeleteBuffers(1, &CylinderEBO);
 
 	glDeleteVertexArrays(1, &GridVAO);
-	glDeleteBuffers(1, &GridVBO);
-	glDeleteBuffers(1, &GridEBO);
+	TerrainPatches.Delete();
+
+	TerrainCache.Delete();
+	HeightMap.Delete();
+	TerrainQuadtree.Delete();
+	TerrainClipmap.Delete();
+	HeightPyramid.Delete();
+	CameraBlock.Delete();
+	LightsBlock.Delete();
+	ClustersBlock.Delete();
+	ClusteredLights.Delete();
+	Deferred.Delete();
+	ShadowCascades.Delete();
+	HeightMaxPyramid.Delete();
+	ShadowsBlock.Delete();
+	TerrainTimer.Delete();
+	LightingTimer.Delete();
+	PrePassTimer.Delete();
+	TerrainFragments.Delete();
+	PrePassFragments.Delete();
+	ShaderWatcher.Delete();
+	TextureLoader.Delete();
 
 	// Cleanup
 	ImGui_ImplOpenGL3_Shutdown();
@@ -619,6 +1417,7 @@ void ArrowInit(unsigned int &VAO, unsigned int &VBO, unsigned int &EBO, int &Arr
 	//int ArrowIndicesSize;
 
 	Generate(Arrow, ArrowIndices, Vertices, Radius, Legth, ArrowSize, ArrowIndicesSize, true);
+	OptimizeVertexCache(ArrowIndices, ArrowIndicesSize, ArrowSize / 6);
 
 	glGenVertexArrays(1, &VAO);
 	glGenBuffers(1, &VBO);
@@ -630,13 +1429,16 @@ void ArrowInit(unsigned int &VAO, unsigned int &VBO, unsigned int &EBO, int &Arr
 	glBufferData(GL_ARRAY_BUFFER, ArrowSize * sizeof(float), Arrow, GL_STATIC_DRAW);
 
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, ArrowIndicesSize * sizeof(float), ArrowIndices, GL_STATIC_DRAW);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, ArrowIndicesSize * sizeof(int), ArrowIndices, GL_STATIC_DRAW);
 
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
 	glEnableVertexAttribArray(0);
 
 	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
 	glEnableVertexAttribArray(1);
+
+	delete[] Arrow;
+	delete[] ArrowIndices;
 }
 
 void PointLightInit(unsigned int &VAO, unsigned int &VBO, unsigned int &EBO, int &PointLightIndicesSize, int Segments, int Rings, float Radius, void(*Generate)(float*&, int*&, int, int, float, int&, int&))
@@ -650,6 +1452,7 @@ void PointLightInit(unsigned int &VAO, unsigned int &VBO, unsigned int &EBO, int
 	//int PointLightIndicesSize;
 
 	Generate(PointLight, PointLightIndices, Segments, Rings, Radius, PointLightSize, PointLightIndicesSize);
+	OptimizeVertexCache(PointLightIndices, PointLightIndicesSize, PointLightSize / 6);
 
 	glGenVertexArrays(1, &VAO);
 	glGenBuffers(1, &VBO);
@@ -661,43 +1464,240 @@ void PointLightInit(unsigned int &VAO, unsigned int &VBO, unsigned int &EBO, int
 	glBufferData(GL_ARRAY_BUFFER, PointLightSize * sizeof(float), PointLight, GL_STATIC_DRAW);
 
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, PointLightIndicesSize * sizeof(float), PointLightIndices, GL_STATIC_DRAW);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, PointLightIndicesSize * sizeof(int), PointLightIndices, GL_STATIC_DRAW);
 
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
 	glEnableVertexAttribArray(0);
 
 	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
 	glEnableVertexAttribArray(1);
+
+	delete[] PointLight;
+	delete[] PointLightIndices;
 }
 
-void GridInit(unsigned int &GridVAO, unsigned int &GridVBO, unsigned int &GridEBO, int &GridIndicesSize, float &SeparationFactor)
+void ClusteredMarkersInit(unsigned int &VAO, unsigned int &InstancesVBO, unsigned int VBO, unsigned int EBO)
 {
-	// in
-	float* Grid;
-	int GridSize;
+	glGenVertexArrays(1, &VAO);
+	glGenBuffers(1, &InstancesVBO);
 
-	// out
-	int* GridIndices;
-	//int GridIndicesSize;
-	//float SeparationFactor;
+	glBindVertexArray(VAO);
 
-	GenerateGrid(Grid, GridIndices, 500, 5.f, GridSize, GridIndicesSize, SeparationFactor);
+	// The point light sphere
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
 
-	// Grid
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
+	glEnableVertexAttribArray(0);
+
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
+	glEnableVertexAttribArray(1);
+
+	// Position and scale of each light
+	glBindBuffer(GL_ARRAY_BUFFER, InstancesVBO);
+	glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+	glEnableVertexAttribArray(2);
+	glVertexAttribDivisor(2, 1);
+
+	glBindVertexArray(0);
+}
+
+void GridInit(unsigned int &GridVAO, int Cells, int &GridVertices, float &SeparationFactor)
+{
+	GridVertices = Cells / 2;
+	SeparationFactor = GetGridSeparationFactor(GridVertices, 5.f);
+
+	// Terrain.vert makes the vertices from gl_VertexID and gl_InstanceID, the VAO is empty
 	glGenVertexArrays(1, &GridVAO);
-	glGenBuffers(1, &GridVBO);
-	glGenBuffers(1, &GridEBO);
+}
+
+void AnimateClusteredLights(std::vector<FClusteredLight> &Lights, int Count, float Height, float Time)
+{
+	Lights.resize(Count);
+	for (int i = 0; i < Count; ++i)
+	{
+		// Orbit, speed and hue fixed per light by a hash of its index
+		float Random[6];
+		unsigned int Hash = (unsigned int)i * 2654435761u + 1u;
+		for (int j = 0; j < 6; ++j)
+		{
+			Hash ^= Hash >> 16;
+			Hash *= 0x7FEB352Du;
+			Hash ^= Hash >> 15;
+			Hash *= 0x846CA68Bu;
+			Hash ^= Hash >> 16;
+			Random[j] = (float)(Hash & 0xFFFFFF) / 16777216.f;
+		}
+
+		glm::vec2 Center(-25.f + 50.f * Random[0], -25.f + 40.f * Random[1]);
+		float Radius = 1.f + 3.f * Random[2];
+		float Angle = Time * (0.5f + Random[3]) + 6.2831853f * Random[4];
+
+		glm::vec3 Color;
+		for (int Channel = 0; Channel < 3; ++Channel)
+		{
+			float Hue = glm::fract(Random[5] + Channel / 3.f);
+			Color[Channel] = glm::clamp(glm::abs(Hue * 6.f - 3.f) - 1.f, 0.f, 1.f);
+		}
 
-	glBindVertexArray(GridVAO);
+		// No ambient, a thousand of them would light everything. Ranges of about 5.6 with the default cutoff.
+		FClusteredLight &Light = Lights[i];
+		Light.Position = glm::vec3(Center.x + Radius * glm::cos(Angle), 0.5f * Height + 2.f + glm::sin(2.f * Angle), Center.y + Radius * glm::sin(Angle));
+		Light.Ambient = glm::vec3(0.f);
+		Light.Diffuse = Color;
+		Light.Specular = 0.5f * Color;
+		Light.Constant = 1.f;
+		Light.Linear = 1.f;
+		Light.Quadratic = 8.f;
+	}
+}
+
+std::vector<FMeshCacheReport> VertexCacheReport(int GridPatchQuads)
+{
+	std::vector<FMeshCacheReport> Reports;
+	float* Vertices;
+	int* Indices;
+	int VerticesSize, IndicesSize;
+
+	GenerateSphere(Vertices, Indices, 32, 16, 1.f, VerticesSize, IndicesSize);
+	Reports.push_back(GetMeshCacheReport("Point light", Indices, IndicesSize, VerticesSize / 6));
+	delete[] Vertices;
+	delete[] Indices;
+
+	GenerateCylinder(Vertices, Indices, 16, 0.01f, 0.2f, VerticesSize, IndicesSize);
+	Reports.push_back(GetMeshCacheReport("Arrow cylinder", Indices, IndicesSize, VerticesSize / 6));
+	delete[] Vertices;
+	delete[] Indices;
+
+	GenerateCone(Vertices, Indices, 16, 0.02f, 0.04f, VerticesSize, IndicesSize);
+	Reports.push_back(GetMeshCacheReport("Arrow cone", Indices, IndicesSize, VerticesSize / 6));
+	delete[] Vertices;
+	delete[] Indices;
+
+	GeneratePatch(Vertices, Indices, GridPatchQuads, VerticesSize, IndicesSize);
+	Reports.push_back(GetMeshCacheReport("Grid patch", Indices, IndicesSize, VerticesSize / 2));
+	delete[] Vertices;
+	delete[] Indices;
+
+	// Smaller than the terrain grid, the reordering takes seconds at full size
+	float SeparationFactor;
+	GenerateGrid(Vertices, Indices, 100, 5.f, VerticesSize, IndicesSize, SeparationFactor);
+	Reports.push_back(GetMeshCacheReport("Grid", Indices, IndicesSize, VerticesSize / 2));
+	delete[] Vertices;
+	delete[] Indices;
+
+	return Reports;
+}
+
+void DrawGridStrips(const GShader &Shader, const FTerrainHandles &Handles, int Cells)
+{
+	Shader.Set4f(Handles.Patch, 0.f, 0.f, 0.f, 0.f);
+	glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 2 * (Cells + 1), Cells);
+}
+
+// Captures the heights and analytic normals of the feedback shader and compares them with fbm_9 on every ISA and fbmd_9
+FNoiseParity NoiseParityCheck(GShader &FeedbackShader, FTerrainHandles &FeedbackHandles, float Width, float Height, float Time, float SeparationFactor, int Samples)
+{
+	std::vector<float> X(Samples);
+	std::vector<float> Y(Samples);
+	std::vector<float> Coordinates(2 * Samples);
+	for (int i = 0; i < Samples; ++i)
+	{
+		X[i] = 5.f * (float)rand() / (float)RAND_MAX - 2.5f;
+		Y[i] = 5.f * (float)rand() / (float)RAND_MAX - 2.5f;
+		InsertVertex2D(Coordinates.data(), 2 * i, X[i], Y[i]);
+	}
+
+	unsigned int VAO, VBO, FeedbackBuffer;
+	glGenVertexArrays(1, &VAO);
+	glGenBuffers(1, &VBO);
+	glGenBuffers(1, &FeedbackBuffer);
 
-	glBindBuffer(GL_ARRAY_BUFFER, GridVBO);
-	glBufferData(GL_ARRAY_BUFFER, GridSize * sizeof(float), Grid, GL_STATIC_DRAW);
+	glBindVertexArray(VAO);
 
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, GridEBO);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, GridIndicesSize * sizeof(float), GridIndices, GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	glBufferData(GL_ARRAY_BUFFER, Coordinates.size() * sizeof(float), Coordinates.data(), GL_STATIC_DRAW);
 
 	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
 	glEnableVertexAttribArray(0);
+
+	// FPosition and FNormal
+	glBindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER, FeedbackBuffer);
+	glBufferData(GL_TRANSFORM_FEEDBACK_BUFFER, 6 * Samples * sizeof(float), NULL, GL_STATIC_READ);
+	glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, FeedbackBuffer);
+
+	FeedbackShader.Use();
+	FeedbackShader.SetMat4(FeedbackHandles.Model, glm::mat4(1.f));
+	SetTerrainUniforms(FeedbackShader, FeedbackHandles, { Width, Height, Time, SeparationFactor, ETerrainNormals::Analytic, ETerrainHeights::Procedural });
+	FeedbackShader.Set1i(FeedbackHandles.GridSource, (int)ETerrainGridSource::Attribute);
+
+	glEnable(GL_RASTERIZER_DISCARD);
+	glBeginTransformFeedback(GL_POINTS);
+	glDrawArrays(GL_POINTS, 0, Samples);
+	glEndTransformFeedback();
+	glDisable(GL_RASTERIZER_DISCARD);
+
+	std::vector<float> Feedback(6 * Samples);
+	glGetBufferSubData(GL_TRANSFORM_FEEDBACK_BUFFER, 0, Feedback.size() * sizeof(float), Feedback.data());
+
+	FNoiseParity Parity = {};
+	float HeightTolerance = NoiseParityHeightTolerance * Height;
+	std::vector<float> Fbm(Samples);
+	for (int ISA = 0; ISA < NoiseISACount; ++ISA)
+	{
+		if (!IsNoiseISASupported((ENoiseISA)ISA))
+		{
+			Parity.HeightErrors[ISA] = -1.f;
+			continue;
+		}
+		Fbm9Batch(X.data(), Y.data(), Fbm.data(), Samples, Time, (ENoiseISA)ISA);
+		for (int i = 0; i < Samples; ++i)
+		{
+			Parity.HeightErrors[ISA] = glm::max(Parity.HeightErrors[ISA], glm::abs((Fbm[i] + 1.f) * (Height / 2.f) - Feedback[6 * i + 1]));
+		}
+	}
+
+	// Same normal as GetAnalyticNormal in Terrain.vert, the model is the identity
+	for (int i = 0; i < Samples; ++i)
+	{
+		glm::vec3 Fbmd = Fbmd9(glm::vec2(X[i], Y[i]), Time);
+		glm::vec3 Normal = glm::normalize(glm::vec3(-Fbmd.y * (Height / 2.f), 1.f, -Fbmd.z * (Height / 2.f)));
+		glm::vec3 FeedbackNormal = glm::normalize(glm::vec3(Feedback[6 * i + 3], Feedback[6 * i + 4], Feedback[6 * i + 5]));
+		Parity.FbmdHeightError = glm::max(Parity.FbmdHeightError, glm::abs((Fbmd.x + 1.f) * (Height / 2.f) - Feedback[6 * i + 1]));
+		Parity.NormalError = glm::max(Parity.NormalError, glm::degrees(glm::acos(glm::clamp(glm::dot(Normal, FeedbackNormal), -1.f, 1.f))));
+	}
+
+	Parity.bPass = Parity.FbmdHeightError <= HeightTolerance && Parity.NormalError <= NoiseParityNormalTolerance;
+	for (int ISA = 0; ISA < NoiseISACount; ++ISA)
+	{
+		Parity.bPass = Parity.bPass && Parity.HeightErrors[ISA] <= HeightTolerance;
+	}
+
+	glDeleteVertexArrays(1, &VAO);
+	glDeleteBuffers(1, &VBO);
+	glDeleteBuffers(1, &FeedbackBuffer);
+
+	return Parity;
+}
+
+// Blocks until the GPU is done, only for benchmarks
+float MeasureDrawMilliseconds(const GShader &Shader, const FTerrainHandles &Handles, int Cells, int Repetitions)
+{
+	unsigned int Query;
+	glGenQueries(1, &Query);
+
+	glBeginQuery(GL_TIME_ELAPSED, Query);
+	for (int i = 0; i < Repetitions; ++i)
+	{
+		DrawGridStrips(Shader, Handles, Cells);
+	}
+	glEndQuery(GL_TIME_ELAPSED);
+
+	GLuint64 Nanoseconds;
+	glGetQueryObjectui64v(Query, GL_QUERY_RESULT, &Nanoseconds);
+	glDeleteQueries(1, &Query);
+
+	return (float)(Nanoseconds / 1e6) / Repetitions;
 }
 
 void ProcessInput(GLFWwindow *Window)
@@ -775,6 +1775,7 @@ void KeyCallback(GLFWwindow* Window, int Key, int ScanCode, int Action, int Mods
 			bDLDemo = false;
 			bPLDemo = false;
 			bSLDemo = false;
+			bCLDemo = false;
 		}
 	}
 
@@ -894,6 +1895,42 @@ void ShowHelp()
 	std::ostringstream FPS;
 	FPS << "FPS: " << ImGui::GetIO().Framerate;
 
+	std::ostringstream Terrain;
+	Terrain.precision(3);
+	Terrain << std::fixed;
+	Terrain << "Terrain GPU: " << TerrainMilliseconds << " ms";
+	if (PrePassMilliseconds > 0.f)
+	{
+		Terrain << ", pre-pass: " << PrePassMilliseconds << " ms";
+	}
+	if (LightingMilliseconds > 0.f)
+	{
+		Terrain << ", lights: " << LightingMilliseconds << " ms";
+	}
+
+	std::ostringstream Fragments;
+	Fragments.precision(2);
+	Fragments << std::fixed;
+	Fragments << "Fragments per pixel: " << FragmentsPerPixel;
+	if (PrePassFragmentsPerPixel > 0.f)
+	{
+		Fragments << ", pre-pass: " << PrePassFragmentsPerPixel;
+	}
+
+	std::ostringstream Culling;
+	Culling << "Tiles: " << TerrainCulling.TilesDrawn << "/" << TerrainCulling.TilesDrawn + TerrainCulling.TilesCulled;
+	Culling << ", tris: " << TerrainCulling.TrianglesDrawn / 1000 << "k/" << (TerrainCulling.TrianglesDrawn + TerrainCulling.TrianglesCulled) / 1000 << "k";
+	if (TerrainCulling.TilesOccluded > 0)
+	{
+		Culling << ", occluded: " << TerrainCulling.TilesOccluded;
+	}
+
+	std::ostringstream UploadsText;
+	UploadsText << "Uploads: " << Uploads.Uniforms << " uniforms, " << Uploads.Blocks << " blocks (" << Uploads.BlockBytes << " B)";
+
+	std::ostringstream SceneText;
+	SceneText << "Scene v" << Uploads.SceneVersion << ", fields changed: " << Uploads.SceneFieldsChanged << ", lookups: " << Uploads.NameLookups;
+
 	ImGuiStyle& Style = ImGui::GetStyle();
 	ImGuiContext* Context = ImGui::GetCurrentContext();
 
@@ -935,6 +1972,17 @@ void ShowHelp()
 
 	ImGui::Button(FOV.str().c_str(), ImVec2(300.f, 0.f));
 
+	ImGui::Button(Terrain.str().c_str(), ImVec2(300.f, 0.f));
+	ImGui::Button(Fragments.str().c_str(), ImVec2(300.f, 0.f));
+
+	if (TerrainCulling.TilesDrawn + TerrainCulling.TilesCulled > 0)
+	{
+		ImGui::Button(Culling.str().c_str(), ImVec2(300.f, 0.f));
+	}
+
+	ImGui::Button(UploadsText.str().c_str(), ImVec2(300.f, 0.f));
+	ImGui::Button(SceneText.str().c_str(), ImVec2(300.f, 0.f));
+
 	ImGui::PopStyleColor(2);
 
 	FPSValues[FPSValuesOffset] = ImGui::GetIO().Framerate;
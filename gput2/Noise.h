@@ -0,0 +1,420 @@
+#pragma once
+
+#include <cmath>
+#include <chrono>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define NOISE_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// GCC and Clang need the target spelled out to emit AVX2 code in a function, MSVC accepts the intrinsics anywhere
+#if defined(NOISE_X86) && (defined(__GNUC__) || defined(__clang__))
+#define NOISE_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define NOISE_TARGET_AVX2
+#endif
+
+// CPU port of the hashes, noises and fbms of Shaders/Terrain.vert.
+// Every constant and every operation keeps the order of the GLSL code so the results match the vertex shader up to float rounding.
+
+enum class ENoiseISA
+{
+	Scalar,
+	SSE2,
+	AVX2
+};
+const int NoiseISACount = 3;
+
+// fbm_9 rotation already multiplied by its frequency (f * m2), as the shader evaluates it
+const float NoiseFrequency = 1.9f;
+const float NoiseM2[4] = { NoiseFrequency * 0.8f, NoiseFrequency * 0.6f, NoiseFrequency * -0.6f, NoiseFrequency * 0.8f };
+const float NoiseM2i[4] = { NoiseFrequency * 0.8f, NoiseFrequency * -0.6f, NoiseFrequency * 0.6f, NoiseFrequency * 0.8f };
+
+//// Scalar
+
+float NoiseFract(float X)
+{
+	return X - std::floor(X);
+}
+
+float NoiseHash1(float X, float Y)
+{
+	X = 50.f * NoiseFract(X * 0.3183099f);
+	Y = 50.f * NoiseFract(Y * 0.3183099f);
+	return NoiseFract(X * Y * (X + Y));
+}
+
+float Noise(float X, float Y)
+{
+	float PX = std::floor(X);
+	float PY = std::floor(Y);
+	float WX = X - PX;
+	float WY = Y - PY;
+
+	float UX = WX * WX * WX * (WX * (WX * 6.f - 15.f) + 10.f);
+	float UY = WY * WY * WY * (WY * (WY * 6.f - 15.f) + 10.f);
+
+	float A = NoiseHash1(PX, PY);
+	float B = NoiseHash1(PX + 1.f, PY);
+	float C = NoiseHash1(PX, PY + 1.f);
+	float D = NoiseHash1(PX + 1.f, PY + 1.f);
+
+	return -1.f + 2.f * (A + (B - A) * UX + (C - A) * UY + (A - B - C + D) * UX * UY);
+}
+
+// Value noise and its analytical derivatives (x: value, y: d/dx, z: d/dy)
+glm::vec3 NoiseD(float X, float Y)
+{
+	float PX = std::floor(X);
+	float PY = std::floor(Y);
+	float WX = X - PX;
+	float WY = Y - PY;
+
+	float UX = WX * WX * WX * (WX * (WX * 6.f - 15.f) + 10.f);
+	float UY = WY * WY * WY * (WY * (WY * 6.f - 15.f) + 10.f);
+	float DUX = 30.f * WX * WX * (WX * (WX - 2.f) + 1.f);
+	float DUY = 30.f * WY * WY * (WY * (WY - 2.f) + 1.f);
+
+	float A = NoiseHash1(PX, PY);
+	float B = NoiseHash1(PX + 1.f, PY);
+	float C = NoiseHash1(PX, PY + 1.f);
+	float D = NoiseHash1(PX + 1.f, PY + 1.f);
+
+	float K0 = A;
+	float K1 = B - A;
+	float K2 = C - A;
+	float K4 = A - B - C + D;
+
+	return glm::vec3(-1.f + 2.f * (K0 + K1 * UX + K2 * UY + K4 * UX * UY),
+		2.f * DUX * (K1 + K4 * UY),
+		2.f * DUY * (K2 + K4 * UX));
+}
+
+// fbm_9(x) of Terrain.vert, Time is UTime
+float Fbm9(glm::vec2 Position, float Time)
+{
+	float X = Position.x;
+	float Y = Position.y;
+	float A = 0.f;
+	float B = 0.5f;
+	for (int i = 0; i < 9; ++i)
+	{
+		float N = Noise(X + Time, Y + Time);
+		A += B * N;
+		B *= 0.55f;
+		float RX = NoiseM2[0] * X + NoiseM2[2] * Y;
+		float RY = NoiseM2[1] * X + NoiseM2[3] * Y;
+		X = RX;
+		Y = RY;
+	}
+	return A;
+}
+
+// fbmd_9(x) of Terrain.vert with UTime folded in the same way fbm_9 does (x: value, yz: gradient)
+glm::vec3 Fbmd9(glm::vec2 Position, float Time)
+{
+	float X = Position.x;
+	float Y = Position.y;
+	float A = 0.f;
+	float B = 0.5f;
+	glm::vec2 D(0.f);
+	// Column major, like the GLSL mat2
+	float M[4] = { 1.f, 0.f, 0.f, 1.f };
+	for (int i = 0; i < 9; ++i)
+	{
+		glm::vec3 N = NoiseD(X + Time, Y + Time);
+		A += B * N.x;
+		D.x += B * (M[0] * N.y + M[2] * N.z);
+		D.y += B * (M[1] * N.y + M[3] * N.z);
+		B *= 0.55f;
+		float RX = NoiseM2[0] * X + NoiseM2[2] * Y;
+		float RY = NoiseM2[1] * X + NoiseM2[3] * Y;
+		X = RX;
+		Y = RY;
+		float M0 = NoiseM2i[0] * M[0] + NoiseM2i[2] * M[1];
+		float M1 = NoiseM2i[1] * M[0] + NoiseM2i[3] * M[1];
+		float M2 = NoiseM2i[0] * M[2] + NoiseM2i[2] * M[3];
+		float M3 = NoiseM2i[1] * M[2] + NoiseM2i[3] * M[3];
+		M[0] = M0; M[1] = M1; M[2] = M2; M[3] = M3;
+	}
+	return glm::vec3(A, D);
+}
+
+void Fbm9BatchScalar(const float* X, const float* Y, float* Out, int Count, float Time)
+{
+	for (int i = 0; i < Count; ++i)
+	{
+		Out[i] = Fbm9(glm::vec2(X[i], Y[i]), Time);
+	}
+}
+
+#ifdef NOISE_X86
+//// SSE2, 4 points per call
+
+// _mm_floor_ps is SSE4.1, truncate and step down the negative non integers instead
+__m128 NoiseFloorSSE2(__m128 X)
+{
+	__m128 T = _mm_cvtepi32_ps(_mm_cvttps_epi32(X));
+	return _mm_sub_ps(T, _mm_and_ps(_mm_cmpgt_ps(T, X), _mm_set1_ps(1.f)));
+}
+
+__m128 NoiseFractSSE2(__m128 X)
+{
+	return _mm_sub_ps(X, NoiseFloorSSE2(X));
+}
+
+__m128 NoiseHash1SSE2(__m128 X, __m128 Y)
+{
+	const __m128 K = _mm_set1_ps(0.3183099f);
+	const __m128 Fifty = _mm_set1_ps(50.f);
+	X = _mm_mul_ps(Fifty, NoiseFractSSE2(_mm_mul_ps(X, K)));
+	Y = _mm_mul_ps(Fifty, NoiseFractSSE2(_mm_mul_ps(Y, K)));
+	return NoiseFractSSE2(_mm_mul_ps(_mm_mul_ps(X, Y), _mm_add_ps(X, Y)));
+}
+
+__m128 NoiseSSE2(__m128 X, __m128 Y)
+{
+	const __m128 One = _mm_set1_ps(1.f);
+	const __m128 Two = _mm_set1_ps(2.f);
+
+	__m128 PX = NoiseFloorSSE2(X);
+	__m128 PY = NoiseFloorSSE2(Y);
+	__m128 WX = _mm_sub_ps(X, PX);
+	__m128 WY = _mm_sub_ps(Y, PY);
+
+	__m128 UX = _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(WX, WX), WX), _mm_add_ps(_mm_mul_ps(WX, _mm_sub_ps(_mm_mul_ps(WX, _mm_set1_ps(6.f)), _mm_set1_ps(15.f))), _mm_set1_ps(10.f)));
+	__m128 UY = _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(WY, WY), WY), _mm_add_ps(_mm_mul_ps(WY, _mm_sub_ps(_mm_mul_ps(WY, _mm_set1_ps(6.f)), _mm_set1_ps(15.f))), _mm_set1_ps(10.f)));
+
+	__m128 PX1 = _mm_add_ps(PX, One);
+	__m128 PY1 = _mm_add_ps(PY, One);
+	__m128 A = NoiseHash1SSE2(PX, PY);
+	__m128 B = NoiseHash1SSE2(PX1, PY);
+	__m128 C = NoiseHash1SSE2(PX, PY1);
+	__m128 D = NoiseHash1SSE2(PX1, PY1);
+
+	// A + (B - A) * UX + (C - A) * UY + (A - B - C + D) * UX * UY
+	__m128 Sum = _mm_add_ps(A, _mm_mul_ps(_mm_sub_ps(B, A), UX));
+	Sum = _mm_add_ps(Sum, _mm_mul_ps(_mm_sub_ps(C, A), UY));
+	Sum = _mm_add_ps(Sum, _mm_mul_ps(_mm_mul_ps(_mm_add_ps(_mm_sub_ps(_mm_sub_ps(A, B), C), D), UX), UY));
+
+	return _mm_add_ps(_mm_set1_ps(-1.f), _mm_mul_ps(Two, Sum));
+}
+
+void Fbm9BatchSSE2(const float* X, const float* Y, float* Out, int Count, float Time)
+{
+	const __m128 T = _mm_set1_ps(Time);
+	const __m128 M0 = _mm_set1_ps(NoiseM2[0]);
+	const __m128 M1 = _mm_set1_ps(NoiseM2[1]);
+	const __m128 M2 = _mm_set1_ps(NoiseM2[2]);
+	const __m128 M3 = _mm_set1_ps(NoiseM2[3]);
+
+	int i = 0;
+	for (; i + 4 <= Count; i += 4)
+	{
+		__m128 PX = _mm_loadu_ps(X + i);
+		__m128 PY = _mm_loadu_ps(Y + i);
+		__m128 A = _mm_setzero_ps();
+		float B = 0.5f;
+		for (int Octave = 0; Octave < 9; ++Octave)
+		{
+			__m128 N = NoiseSSE2(_mm_add_ps(PX, T), _mm_add_ps(PY, T));
+			A = _mm_add_ps(A, _mm_mul_ps(_mm_set1_ps(B), N));
+			B *= 0.55f;
+			__m128 RX = _mm_add_ps(_mm_mul_ps(M0, PX), _mm_mul_ps(M2, PY));
+			__m128 RY = _mm_add_ps(_mm_mul_ps(M1, PX), _mm_mul_ps(M3, PY));
+			PX = RX;
+			PY = RY;
+		}
+		_mm_storeu_ps(Out + i, A);
+	}
+	Fbm9BatchScalar(X + i, Y + i, Out + i, Count - i, Time);
+}
+
+//// AVX2, 8 points per call
+
+NOISE_TARGET_AVX2 __m256 NoiseFractAVX2(__m256 X)
+{
+	return _mm256_sub_ps(X, _mm256_floor_ps(X));
+}
+
+NOISE_TARGET_AVX2 __m256 NoiseHash1AVX2(__m256 X, __m256 Y)
+{
+	const __m256 K = _mm256_set1_ps(0.3183099f);
+	const __m256 Fifty = _mm256_set1_ps(50.f);
+	X = _mm256_mul_ps(Fifty, NoiseFractAVX2(_mm256_mul_ps(X, K)));
+	Y = _mm256_mul_ps(Fifty, NoiseFractAVX2(_mm256_mul_ps(Y, K)));
+	return NoiseFractAVX2(_mm256_mul_ps(_mm256_mul_ps(X, Y), _mm256_add_ps(X, Y)));
+}
+
+// No FMA on purpose, fused results would drift away from the scalar and GLSL rounding
+NOISE_TARGET_AVX2 __m256 NoiseAVX2(__m256 X, __m256 Y)
+{
+	const __m256 One = _mm256_set1_ps(1.f);
+	const __m256 Two = _mm256_set1_ps(2.f);
+
+	__m256 PX = _mm256_floor_ps(X);
+	__m256 PY = _mm256_floor_ps(Y);
+	__m256 WX = _mm256_sub_ps(X, PX);
+	__m256 WY = _mm256_sub_ps(Y, PY);
+
+	__m256 UX = _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(WX, WX), WX), _mm256_add_ps(_mm256_mul_ps(WX, _mm256_sub_ps(_mm256_mul_ps(WX, _mm256_set1_ps(6.f)), _mm256_set1_ps(15.f))), _mm256_set1_ps(10.f)));
+	__m256 UY = _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(WY, WY), WY), _mm256_add_ps(_mm256_mul_ps(WY, _mm256_sub_ps(_mm256_mul_ps(WY, _mm256_set1_ps(6.f)), _mm256_set1_ps(15.f))), _mm256_set1_ps(10.f)));
+
+	__m256 PX1 = _mm256_add_ps(PX, One);
+	__m256 PY1 = _mm256_add_ps(PY, One);
+	__m256 A = NoiseHash1AVX2(PX, PY);
+	__m256 B = NoiseHash1AVX2(PX1, PY);
+	__m256 C = NoiseHash1AVX2(PX, PY1);
+	__m256 D = NoiseHash1AVX2(PX1, PY1);
+
+	__m256 Sum = _mm256_add_ps(A, _mm256_mul_ps(_mm256_sub_ps(B, A), UX));
+	Sum = _mm256_add_ps(Sum, _mm256_mul_ps(_mm256_sub_ps(C, A), UY));
+	Sum = _mm256_add_ps(Sum, _mm256_mul_ps(_mm256_mul_ps(_mm256_add_ps(_mm256_sub_ps(_mm256_sub_ps(A, B), C), D), UX), UY));
+
+	return _mm256_add_ps(_mm256_set1_ps(-1.f), _mm256_mul_ps(Two, Sum));
+}
+
+NOISE_TARGET_AVX2 void Fbm9BatchAVX2(const float* X, const float* Y, float* Out, int Count, float Time)
+{
+	const __m256 T = _mm256_set1_ps(Time);
+	const __m256 M0 = _mm256_set1_ps(NoiseM2[0]);
+	const __m256 M1 = _mm256_set1_ps(NoiseM2[1]);
+	const __m256 M2 = _mm256_set1_ps(NoiseM2[2]);
+	const __m256 M3 = _mm256_set1_ps(NoiseM2[3]);
+
+	int i = 0;
+	for (; i + 8 <= Count; i += 8)
+	{
+		__m256 PX = _mm256_loadu_ps(X + i);
+		__m256 PY = _mm256_loadu_ps(Y + i);
+		__m256 A = _mm256_setzero_ps();
+		float B = 0.5f;
+		for (int Octave = 0; Octave < 9; ++Octave)
+		{
+			__m256 N = NoiseAVX2(_mm256_add_ps(PX, T), _mm256_add_ps(PY, T));
+			A = _mm256_add_ps(A, _mm256_mul_ps(_mm256_set1_ps(B), N));
+			B *= 0.55f;
+			__m256 RX = _mm256_add_ps(_mm256_mul_ps(M0, PX), _mm256_mul_ps(M2, PY));
+			__m256 RY = _mm256_add_ps(_mm256_mul_ps(M1, PX), _mm256_mul_ps(M3, PY));
+			PX = RX;
+			PY = RY;
+		}
+		_mm256_storeu_ps(Out + i, A);
+	}
+	Fbm9BatchSSE2(X + i, Y + i, Out + i, Count - i, Time);
+}
+#endif
+
+//// Dispatch
+
+bool IsNoiseISASupported(ENoiseISA ISA)
+{
+	if (ISA == ENoiseISA::Scalar)
+	{
+		return true;
+	}
+#ifdef NOISE_X86
+	if (ISA == ENoiseISA::SSE2)
+	{
+		return true;
+	}
+#ifdef _MSC_VER
+	int Info[4];
+	__cpuid(Info, 0);
+	if (Info[0] < 7)
+	{
+		return false;
+	}
+	__cpuid(Info, 1);
+	bool bOSXSave = (Info[2] & (1 << 27)) != 0;
+	bool bAVX = (Info[2] & (1 << 28)) != 0;
+	if (!bOSXSave || !bAVX || (_xgetbv(0) & 0x6) != 0x6) /* The OS has to save the YMM registers */
+	{
+		return false;
+	}
+	__cpuidex(Info, 7, 0);
+	return (Info[1] & (1 << 5)) != 0;
+#else
+	return __builtin_cpu_supports("avx2");
+#endif
+#else
+	return false;
+#endif
+}
+
+ENoiseISA GetNoiseISA()
+{
+	static const ENoiseISA ISA = IsNoiseISASupported(ENoiseISA::AVX2) ? ENoiseISA::AVX2 : (IsNoiseISASupported(ENoiseISA::SSE2) ? ENoiseISA::SSE2 : ENoiseISA::Scalar);
+	return ISA;
+}
+
+const char* GetNoiseISAName(ENoiseISA ISA)
+{
+	switch (ISA)
+	{
+	case ENoiseISA::SSE2:
+		return "SSE2";
+	case ENoiseISA::AVX2:
+		return "AVX2";
+	default:
+		return "Scalar";
+	}
+}
+
+// Evaluates fbm_9 for Count points given as separate X and Y arrays
+void Fbm9Batch(const float* X, const float* Y, float* Out, int Count, float Time, ENoiseISA ISA = GetNoiseISA())
+{
+#ifdef NOISE_X86
+	if (ISA == ENoiseISA::AVX2)
+	{
+		Fbm9BatchAVX2(X, Y, Out, Count, Time);
+		return;
+	}
+	if (ISA == ENoiseISA::SSE2)
+	{
+		Fbm9BatchSSE2(X, Y, Out, Count, Time);
+		return;
+	}
+#endif
+	Fbm9BatchScalar(X, Y, Out, Count, Time);
+}
+
+// Single thread throughput of Fbm9Batch, in points per second
+double Fbm9Benchmark(ENoiseISA ISA, int Points = 1 << 18)
+{
+	std::vector<float> X(Points), Y(Points), Out(Points);
+	for (int i = 0; i < Points; ++i)
+	{
+		X[i] = 5.f * (float)(i % 1024) / 1024.f - 2.5f;
+		Y[i] = 5.f * (float)(i / 1024) / 1024.f - 2.5f;
+	}
+
+	auto Start = std::chrono::high_resolution_clock::now();
+	Fbm9Batch(X.data(), Y.data(), Out.data(), Points, 10.f, ISA);
+	auto End = std::chrono::high_resolution_clock::now();
+
+	double Seconds = std::chrono::duration<double>(End - Start).count();
+	return Seconds > 0.0 ? Points / Seconds : 0.0;
+}
+
+// Largest differences between the CPU noise and a capture of the terrain vertex shader with analytic normals
+struct FNoiseParity
+{
+	// fbm_9 heights of each ISA, in world units, negative when the CPU lacks it
+	float HeightErrors[NoiseISACount];
+	// fbmd_9, only ported as scalar, value in world units and normal in degrees
+	float FbmdHeightError;
+	float NormalError;
+	bool bPass;
+};
+
+// Heights pass within this fraction of the terrain height, float rounding and fused operations on the GPU stay well under it
+const float NoiseParityHeightTolerance = 1e-3f;
+const float NoiseParityNormalTolerance = 1.f;
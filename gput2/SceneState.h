@@ -0,0 +1,203 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstring>
+
+#include "Terrain.h"
+
+// Lights and terrain settings edited from the menu and animated by the demos
+struct FSceneSettings
+{
+	// Directional Light
+	bool bUseDirectionalLight = true;
+	glm::vec2 DLDirection = glm::vec2(0.f, -45.f);
+	glm::vec3 DLAmbient = glm::vec3(0.5f);
+	glm::vec3 DLDiffuse = glm::vec3(0.5f);
+	glm::vec3 DLSpectular = glm::vec3(0.5f);
+
+	// Point Light
+	bool bUsePointLight = true;
+	glm::vec3 PLPosition = glm::vec3(0.f, 7.f, 10.f);
+	glm::vec3 PLAmbient = glm::vec3(0.25f);
+	glm::vec3 PLDiffuse = glm::vec3(0.75f);
+	glm::vec3 PLSpectular = glm::vec3(1.f);
+	float PLConstant = 1.f;
+	float PLLinear = 0.022f;
+	float PLQuadratic = 0.0019f;
+
+	// Spot Light
+	bool bUseSpotLight = true;
+	glm::vec3 SLAmbient = glm::vec3(0.f);
+	glm::vec3 SLDiffuse = glm::vec3(1.f);
+	glm::vec3 SLSpectular = glm::vec3(1.f);
+	float SLConstant = 1.f;
+	float SLLinear = 0.09f;
+	float SLQuadratic = 0.032f;
+	float SLCutOff = 12.5f;
+	float SLOuterCutOff = 15.f;
+
+	// Clustered Lights, the lights themselves are animated outside the scene
+	bool bUseClusteredLights = true;
+
+	// Terrain
+	float Lenght = 10.f;
+	float UHeight = 10.f;
+	ETerrainNormals TerrainNormals = ETerrainNormals::FiniteDifferences;
+};
+
+// Fields of FSceneSettings in declaration order, one dirty bit each
+enum class ESceneField
+{
+	UseDirectionalLight,
+	DLDirection,
+	DLAmbient,
+	DLDiffuse,
+	DLSpectular,
+
+	UsePointLight,
+	PLPosition,
+	PLAmbient,
+	PLDiffuse,
+	PLSpectular,
+	PLConstant,
+	PLLinear,
+	PLQuadratic,
+
+	UseSpotLight,
+	SLAmbient,
+	SLDiffuse,
+	SLSpectular,
+	SLConstant,
+	SLLinear,
+	SLQuadratic,
+	SLCutOff,
+	SLOuterCutOff,
+
+	UseClusteredLights,
+
+	Lenght,
+	UHeight,
+	TerrainNormals,
+
+	Count
+};
+
+static_assert((int)ESceneField::Count <= 32, "Scene dirty bits don't fit an unsigned int");
+
+// Bytes of a field inside FSceneSettings
+struct FSceneField
+{
+	size_t Offset;
+	size_t Size;
+};
+
+// Indexed by ESceneField
+const FSceneField SceneFields[] =
+{
+	{ offsetof(FSceneSettings, bUseDirectionalLight), sizeof(FSceneSettings::bUseDirectionalLight) },
+	{ offsetof(FSceneSettings, DLDirection), sizeof(FSceneSettings::DLDirection) },
+	{ offsetof(FSceneSettings, DLAmbient), sizeof(FSceneSettings::DLAmbient) },
+	{ offsetof(FSceneSettings, DLDiffuse), sizeof(FSceneSettings::DLDiffuse) },
+	{ offsetof(FSceneSettings, DLSpectular), sizeof(FSceneSettings::DLSpectular) },
+
+	{ offsetof(FSceneSettings, bUsePointLight), sizeof(FSceneSettings::bUsePointLight) },
+	{ offsetof(FSceneSettings, PLPosition), sizeof(FSceneSettings::PLPosition) },
+	{ offsetof(FSceneSettings, PLAmbient), sizeof(FSceneSettings::PLAmbient) },
+	{ offsetof(FSceneSettings, PLDiffuse), sizeof(FSceneSettings::PLDiffuse) },
+	{ offsetof(FSceneSettings, PLSpectular), sizeof(FSceneSettings::PLSpectular) },
+	{ offsetof(FSceneSettings, PLConstant), sizeof(FSceneSettings::PLConstant) },
+	{ offsetof(FSceneSettings, PLLinear), sizeof(FSceneSettings::PLLinear) },
+	{ offsetof(FSceneSettings, PLQuadratic), sizeof(FSceneSettings::PLQuadratic) },
+
+	{ offsetof(FSceneSettings, bUseSpotLight), sizeof(FSceneSettings::bUseSpotLight) },
+	{ offsetof(FSceneSettings, SLAmbient), sizeof(FSceneSettings::SLAmbient) },
+	{ offsetof(FSceneSettings, SLDiffuse), sizeof(FSceneSettings::SLDiffuse) },
+	{ offsetof(FSceneSettings, SLSpectular), sizeof(FSceneSettings::SLSpectular) },
+	{ offsetof(FSceneSettings, SLConstant), sizeof(FSceneSettings::SLConstant) },
+	{ offsetof(FSceneSettings, SLLinear), sizeof(FSceneSettings::SLLinear) },
+	{ offsetof(FSceneSettings, SLQuadratic), sizeof(FSceneSettings::SLQuadratic) },
+	{ offsetof(FSceneSettings, SLCutOff), sizeof(FSceneSettings::SLCutOff) },
+	{ offsetof(FSceneSettings, SLOuterCutOff), sizeof(FSceneSettings::SLOuterCutOff) },
+
+	{ offsetof(FSceneSettings, bUseClusteredLights), sizeof(FSceneSettings::bUseClusteredLights) },
+
+	{ offsetof(FSceneSettings, Lenght), sizeof(FSceneSettings::Lenght) },
+	{ offsetof(FSceneSettings, UHeight), sizeof(FSceneSettings::UHeight) },
+	{ offsetof(FSceneSettings, TerrainNormals), sizeof(FSceneSettings::TerrainNormals) }
+};
+
+static_assert(sizeof(SceneFields) / sizeof(SceneFields[0]) == (size_t)ESceneField::Count, "A scene field is missing its offset");
+
+// The settings edited in place, plus which fields changed at the last commit. Anything drawn from the settings
+// only has to be sent again when its fields are dirty.
+class GSceneState : public FSceneSettings
+{
+public:
+	GSceneState();
+
+	// Marks the fields changed since the previous commit, a new version starts when any did. Once per frame,
+	// after the menu and the demos.
+	void Commit();
+
+	bool IsDirty(ESceneField Field) const;
+	// Any field from First to Last, both included
+	bool IsDirty(ESceneField First, ESceneField Last) const;
+	int GetDirtyCount() const;
+
+public:
+	unsigned int Version;
+	unsigned int DirtyFields;
+
+private:
+	FSceneSettings Committed;
+};
+
+__forceinline GSceneState::GSceneState() : Version(0), DirtyFields(0)
+{
+	// Everything is dirty on the first commit
+	std::memset((void*)&Committed, 0xFF, sizeof(FSceneSettings));
+}
+
+__forceinline void GSceneState::Commit()
+{
+	const char* Current = (const char*)static_cast<const FSceneSettings*>(this);
+	char* Previous = (char*)&Committed;
+
+	DirtyFields = 0;
+	for (int Field = 0; Field < (int)ESceneField::Count; ++Field)
+	{
+		const FSceneField &Bytes = SceneFields[Field];
+		if (std::memcmp(Current + Bytes.Offset, Previous + Bytes.Offset, Bytes.Size) != 0)
+		{
+			std::memcpy(Previous + Bytes.Offset, Current + Bytes.Offset, Bytes.Size);
+			DirtyFields |= 1u << Field;
+		}
+	}
+	if (DirtyFields != 0)
+	{
+		++Version;
+	}
+}
+
+__forceinline bool GSceneState::IsDirty(ESceneField Field) const
+{
+	return (DirtyFields & (1u << (int)Field)) != 0;
+}
+
+__forceinline bool GSceneState::IsDirty(ESceneField First, ESceneField Last) const
+{
+	unsigned int Mask = (2u << (int)Last) - (1u << (int)First);
+	return (DirtyFields & Mask) != 0;
+}
+
+__forceinline int GSceneState::GetDirtyCount() const
+{
+	int Count = 0;
+	for (unsigned int Bits = DirtyFields; Bits != 0; Bits &= Bits - 1)
+	{
+		++Count;
+	}
+	return Count;
+}
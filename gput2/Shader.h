@@ -6,17 +6,95 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
 
 #include "Utils.h"
 
+// Programs made from source or from a cached binary
+struct FShaderLoads
+{
+	int Count;
+	float Milliseconds;
+};
+
+// Shader file embedded at build time by EmbedShaders.py, Hash is HashBytes of Code
+struct FShaderSource
+{
+	const char* Name;
+	const char* Code;
+	unsigned long long Hash;
+};
+
+// Program compiled and linked by the driver while the last one stays in use, Program is 0 while nothing is building
+struct FProgramBuild
+{
+	unsigned int Vertex = 0;
+	unsigned int Fragment = 0;
+	unsigned int Program = 0;
+	bool bFromCache = false;
+	std::string VertexSource;
+	std::string FragmentSource;
+	unsigned long long VertexHash = 0;
+	unsigned long long FragmentHash = 0;
+	std::string BinaryPath;
+	std::chrono::high_resolution_clock::time_point Start;
+};
+
+// GL_KHR_parallel_shader_compile, not in the glad profile
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+// Location of a uniform resolved once, setting it through the handle skips the name lookup
+struct FUniform
+{
+	int Location;
+};
+
 class GShader
 {
 public:
-	GShader(const char* VertexPath, const char* FragmentPath);
-	GShader(int VertexResource, int FragmentResource);
+	GShader(const char* VertexPath, const char* FragmentPath, const char* const* FeedbackVaryings = NULL, int FeedbackVaryingsCount = 0);
+	// Sources embedded in ShaderSources.h, their hashes are already known
+	GShader(const FShaderSource &Vertex, const FShaderSource &Fragment, const char* const* FeedbackVaryings = NULL, int FeedbackVaryingsCount = 0);
+	// Fragment with FragmentInclude, code shared by several fragment shaders, spliced in after its #version
+	GShader(const FShaderSource &Vertex, const FShaderSource &Fragment, const FShaderSource &FragmentInclude, const char* const* FeedbackVaryings = NULL, int FeedbackVaryingsCount = 0);
 
-	void InitShader(const char* VertexPath, const char* FragmentPath);
+	// FeedbackVaryings are captured interleaved through transform feedback, they have to be known before linking.
+	// The linked program comes from the binary cache when an earlier run already built the same sources on the same driver.
+	void InitShader(const char* VertexPath, const char* FragmentPath, const char* const* FeedbackVaryings = NULL, int FeedbackVaryingsCount = 0);
 	void Use();
+
+	// Builds the program and its permutations again from new sources without waiting, the current programs stay in use
+	// until Update swaps in the ones that link. Those that don't are dropped and their errors printed.
+	void Reload(const char* VertexCode, const char* FragmentCode);
+	// Swaps in the programs that finished building, this one or its permutations, without blocking where the driver
+	// compiles in parallel. Returns true when any did, their uniform handles have to be resolved again.
+	bool Update();
+	bool IsBuilding() const;
+	// GL_KHR_parallel_shader_compile or its ARB version, the link status can be polled without waiting
+	static bool IsParallelCompileSupported();
+
+	// Program of the same sources with Defines ("#define NAME VALUE\n" lines) after the #version line, so the branches
+	// they turn off are not compiled in. Built in the background the first time it's asked for and kept by this shader,
+	// this program is returned until it links.
+	GShader &GetPermutation(const std::string &Defines);
+	int GetPermutationsCount() const;
+	// Source with Include, declarations and functions without a #version, right after the #version line. The errors in
+	// Include point to its own lines, as source string 1.
+	static std::string IncludeSource(const std::string &Source, const std::string &Include);
+	// Sets up this program and its permutations, in use, right after they link. It also runs now on the linked ones.
+	void SetOnLink(const std::function<void(GShader&)> &OnLink);
+
+	// Handle of an active uniform, with location -1 (ignored by the sets) when the program doesn't use it
+	FUniform GetUniform(const char* Name) const;
+
 	void SetBool(const char* Name, bool Value) const;
 	void Set1i(const char* Name, int Value1) const;
 	void Set1f(const char* Name, float Value1) const;
@@ -29,67 +107,476 @@ public:
 	void SetMatrix4fv(const char* Name, float* Value) const;
 	void SetMat4(const char* Name, glm::mat4 Matrix) const;
 
+	void SetBool(FUniform Uniform, bool Value) const;
+	void Set1i(FUniform Uniform, int Value1) const;
+	void Set1f(FUniform Uniform, float Value1) const;
+	void Set2f(FUniform Uniform, float Value1, float Value2) const;
+	void Set3f(FUniform Uniform, float Value1, float Value2, float Value3) const;
+	void Set4f(FUniform Uniform, float Value1, float Value2, float Value3, float Value4) const;
+	void Set3fv(FUniform Uniform, float* Vector) const;
+	void SetVec3(FUniform Uniform, glm::vec3 Vector) const;
+	void SetVec2r(FUniform Uniform, glm::vec2 Rotation) const;
+	void SetMatrix4fv(FUniform Uniform, float* Value) const;
+	void SetMat4(FUniform Uniform, glm::mat4 Matrix) const;
+
 public:
 	unsigned int Id;
+	// Whether the last InitShader loaded a cached binary instead of compiling, and how long it took
+	bool bFromCache;
+	float InitMilliseconds;
+
+	// Folder of the program binaries, empty disables the cache
+	static std::string CacheDirectory;
+	static FShaderLoads Compiled;
+	static FShaderLoads Cached;
+
+	// Uniform names looked up by every shader, the render loop holds handles so it stays at 0 during a frame
+	static int NameLookups;
+	// Uniforms set by every shader
+	static int Uploads;
+
+private:
+	GShader();
+
+	// Sources and their hashes, which key the binary cache
+	void InitShader(const char* VertexCode, const char* FragmentCode, unsigned long long VertexHash, unsigned long long FragmentHash, const char* const* FeedbackVaryings, int FeedbackVaryingsCount);
+
+	// Starts compiling and linking the sources, or loads their cached binary, replacing any build in progress
+	void StartBuild(const std::string &VertexCode, const std::string &FragmentCode, unsigned long long VertexHash, unsigned long long FragmentHash);
+	bool IsBuildReady() const;
+	// Waits for the build if it's not ready, swaps it in if it linked. Returns whether it did.
+	bool FinishBuild();
+	void CancelBuild();
+	std::vector<const char*> GetVaryings() const;
+	static std::string InjectDefines(const std::string &Source, const std::string &Defines);
+
+	// Cache file of the sources for the current driver and renderer, empty when the cache is disabled or not supported
+	std::string GetBinaryPath(unsigned long long VertexHash, unsigned long long FragmentHash, const char* const* FeedbackVaryings, int FeedbackVaryingsCount) const;
+	// Returns the program, or 0 and deletes the file when the driver rejects the binary
+	unsigned int LoadBinary(const std::string &Path) const;
+	void SaveBinary(const std::string &Path) const;
+
+	// Fills Locations with every active uniform of the linked program
+	void ReflectUniforms();
+
+	std::unordered_map<std::string, int> Locations;
+
+	// Sources of the program in use, the permutations are made from them
+	std::string VertexSource;
+	std::string FragmentSource;
+	unsigned long long VertexHash;
+	unsigned long long FragmentHash;
+	std::vector<std::string> Varyings;
+	FProgramBuild Build;
+
+	std::unordered_map<std::string, std::unique_ptr<GShader>> Permutations;
+	std::function<void(GShader&)> LinkSetup;
 };
 
-__forceinline GShader::GShader(const char* VertexPath, const char* FragmentPath)
+std::string GShader::CacheDirectory = "ShaderCache";
+FShaderLoads GShader::Compiled = { 0, 0.f };
+FShaderLoads GShader::Cached = { 0, 0.f };
+int GShader::NameLookups = 0;
+int GShader::Uploads = 0;
+
+__forceinline GShader::GShader(const char* VertexPath, const char* FragmentPath, const char* const* FeedbackVaryings, int FeedbackVaryingsCount) : Id(0), bFromCache(false), InitMilliseconds(0.f), VertexHash(0), FragmentHash(0)
 {
-	InitShader(FileToChar(VertexPath), FileToChar(FragmentPath));
+	std::string VertexCode, FragmentCode;
+	if (FileToString(VertexPath, VertexCode) && FileToString(FragmentPath, FragmentCode))
+	{
+		InitShader(VertexCode.c_str(), FragmentCode.c_str(), FeedbackVaryings, FeedbackVaryingsCount);
+	}
 }
 
-__forceinline GShader::GShader(int VertexResource, int FragmentResource)
+__forceinline GShader::GShader(const FShaderSource &Vertex, const FShaderSource &Fragment, const char* const* FeedbackVaryings, int FeedbackVaryingsCount) : Id(0), bFromCache(false), InitMilliseconds(0.f), VertexHash(0), FragmentHash(0)
 {
-	HRSRC Vertex = FindResource(NULL, MAKEINTRESOURCE(VertexResource), "SHADER");
-	HGLOBAL VertexData = LoadResource(NULL, Vertex);
+	InitShader(Vertex.Code, Fragment.Code, Vertex.Hash, Fragment.Hash, FeedbackVaryings, FeedbackVaryingsCount);
+}
 
-	HRSRC Fragment = FindResource(NULL, MAKEINTRESOURCE(FragmentResource), "SHADER");
-	HGLOBAL FragmentData = LoadResource(NULL, Fragment);
+__forceinline GShader::GShader(const FShaderSource &Vertex, const FShaderSource &Fragment, const FShaderSource &FragmentInclude, const char* const* FeedbackVaryings, int FeedbackVaryingsCount) : Id(0), bFromCache(false), InitMilliseconds(0.f), VertexHash(0), FragmentHash(0)
+{
+	std::string FragmentCode = IncludeSource(Fragment.Code, FragmentInclude.Code);
+	InitShader(Vertex.Code, FragmentCode.c_str(), Vertex.Hash, HashBytes(&FragmentInclude.Hash, sizeof(FragmentInclude.Hash), Fragment.Hash), FeedbackVaryings, FeedbackVaryingsCount);
+}
 
-	InitShader((char*)LockResource(VertexData), (char*)LockResource(FragmentData));
+__forceinline GShader::GShader() : Id(0), bFromCache(false), InitMilliseconds(0.f), VertexHash(0), FragmentHash(0)
+{
 }
-__forceinline void GShader::InitShader(const char* VertexCode, const char* FragmentCode)
+
+__forceinline void GShader::InitShader(const char* VertexCode, const char* FragmentCode, const char* const* FeedbackVaryings, int FeedbackVaryingsCount)
 {
-	unsigned int Vertex, Fragment;
-	int Success;
-	char InfoLog[512];
+	InitShader(VertexCode, FragmentCode, HashBytes(VertexCode, strlen(VertexCode)), HashBytes(FragmentCode, strlen(FragmentCode)), FeedbackVaryings, FeedbackVaryingsCount);
+}
 
-	// Vertex Shader
-	Vertex = glCreateShader(GL_VERTEX_SHADER);
-	glShaderSource(Vertex, 1, &VertexCode, NULL);
-	glCompileShader(Vertex);
-	glGetShaderiv(Vertex, GL_COMPILE_STATUS, &Success);
-	if (!Success)
+__forceinline void GShader::InitShader(const char* VertexCode, const char* FragmentCode, unsigned long long InVertexHash, unsigned long long InFragmentHash, const char* const* FeedbackVaryings, int FeedbackVaryingsCount)
+{
+	VertexSource = VertexCode;
+	FragmentSource = FragmentCode;
+	VertexHash = InVertexHash;
+	FragmentHash = InFragmentHash;
+	Varyings.assign(FeedbackVaryings, FeedbackVaryings + FeedbackVaryingsCount);
+
+	// The program is needed right away
+	StartBuild(VertexSource, FragmentSource, VertexHash, FragmentHash);
+	FinishBuild();
+}
+
+__forceinline void GShader::Reload(const char* VertexCode, const char* FragmentCode)
+{
+	unsigned long long NewVertexHash = HashBytes(VertexCode, strlen(VertexCode));
+	unsigned long long NewFragmentHash = HashBytes(FragmentCode, strlen(FragmentCode));
+	StartBuild(VertexCode, FragmentCode, NewVertexHash, NewFragmentHash);
+	for (auto &Permutation : Permutations)
+	{
+		const std::string &Defines = Permutation.first;
+		Permutation.second->StartBuild(InjectDefines(VertexCode, Defines), InjectDefines(FragmentCode, Defines),
+			HashBytes(Defines.data(), Defines.size(), NewVertexHash), HashBytes(Defines.data(), Defines.size(), NewFragmentHash));
+	}
+}
+
+__forceinline bool GShader::Update()
+{
+	bool bSwapped = IsBuildReady() && FinishBuild();
+	for (auto &Permutation : Permutations)
+	{
+		bSwapped = Permutation.second->Update() || bSwapped;
+	}
+	return bSwapped;
+}
+
+__forceinline bool GShader::IsBuilding() const
+{
+	return Build.Program != 0;
+}
+
+__forceinline bool GShader::IsParallelCompileSupported()
+{
+	static int Supported = -1;
+	if (Supported < 0)
+	{
+		int ExtensionsCount = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &ExtensionsCount);
+		Supported = 0;
+		for (int i = 0; i < ExtensionsCount; ++i)
+		{
+			const char* Extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+			if (strcmp(Extension, "GL_KHR_parallel_shader_compile") == 0 || strcmp(Extension, "GL_ARB_parallel_shader_compile") == 0)
+			{
+				Supported = 1;
+			}
+		}
+	}
+	return Supported != 0;
+}
+
+__forceinline void GShader::StartBuild(const std::string &VertexCode, const std::string &FragmentCode, unsigned long long InVertexHash, unsigned long long InFragmentHash)
+{
+	CancelBuild();
+	Build.Start = std::chrono::high_resolution_clock::now();
+	Build.VertexSource = VertexCode;
+	Build.FragmentSource = FragmentCode;
+	Build.VertexHash = InVertexHash;
+	Build.FragmentHash = InFragmentHash;
+
+	std::vector<const char*> FeedbackVaryings = GetVaryings();
+	Build.BinaryPath = GetBinaryPath(InVertexHash, InFragmentHash, FeedbackVaryings.data(), (int)FeedbackVaryings.size());
+	Build.Program = Build.BinaryPath.empty() ? 0 : LoadBinary(Build.BinaryPath);
+	Build.bFromCache = Build.Program != 0;
+	if (Build.bFromCache)
+	{
+		return;
+	}
+
+	// Nothing here waits for the compiler, the statuses are only read once the build is ready
+	const char* Code = Build.VertexSource.c_str();
+	Build.Vertex = glCreateShader(GL_VERTEX_SHADER);
+	glShaderSource(Build.Vertex, 1, &Code, NULL);
+	glCompileShader(Build.Vertex);
+
+	Code = Build.FragmentSource.c_str();
+	Build.Fragment = glCreateShader(GL_FRAGMENT_SHADER);
+	glShaderSource(Build.Fragment, 1, &Code, NULL);
+	glCompileShader(Build.Fragment);
+
+	Build.Program = glCreateProgram();
+	glAttachShader(Build.Program, Build.Vertex);
+	glAttachShader(Build.Program, Build.Fragment);
+	if (!FeedbackVaryings.empty())
+	{
+		glTransformFeedbackVaryings(Build.Program, (GLsizei)FeedbackVaryings.size(), FeedbackVaryings.data(), GL_INTERLEAVED_ATTRIBS);
+	}
+	if (!Build.BinaryPath.empty())
+	{
+		// The binary is only retrievable when this is set before linking
+		glProgramParameteri(Build.Program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+	glLinkProgram(Build.Program);
+}
+
+__forceinline bool GShader::IsBuildReady() const
+{
+	if (Build.Program == 0)
+	{
+		return false;
+	}
+	// Without the extension any status query waits for the link
+	if (Build.bFromCache || !IsParallelCompileSupported())
+	{
+		return true;
+	}
+	int Completed = 0;
+	glGetProgramiv(Build.Program, GL_COMPLETION_STATUS_KHR, &Completed);
+	return Completed != 0;
+}
+
+__forceinline bool GShader::FinishBuild()
+{
+	if (Build.Program == 0)
 	{
-		glGetShaderInfoLog(Vertex, 512, NULL, InfoLog);
-		std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << InfoLog << std::endl;
-	};
+		return false;
+	}
+
+	int Success = 1;
+	if (!Build.bFromCache)
+	{
+		char InfoLog[512];
+
+		glGetShaderiv(Build.Vertex, GL_COMPILE_STATUS, &Success);
+		if (!Success)
+		{
+			glGetShaderInfoLog(Build.Vertex, 512, NULL, InfoLog);
+			std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << InfoLog << std::endl;
+		}
 
-	// Fragment Shader
-	Fragment = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(Fragment, 1, &FragmentCode, NULL);
-	glCompileShader(Fragment);
-	glGetShaderiv(Fragment, GL_COMPILE_STATUS, &Success);
+		glGetShaderiv(Build.Fragment, GL_COMPILE_STATUS, &Success);
+		if (!Success)
+		{
+			glGetShaderInfoLog(Build.Fragment, 512, NULL, InfoLog);
+			std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << InfoLog << std::endl;
+		}
+
+		glGetProgramiv(Build.Program, GL_LINK_STATUS, &Success);
+		if (!Success)
+		{
+			glGetProgramInfoLog(Build.Program, 512, NULL, InfoLog);
+			std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << InfoLog << std::endl;
+		}
+	}
 	if (!Success)
 	{
-		glGetShaderInfoLog(Fragment, 512, NULL, InfoLog);
-		std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << InfoLog << std::endl;
-	};
+		// The program in use stays
+		CancelBuild();
+		return false;
+	}
+	glDeleteShader(Build.Vertex);
+	glDeleteShader(Build.Fragment);
+
+	if (Id != 0)
+	{
+		glDeleteProgram(Id);
+	}
+	Id = Build.Program;
+	bFromCache = Build.bFromCache;
+	VertexSource = std::move(Build.VertexSource);
+	FragmentSource = std::move(Build.FragmentSource);
+	VertexHash = Build.VertexHash;
+	FragmentHash = Build.FragmentHash;
+	if (!bFromCache && !Build.BinaryPath.empty())
+	{
+		SaveBinary(Build.BinaryPath);
+	}
+	ReflectUniforms();
+
+	// From the start of the build, the time spent rendering with the previous program included
+	InitMilliseconds = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - Build.Start).count();
+	FShaderLoads &Loads = bFromCache ? Cached : Compiled;
+	++Loads.Count;
+	Loads.Milliseconds += InitMilliseconds;
+	Build = FProgramBuild();
+
+	if (LinkSetup)
+	{
+		Use();
+		LinkSetup(*this);
+	}
+	return true;
+}
 
-	// Shader Program
-	Id = glCreateProgram();
-	glAttachShader(Id, Vertex);
-	glAttachShader(Id, Fragment);
-	glLinkProgram(Id);
-	glGetProgramiv(Id, GL_LINK_STATUS, &Success);
+__forceinline void GShader::CancelBuild()
+{
+	if (Build.Program == 0)
+	{
+		return;
+	}
+	if (!Build.bFromCache)
+	{
+		glDeleteShader(Build.Vertex);
+		glDeleteShader(Build.Fragment);
+	}
+	glDeleteProgram(Build.Program);
+	Build = FProgramBuild();
+}
+
+__forceinline std::vector<const char*> GShader::GetVaryings() const
+{
+	std::vector<const char*> FeedbackVaryings;
+	for (const std::string &Varying : Varyings)
+	{
+		FeedbackVaryings.push_back(Varying.c_str());
+	}
+	return FeedbackVaryings;
+}
+
+__forceinline std::string GShader::IncludeSource(const std::string &Source, const std::string &Include)
+{
+	// Numbered like InjectDefines, the lines after Include are numbered from 2 again in source string 0
+	size_t Version = Source.find('\n') + 1;
+	return Source.substr(0, Version) + "#line 0 1\n" + Include + "\n#line 1 0\n" + Source.substr(Version);
+}
+
+__forceinline std::string GShader::InjectDefines(const std::string &Source, const std::string &Defines)
+{
+	// Right after #version, the next line is numbered 2 again so the errors point to the source lines
+	size_t Version = Source.find('\n') + 1;
+	return Source.substr(0, Version) + Defines + "#line 1\n" + Source.substr(Version);
+}
+
+__forceinline std::string GShader::GetBinaryPath(unsigned long long InVertexHash, unsigned long long InFragmentHash, const char* const* FeedbackVaryings, int FeedbackVaryingsCount) const
+{
+	// GL 4.1 or ARB_get_program_binary, a 3.3 context may still have it
+	if (CacheDirectory.empty() || !glGetProgramBinary || !glProgramBinary)
+	{
+		return "";
+	}
+	int FormatsCount = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &FormatsCount);
+	if (FormatsCount <= 0)
+	{
+		return "";
+	}
+
+	// Binaries are only valid for the driver that made them
+	const char* Strings[] = { (const char*)glGetString(GL_VENDOR), (const char*)glGetString(GL_RENDERER), (const char*)glGetString(GL_VERSION) };
+	unsigned long long Hash = HashBytes(&FeedbackVaryingsCount, sizeof(int));
+	Hash = HashBytes(&InVertexHash, sizeof(InVertexHash), Hash);
+	Hash = HashBytes(&InFragmentHash, sizeof(InFragmentHash), Hash);
+	for (const char* String : Strings)
+	{
+		// Including the terminator, so the strings can't run into each other
+		Hash = String ? HashBytes(String, strlen(String) + 1, Hash) : HashBytes("", 1, Hash);
+	}
+	for (int i = 0; i < FeedbackVaryingsCount; ++i)
+	{
+		Hash = HashBytes(FeedbackVaryings[i], strlen(FeedbackVaryings[i]) + 1, Hash);
+	}
+
+	char Name[32];
+	snprintf(Name, sizeof(Name), "%016llx.bin", Hash);
+	return CacheDirectory + "/" + Name;
+}
+
+__forceinline unsigned int GShader::LoadBinary(const std::string &Path) const
+{
+	std::error_code Error;
+	if (!std::filesystem::exists(Path, Error))
+	{
+		return 0;
+	}
+
+	// Format first, then the binary up to the end of the file
+	GLenum Format = 0;
+	std::vector<char> Binary;
+	std::ifstream File(Path, std::ios::binary);
+	uintmax_t Size = std::filesystem::file_size(Path, Error);
+	if (!Error && Size > sizeof(GLenum))
+	{
+		Binary.resize((size_t)(Size - sizeof(GLenum)));
+		File.read((char*)&Format, sizeof(GLenum));
+		File.read(Binary.data(), Binary.size());
+	}
+	bool bRead = !Binary.empty() && (bool)File;
+	File.close();
+
+	int Success = 0;
+	unsigned int Program = 0;
+	if (bRead)
+	{
+		Program = glCreateProgram();
+		glProgramBinary(Program, Format, Binary.data(), (GLsizei)Binary.size());
+		glGetProgramiv(Program, GL_LINK_STATUS, &Success);
+		if (!Success)
+		{
+			glDeleteProgram(Program);
+			Program = 0;
+		}
+	}
 	if (!Success)
 	{
-		glGetProgramInfoLog(Id, 512, NULL, InfoLog);
-		std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << InfoLog << std::endl;
+		// Usually a driver update, the program is compiled again and the binary replaced
+		std::cout << "WARNING::SHADER::PROGRAM::BINARY_REJECTED " << Path << std::endl;
+		std::filesystem::remove(Path, Error);
+	}
+	return Program;
+}
+
+__forceinline void GShader::SaveBinary(const std::string &Path) const
+{
+	int Length = 0;
+	glGetProgramiv(Id, GL_PROGRAM_BINARY_LENGTH, &Length);
+	if (Length <= 0)
+	{
+		return;
 	}
+	GLenum Format;
+	std::vector<char> Binary(Length);
+	glGetProgramBinary(Id, Length, &Length, &Format, Binary.data());
 
-	glDeleteShader(Vertex);
-	glDeleteShader(Fragment);
+	std::error_code Error;
+	std::filesystem::create_directories(CacheDirectory, Error);
+	std::ofstream File(Path, std::ios::binary);
+	if (!File)
+	{
+		std::cout << "WARNING::SHADER::PROGRAM::BINARY_NOT_SAVED " << Path << std::endl;
+		return;
+	}
+	File.write((const char*)&Format, sizeof(GLenum));
+	File.write(Binary.data(), Length);
+}
+
+__forceinline void GShader::ReflectUniforms()
+{
+	Locations.clear();
+
+	int UniformsCount, MaxLength;
+	glGetProgramiv(Id, GL_ACTIVE_UNIFORMS, &UniformsCount);
+	glGetProgramiv(Id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &MaxLength);
+	std::vector<char> Name(glm::max(MaxLength, 1));
+	for (int i = 0; i < UniformsCount; ++i)
+	{
+		int Size;
+		GLenum Type;
+		glGetActiveUniform(Id, i, (GLsizei)Name.size(), NULL, &Size, &Type, Name.data());
+		int Location = glGetUniformLocation(Id, Name.data());
+		if (Location < 0)
+		{
+			// Uniform block members have no location
+			continue;
+		}
+		Locations[Name.data()] = Location;
+
+		// Arrays are reported by their first element, they can also be set by their name alone or by any element
+		std::string Array = Name.data();
+		if (Array.size() > 3 && Array.compare(Array.size() - 3, 3, "[0]") == 0)
+		{
+			Array.resize(Array.size() - 3);
+			Locations[Array] = Location;
+			for (int Element = 1; Element < Size; ++Element)
+			{
+				std::string ElementName = Array + "[" + std::to_string(Element) + "]";
+				Locations[ElementName] = glGetUniformLocation(Id, ElementName.c_str());
+			}
+		}
+	}
 }
 
 __forceinline void GShader::Use()
@@ -97,60 +584,167 @@ __forceinline void GShader::Use()
 	glUseProgram(Id);
 }
 
+__forceinline GShader &GShader::GetPermutation(const std::string &Defines)
+{
+	std::unique_ptr<GShader> &Permutation = Permutations[Defines];
+	if (!Permutation)
+	{
+		Permutation.reset(new GShader());
+		Permutation->Varyings = Varyings;
+		Permutation->LinkSetup = LinkSetup;
+		// Keyed by the hashes of the sources and the defines, the embedded sources are not hashed again
+		Permutation->StartBuild(InjectDefines(VertexSource, Defines), InjectDefines(FragmentSource, Defines),
+			HashBytes(Defines.data(), Defines.size(), VertexHash), HashBytes(Defines.data(), Defines.size(), FragmentHash));
+	}
+	return Permutation->Id != 0 ? *Permutation : *this;
+}
+
+__forceinline int GShader::GetPermutationsCount() const
+{
+	return (int)Permutations.size();
+}
+
+__forceinline void GShader::SetOnLink(const std::function<void(GShader&)> &OnLink)
+{
+	LinkSetup = OnLink;
+	if (Id != 0)
+	{
+		Use();
+		LinkSetup(*this);
+	}
+	for (auto &Permutation : Permutations)
+	{
+		Permutation.second->SetOnLink(OnLink);
+	}
+}
+
+__forceinline FUniform GShader::GetUniform(const char* Name) const
+{
+	++NameLookups;
+	auto Location = Locations.find(Name);
+	return { Location != Locations.end() ? Location->second : -1 };
+}
+
 __forceinline void GShader::SetBool(const char* Name, bool Value) const
 {
-	glUniform1i(glGetUniformLocation(Id, Name), (int)Value);
+	SetBool(GetUniform(Name), Value);
 }
 
 __forceinline void GShader::Set1i(const char* Name, int Value1) const
 {
-	glUniform1i(glGetUniformLocation(Id, Name), Value1);
+	Set1i(GetUniform(Name), Value1);
 }
 
 __forceinline void GShader::Set1f(const char* Name, float Value1) const
 {
-	glUniform1f(glGetUniformLocation(Id, Name), Value1);
+	Set1f(GetUniform(Name), Value1);
 }
 
 __forceinline void GShader::Set2f(const char* Name, float Value1, float Value2) const
 {
-	glUniform2f(glGetUniformLocation(Id, Name), Value1, Value2);
+	Set2f(GetUniform(Name), Value1, Value2);
 }
 
 __forceinline void GShader::Set3f(const char* Name, float Value1, float Value2, float Value3) const
 {
-	glUniform3f(glGetUniformLocation(Id, Name), Value1, Value2, Value3);
+	Set3f(GetUniform(Name), Value1, Value2, Value3);
 }
 
 __forceinline void GShader::Set4f(const char* Name, float Value1, float Value2, float Value3, float Value4) const
 {
-	glUniform4f(glGetUniformLocation(Id, Name), Value1, Value2, Value3, Value4);
+	Set4f(GetUniform(Name), Value1, Value2, Value3, Value4);
 }
 
 __forceinline void GShader::Set3fv(const char* Name, float* Vector) const
 {
-	glUniform3fv(glGetUniformLocation(Id, Name), 1, &Vector[0]);
+	Set3fv(GetUniform(Name), Vector);
 }
 
 __forceinline void GShader::SetVec3(const char* Name, glm::vec3 Vector) const
 {
-	glUniform3fv(glGetUniformLocation(Id, Name), 1, &Vector[0]);
+	SetVec3(GetUniform(Name), Vector);
 }
 
 void GShader::SetVec2r(const char* Name, glm::vec2 Rotation) const
+{
+	SetVec2r(GetUniform(Name), Rotation);
+}
+
+__forceinline void GShader::SetMatrix4fv(const char* Name, float* Value) const
+{
+	SetMatrix4fv(GetUniform(Name), Value);
+}
+
+__forceinline void GShader::SetMat4(const char* Name, glm::mat4 Matrix) const
+{
+	SetMat4(GetUniform(Name), Matrix);
+}
+
+__forceinline void GShader::SetBool(FUniform Uniform, bool Value) const
+{
+	++Uploads;
+	glUniform1i(Uniform.Location, (int)Value);
+}
+
+__forceinline void GShader::Set1i(FUniform Uniform, int Value1) const
+{
+	++Uploads;
+	glUniform1i(Uniform.Location, Value1);
+}
+
+__forceinline void GShader::Set1f(FUniform Uniform, float Value1) const
+{
+	++Uploads;
+	glUniform1f(Uniform.Location, Value1);
+}
+
+__forceinline void GShader::Set2f(FUniform Uniform, float Value1, float Value2) const
+{
+	++Uploads;
+	glUniform2f(Uniform.Location, Value1, Value2);
+}
+
+__forceinline void GShader::Set3f(FUniform Uniform, float Value1, float Value2, float Value3) const
+{
+	++Uploads;
+	glUniform3f(Uniform.Location, Value1, Value2, Value3);
+}
+
+__forceinline void GShader::Set4f(FUniform Uniform, float Value1, float Value2, float Value3, float Value4) const
+{
+	++Uploads;
+	glUniform4f(Uniform.Location, Value1, Value2, Value3, Value4);
+}
+
+__forceinline void GShader::Set3fv(FUniform Uniform, float* Vector) const
+{
+	++Uploads;
+	glUniform3fv(Uniform.Location, 1, &Vector[0]);
+}
+
+__forceinline void GShader::SetVec3(FUniform Uniform, glm::vec3 Vector) const
+{
+	++Uploads;
+	glUniform3fv(Uniform.Location, 1, &Vector[0]);
+}
+
+void GShader::SetVec2r(FUniform Uniform, glm::vec2 Rotation) const
 {
 	glm::vec3 Normal(glm::cos(glm::radians(Rotation.y))*glm::cos(glm::radians(Rotation.x)),
 		glm::sin(glm::radians(Rotation.y))*glm::cos(glm::radians(Rotation.x)),
 		glm::sin(glm::radians(Rotation.x)));
-	glUniform3fv(glGetUniformLocation(Id, Name), 1, &Normal[0]);
+	++Uploads;
+	glUniform3fv(Uniform.Location, 1, &Normal[0]);
 }
 
-__forceinline void GShader::SetMatrix4fv(const char* Name, float* Value) const
+__forceinline void GShader::SetMatrix4fv(FUniform Uniform, float* Value) const
 {
-	glUniformMatrix4fv(glGetUniformLocation(Id, Name), 1, GL_FALSE, Value);
+	++Uploads;
+	glUniformMatrix4fv(Uniform.Location, 1, GL_FALSE, Value);
 }
 
-__forceinline void GShader::SetMat4(const char* Name, glm::mat4 Matrix) const
+__forceinline void GShader::SetMat4(FUniform Uniform, glm::mat4 Matrix) const
 {
-	glUniformMatrix4fv(glGetUniformLocation(Id, Name), 1, GL_FALSE, &Matrix[0][0]);
+	++Uploads;
+	glUniformMatrix4fv(Uniform.Location, 1, GL_FALSE, &Matrix[0][0]);
 }
@@ -0,0 +1,1267 @@
+// Generated by EmbedShaders.py from the files in Shaders/, edit those and run it again
+#pragma once
+
+#include "Shader.h"
+
+// Arrow.frag
+constexpr FShaderSource ArrowFrag =
+{
+	"Arrow.frag",
+	R"GLSL(#version 330 core
+
+struct FMaterial {
+    vec3 Ambient;
+	vec3 Diffuse;
+	vec3 Specular;
+    float Shininess;
+}; 
+uniform FMaterial UMaterial;
+
+struct FLight {
+
+    vec3 Ambient;
+    vec3 Diffuse;
+    vec3 Specular;
+};
+
+struct FSpotLight {
+    vec3 Position;
+    vec3 Direction;
+
+	float Constant;
+	float Linear;
+	float Quadratic;
+
+	float CutOff;
+	float OuterCutOff;
+
+    FLight Light;
+};
+// Headlight of the arrow, not the spot light of the scene
+uniform FSpotLight USpotLight;
+
+// Shared with every program, EUniformBlock::Camera
+layout (std140) uniform UCamera
+{
+	mat4 UProjection;
+	mat4 UView;
+	vec3 UViewPosition;
+};
+
+in vec3 FPosition;
+in vec3 FNormal;
+
+out vec4 OFragColor;
+
+vec3 CalculateSpotLight(FSpotLight Light, vec3 Normal, vec3 FPosition, vec3 ViewDirection);
+void CalculateLight(FLight SpotLight, vec3 Normal, vec3 LightDirection, vec3 ViewDirection, out vec3 Ambient, out vec3 Diffuse, out vec3 Specular);
+
+void main()
+{
+	vec3 Normal = normalize(FNormal);
+	vec3 ViewDirection = normalize(UViewPosition - FPosition);
+
+	vec3 Result = CalculateSpotLight(USpotLight, Normal, FPosition, ViewDirection);
+
+	OFragColor = vec4(5.f * Result, 1.f);
+}
+
+vec3 CalculateSpotLight(FSpotLight SpotLight, vec3 Normal, vec3 FPosition, vec3 ViewDirection)
+{
+	vec3 LightDirection = normalize(SpotLight.Position - FPosition);
+
+    vec3 Ambient, Diffuse, Specular;
+    CalculateLight(SpotLight.Light, Normal, LightDirection, ViewDirection, Ambient, Diffuse, Specular);
+
+	float Distance = length(SpotLight.Position - FPosition);
+	float Attenuation = 1.0 / (SpotLight.Constant + SpotLight.Linear * Distance + SpotLight.Quadratic * (Distance * Distance));
+
+	float Theta = dot(LightDirection, normalize(-SpotLight.Direction));
+	float Epsilon   = SpotLight.CutOff - SpotLight.OuterCutOff;
+	float Intensity = clamp((Theta - SpotLight.OuterCutOff) / Epsilon, 0.0, 1.0);
+
+	Ambient *= Attenuation * Intensity;
+	Diffuse *= Attenuation * Intensity;
+	Specular *= Attenuation * Intensity;
+
+	return Ambient + Diffuse + Specular;
+}
+
+void CalculateLight(FLight Light, vec3 Normal, vec3 LightDirection, vec3 ViewDirection, out vec3 Ambient, out vec3 Diffuse, out vec3 Specular)
+{
+	float DiffuseRatio = max(dot(Normal, LightDirection), 0.f);
+    vec3 ReflectionDirection = reflect(-LightDirection, Normal);
+    float SpecularRatio = pow(max(dot(ViewDirection, ReflectionDirection), 0.f), UMaterial.Shininess);
+
+    Ambient  = Light.Ambient  * UMaterial.Ambient;
+    Diffuse  = Light.Diffuse  * DiffuseRatio * UMaterial.Diffuse;
+    Specular = Light.Specular * SpecularRatio * UMaterial.Specular;
+})GLSL",
+	0xb7022f9fc3c6bf33ull
+};
+
+// Arrow.vert
+constexpr FShaderSource ArrowVert =
+{
+	"Arrow.vert",
+	R"GLSL(#version 330 core
+
+layout (location = 0) in vec3 VPosition;
+layout (location = 1) in vec3 VNormal;
+
+uniform mat4 UModel;
+
+// Shared with every program, EUniformBlock::Camera
+layout (std140) uniform UCamera
+{
+	mat4 UProjection;
+	mat4 UView;
+	vec3 UViewPosition;
+};
+
+out vec3 FPosition;
+out vec3 FNormal;
+
+void main()
+{
+	FPosition = vec3(UModel * vec4(VPosition, 1.f));
+	FNormal = mat3(transpose(inverse(UModel))) * VNormal;
+
+	gl_Position = UProjection * UView * UModel * vec4(VPosition, 1.f);
+})GLSL",
+	0x95f29ad62a2798dcull
+};
+
+// DeferredLight.frag
+constexpr FShaderSource DeferredLightFrag =
+{
+	"DeferredLight.frag",
+	R"GLSL(#version 330 core
+
+// Lighting.glsl, the light and shadow uniforms and functions, is spliced in right after #version by GShader
+
+// G-buffer of GDeferred. Albedo alpha 0 is a color shown as it is, the normal difference mode.
+uniform sampler2D UAlbedo;
+uniform sampler2D UNormal;
+uniform sampler2D UDepth;
+uniform mat4 UInverseViewProjection;
+
+out vec4 OFragColor;
+
+void main()
+{
+	ivec2 Pixel = ivec2(gl_FragCoord.xy);
+	float Depth = texelFetch(UDepth, Pixel, 0).r;
+	// Background, the clear color stays
+	if (Depth == 1.f)
+	{
+		discard;
+	}
+	vec4 Albedo = texelFetch(UAlbedo, Pixel, 0);
+	if (Albedo.a == 0.f)
+	{
+		OFragColor = vec4(Albedo.rgb, 1.f);
+		return;
+	}
+
+	vec4 Clip = vec4((gl_FragCoord.xy / vec2(textureSize(UDepth, 0))) * 2.f - 1.f, Depth * 2.f - 1.f, 1.f);
+	vec4 World = UInverseViewProjection * Clip;
+	vec3 FPosition = World.xyz / World.w;
+
+	vec3 Normal = normalize(texelFetch(UNormal, Pixel, 0).xyz);
+	vec3 ViewDirection = normalize(UViewPosition - FPosition);
+	Material.Diffuse = Albedo.rgb;
+
+	// Black when inactive, like the forward program without permutations
+	vec3 Result = CalculateDirectonalLight(UDirectionalLight, Normal, ViewDirection, CalculateShadow(FPosition, Normal));
+	for(int i = 0; i < POINT_LIGHTS; ++i)
+	{
+		Result += CalculatePointLight(UPointLights[i], Normal, FPosition, ViewDirection);
+	}
+	Result += CalculateSpotLight(USpotLight, Normal, FPosition, ViewDirection);
+
+	OFragColor = vec4(Result, 1.f);
+}
+)GLSL",
+	0x595013b1085e1d59ull
+};
+
+// DeferredLight.vert
+constexpr FShaderSource DeferredLightVert =
+{
+	"DeferredLight.vert",
+	R"GLSL(#version 330 core
+
+// Full screen triangle from gl_VertexID, the VAO is empty
+void main()
+{
+	vec2 Position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+	gl_Position = vec4(Position * 2.f - 1.f, 0.f, 1.f);
+}
+)GLSL",
+	0x5d7fdab8e7cb328dull
+};
+
+// DeferredVolume.frag
+constexpr FShaderSource DeferredVolumeFrag =
+{
+	"DeferredVolume.frag",
+	R"GLSL(#version 330 core
+
+struct FMaterial {
+    vec3 Ambient;
+	vec3 Diffuse;
+	vec3 Specular;
+    float Shininess;
+}; 
+// Specular and shininess of the terrain, the diffuse color comes from the G-buffer
+uniform FMaterial UMaterial;
+
+// Shared with every program, EUniformBlock::Camera
+layout (std140) uniform UCamera
+{
+	mat4 UProjection;
+	mat4 UView;
+	vec3 UViewPosition;
+};
+
+// G-buffer of GDeferred. Albedo alpha 0 is a color shown as it is, the normal difference mode.
+uniform sampler2D UAlbedo;
+uniform sampler2D UNormal;
+uniform sampler2D UDepth;
+uniform mat4 UInverseViewProjection;
+
+flat in vec4 FPositionRange;
+flat in vec4 FAmbientConstant;
+flat in vec4 FDiffuseLinear;
+flat in vec4 FSpecularQuadratic;
+
+out vec4 OFragColor;
+
+// Far side of the sphere, the depth test keeps the terrain in front of it and the range drops what is in front of the sphere
+void main()
+{
+	ivec2 Pixel = ivec2(gl_FragCoord.xy);
+	vec4 Albedo = texelFetch(UAlbedo, Pixel, 0);
+	float Depth = texelFetch(UDepth, Pixel, 0).r;
+	vec4 Clip = vec4((gl_FragCoord.xy / vec2(textureSize(UDepth, 0))) * 2.f - 1.f, Depth * 2.f - 1.f, 1.f);
+	vec4 World = UInverseViewProjection * Clip;
+	vec3 Position = World.xyz / World.w;
+
+	float Distance = length(FPositionRange.xyz - Position);
+	if (Distance >= FPositionRange.w || Albedo.a == 0.f)
+	{
+		discard;
+	}
+
+	vec3 Normal = normalize(texelFetch(UNormal, Pixel, 0).xyz);
+	vec3 ViewDirection = normalize(UViewPosition - Position);
+	vec3 LightDirection = normalize(FPositionRange.xyz - Position);
+
+	float DiffuseRatio = max(dot(Normal, LightDirection), 0.f);
+	vec3 ReflectionDirection = reflect(-LightDirection, Normal);
+	float SpecularRatio = pow(max(dot(ViewDirection, ReflectionDirection), 0.f), UMaterial.Shininess);
+
+	vec3 Ambient = FAmbientConstant.rgb * Albedo.rgb / 2.f;
+	vec3 Diffuse = FDiffuseLinear.rgb * DiffuseRatio * Albedo.rgb;
+	vec3 Specular = FSpecularQuadratic.rgb * SpecularRatio * UMaterial.Specular;
+	float Attenuation = 1.f / (FAmbientConstant.w + FDiffuseLinear.w * Distance + FSpecularQuadratic.w * (Distance * Distance));
+
+	// Faded out towards the end of the range like the clustered lights of Terrain.frag
+	float Fade = clamp(1.f - pow(Distance / FPositionRange.w, 4.f), 0.f, 1.f);
+	OFragColor = vec4((Ambient + Diffuse + Specular) * Attenuation * Fade * Fade, 1.f);
+}
+)GLSL",
+	0x40f46e90c723ed1cull
+};
+
+// DeferredVolume.vert
+constexpr FShaderSource DeferredVolumeVert =
+{
+	"DeferredVolume.vert",
+	R"GLSL(#version 330 core
+
+layout (location = 0) in vec3 VPosition;
+// The four texels of a light in GClusteredLights, one light per instance
+layout (location = 2) in vec4 VPositionRange;
+layout (location = 3) in vec4 VAmbientConstant;
+layout (location = 4) in vec4 VDiffuseLinear;
+layout (location = 5) in vec4 VSpecularQuadratic;
+
+// Shared with every program, EUniformBlock::Camera
+layout (std140) uniform UCamera
+{
+	mat4 UProjection;
+	mat4 UView;
+	vec3 UViewPosition;
+};
+
+flat out vec4 FPositionRange;
+flat out vec4 FAmbientConstant;
+flat out vec4 FDiffuseLinear;
+flat out vec4 FSpecularQuadratic;
+
+// The sphere of GDeferred, 16 segments by 8 rings, only reaches cos(pi / 16)^2 of its radius between the vertices
+const float VolumeScale = 1.04f;
+
+void main()
+{
+	gl_Position = UProjection * UView * vec4(VPosition * VPositionRange.w * VolumeScale + VPositionRange.xyz, 1.f);
+
+	FPositionRange = VPositionRange;
+	FAmbientConstant = VAmbientConstant;
+	FDiffuseLinear = VDiffuseLinear;
+	FSpecularQuadratic = VSpecularQuadratic;
+}
+)GLSL",
+	0x2d47ad4ff0f5c47aull
+};
+
+// Lighting.glsl
+constexpr FShaderSource LightingGlsl =
+{
+	"Lighting.glsl",
+	R"GLSL(// Lights and shadows of the lit terrain programs, Terrain.frag and DeferredLight.frag. Spliced right after their #version by
+// GShader, without a #version of its own. The including shader sets Material.Diffuse before calling the lights.
+
+struct FMaterial {
+    vec3 Ambient;
+	vec3 Diffuse;
+	vec3 Specular;
+    float Shininess;
+}; 
+// Specular and shininess of the terrain
+uniform FMaterial UMaterial;
+FMaterial Material;
+
+
+struct FLight {
+
+    vec3 Ambient;
+    vec3 Diffuse;
+    vec3 Specular;
+};
+
+struct FDirectionalLight {
+    vec3 Direction;
+
+    FLight Light;
+};
+
+struct FPointLight {    
+    vec3 Position;
+
+	float Constant;
+	float Linear;
+	float Quadratic;
+  
+    FLight Light;
+};  
+#define POINT_LIGHTS 1  
+
+struct FSpotLight {
+    vec3 Position;
+    vec3 Direction;
+
+	float Constant;
+	float Linear;
+	float Quadratic;
+
+	float CutOff;
+	float OuterCutOff;
+
+    FLight Light;
+};
+
+// Shared with the lit programs, EUniformBlock::Lights. POINT_LIGHTS matches PointLightsCount in UniformBlocks.h
+layout (std140) uniform ULights
+{
+	FDirectionalLight UDirectionalLight;
+	FPointLight UPointLights[POINT_LIGHTS];
+	FSpotLight USpotLight;
+};
+
+// Shared with every program, EUniformBlock::Camera
+layout (std140) uniform UCamera
+{
+	mat4 UProjection;
+	mat4 UView;
+	vec3 UViewPosition;
+};
+
+// Shadows of the directional light, EUniformBlock::Shadows. SHADOW_CASCADES matches ShadowCascadesMax in UniformBlocks.h.
+// UShadowParams is the cascades in use, 0 without them, the size of a texel in texture coordinates, and the step budget of
+// the heightfield march, 0 without it. UShadowHeightfield is the texture coordinates of the height map per world unit, the
+// world height per fbm unit, the top level of UShadowHeights and its texels per side.
+#define SHADOW_CASCADES 4
+layout (std140) uniform UShadows
+{
+	mat4 UShadowLightSpace[SHADOW_CASCADES];
+	vec4 UShadowSplits;
+	vec4 UShadowTexelSizes;
+	vec4 UShadowParams;
+	vec4 UShadowHeightfield;
+};
+
+// A layer per cascade, compared with the depth of the lookup
+uniform sampler2DArrayShadow UShadowMap;
+// Highest fbm of each texel of UHeightMap and of each 2^L x 2^L texels on level L, from GHeightMaxPyramid
+uniform sampler2D UShadowHeights;
+uniform sampler2D UHeightMap;
+
+void CalculateLight(FLight SpotLight, vec3 Normal, vec3 LightDirection, vec3 ViewDirection, out vec3 Ambient, out vec3 Diffuse, out vec3 Specular);
+float CalculateHeightfieldShadow(vec3 FPosition, vec3 Normal);
+
+vec3 CalculateDirectonalLight(FDirectionalLight DirectionalLight, vec3 Normal, vec3 ViewDirection, float Shadow)
+{
+    vec3 LightDirection = normalize(-DirectionalLight.Direction);
+
+    vec3 Ambient, Diffuse, Specular;
+	CalculateLight(DirectionalLight.Light, Normal, LightDirection, ViewDirection, Ambient, Diffuse, Specular);
+
+    return  Ambient + (Diffuse + Specular) * Shadow;
+}
+
+float CalculateShadow(vec3 FPosition, vec3 Normal)
+{
+	if (UShadowParams.z > 0.f)
+	{
+		return CalculateHeightfieldShadow(FPosition, Normal);
+	}
+
+	int Cascades = int(UShadowParams.x);
+	float Depth = -(UView * vec4(FPosition, 1.f)).z;
+	if (Cascades == 0 || Depth > UShadowSplits[Cascades - 1])
+	{
+		return 1.f;
+	}
+	int Cascade = 0;
+	while (Depth > UShadowSplits[Cascade])
+	{
+		++Cascade;
+	}
+
+	// A texel and a half along the normal, so the slopes don't shadow themselves
+	vec4 Light = UShadowLightSpace[Cascade] * vec4(FPosition + Normal * UShadowTexelSizes[Cascade] * 1.5f, 1.f);
+	vec3 Coordinates = Light.xyz * 0.5f + 0.5f;
+
+	// 3 x 3 PCF, each tap blends four comparisons
+	float Lit = 0.f;
+	for (int y = -1; y <= 1; ++y)
+	{
+		for (int x = -1; x <= 1; ++x)
+		{
+			Lit += texture(UShadowMap, vec4(Coordinates.xy + vec2(x, y) * UShadowParams.y, float(Cascade), Coordinates.z));
+		}
+	}
+	return Lit / 9.f;
+}
+
+float CalculateHeightfieldShadow(vec3 FPosition, vec3 Normal)
+{
+	float Scale = UShadowHeightfield.x;
+	float HeightScale = UShadowHeightfield.y;
+	int Top = int(UShadowHeightfield.z);
+	float Resolution = UShadowHeightfield.w;
+
+	vec3 Sun = normalize(-UDirectionalLight.Direction);
+	if (Sun.y <= 0.f || Scale == 0.f || HeightScale <= 0.f)
+	{
+		return 1.f;
+	}
+
+	// In texture coordinates and fbm, from a texel above the surface so it doesn't shadow itself. Direction advances one
+	// texture coordinate across the map per unit.
+	vec3 Start = FPosition + Normal / (abs(Scale) * Resolution);
+	vec3 Position = vec3(Start.xz * Scale + 0.5f, Start.y / HeightScale - 1.f);
+	vec3 Direction = vec3(Sun.xz * Scale, Sun.y / HeightScale);
+	if (length(Direction.xy) < 1e-6f)
+	{
+		return 1.f;
+	}
+	Direction /= length(Direction.xy);
+	vec2 Inverse = 1.f / mix(Direction.xy, vec2(1e-6f), lessThan(abs(Direction.xy), vec2(1e-6f)));
+
+	// Climbs to coarser levels while the ray passes above them and goes down where it doesn't, the empty space is crossed
+	// in about log2(Resolution) steps
+	float Highest = texelFetch(UShadowHeights, ivec2(0), Top).r;
+	int Level = 0;
+	for (int Step = 0; Step < int(UShadowParams.z); ++Step)
+	{
+		if (Position.z > Highest || any(lessThan(Position.xy, vec2(0.f))) || any(greaterThanEqual(Position.xy, vec2(1.f))))
+		{
+			return 1.f;
+		}
+
+		float CellSize = exp2(float(Level)) / Resolution;
+		vec2 Cell = floor(Position.xy / CellSize);
+		// Where the ray leaves the cell, it is at its lowest where it enters since it climbs towards the light
+		vec2 Exit = ((Cell + step(0.f, Direction.xy)) * CellSize - Position.xy) * Inverse;
+		float Distance = min(Exit.x, Exit.y) + CellSize * 0.001f;
+
+		if (Position.z > texelFetch(UShadowHeights, ivec2(Cell), Level).r)
+		{
+			Position += Direction * Distance;
+			Level = min(Level + 1, Top);
+		}
+		else if (Level > 0)
+		{
+			--Level;
+		}
+		else
+		{
+			// Under the bound of a texel, the filtered heights where the ray enters and leaves it decide
+			vec3 Exited = Position + Direction * Distance;
+			if (Position.z < texture(UHeightMap, Position.xy).r || Exited.z < texture(UHeightMap, Exited.xy).r)
+			{
+				return 0.f;
+			}
+			Position = Exited;
+		}
+	}
+	// Out of steps, lit rather than a band of false shadows in the distance
+	return 1.f;
+}
+
+vec3 CalculatePointLight(FPointLight PointLight, vec3 Normal, vec3 FPosition, vec3 ViewDirection)
+{
+	vec3 LightDirection = normalize(PointLight.Position - FPosition);
+
+    vec3 Ambient, Diffuse, Specular;
+    CalculateLight(PointLight.Light, Normal, LightDirection, ViewDirection, Ambient, Diffuse, Specular);
+
+	float Distance = length(PointLight.Position - FPosition);
+	float Attenuation = 1.0 / (PointLight.Constant + PointLight.Linear * Distance + PointLight.Quadratic * (Distance * Distance));  
+
+	Ambient *= Attenuation;
+	Diffuse *= Attenuation;
+	Specular *= Attenuation;
+
+	return Ambient + Diffuse + Specular;
+}
+
+vec3 CalculateSpotLight(FSpotLight SpotLight, vec3 Normal, vec3 FPosition, vec3 ViewDirection)
+{
+	vec3 LightDirection = normalize(SpotLight.Position - FPosition);
+
+    vec3 Ambient, Diffuse, Specular;
+    CalculateLight(SpotLight.Light, Normal, LightDirection, ViewDirection, Ambient, Diffuse, Specular);
+
+	float Distance = length(SpotLight.Position - FPosition);
+	float Attenuation = 1.0 / (SpotLight.Constant + SpotLight.Linear * Distance + SpotLight.Quadratic * (Distance * Distance));
+
+	float Theta = dot(LightDirection, normalize(-SpotLight.Direction));
+	float Epsilon   = SpotLight.CutOff - SpotLight.OuterCutOff;
+	float Intensity = clamp((Theta - SpotLight.OuterCutOff) / Epsilon, 0.0, 1.0);
+
+	Ambient *= Attenuation * Intensity;
+	Diffuse *= Attenuation * Intensity;
+	Specular *= Attenuation * Intensity;
+
+	return Ambient + Diffuse + Specular;
+}
+
+void CalculateLight(FLight Light, vec3 Normal, vec3 LightDirection, vec3 ViewDirection, out vec3 Ambient, out vec3 Diffuse, out vec3 Specular)
+{
+	float DiffuseRatio = max(dot(Normal, LightDirection), 0.f);
+    vec3 ReflectionDirection = reflect(-LightDirection, Normal);
+    float SpecularRatio = pow(max(dot(ViewDirection, ReflectionDirection), 0.f), UMaterial.Shininess);
+
+    Ambient  = Light.Ambient  * Material.Diffuse / 2.f;
+    Diffuse  = Light.Diffuse  * DiffuseRatio * Material.Diffuse;
+    Specular = Light.Specular * SpecularRatio * UMaterial.Specular;
+}
+)GLSL",
+	0x4b82dfdfcf501497ull
+};
+
+// PointLight.frag
+constexpr FShaderSource PointLightFrag =
+{
+	"PointLight.frag",
+	R"GLSL(#version 330 core
+
+out vec4 OFragColor;
+
+void main()
+{
+   OFragColor = vec4(1.0);
+})GLSL",
+	0xd8bbf359b2a21fbcull
+};
+
+// PointLight.vert
+constexpr FShaderSource PointLightVert =
+{
+	"PointLight.vert",
+	R"GLSL(#version 330 core
+
+layout (location = 0) in vec3 VPosition;
+layout (location = 1) in vec3 VNormal;
+// Position and scale of the instanced markers of the clustered lights. Not enabled for the single light, which reads (0, 0, 0, 1)
+layout (location = 2) in vec4 VInstance;
+
+uniform mat4 UModel;
+
+// Shared with every program, EUniformBlock::Camera
+layout (std140) uniform UCamera
+{
+	mat4 UProjection;
+	mat4 UView;
+	vec3 UViewPosition;
+};
+
+void main()
+{
+	gl_Position = UProjection * UView * UModel * vec4(VPosition * VInstance.w + VInstance.xyz, 1.f);
+})GLSL",
+	0x3475282648a6060cull
+};
+
+// Shadow.frag
+constexpr FShaderSource ShadowFrag =
+{
+	"Shadow.frag",
+	R"GLSL(#version 330 core
+
+// Depth only, the cascade has no color attachment
+
+void main()
+{
+}
+)GLSL",
+	0x7aeb34218b571282ull
+};
+
+// Shadow.vert
+constexpr FShaderSource ShadowVert =
+{
+	"Shadow.vert",
+	R"GLSL(#version 330 core
+
+// Depth of the terrain vertices cached by GTerrainCache, already displaced and in world space, in a cascade of GShadowCascades
+
+layout (location = 0) in vec3 VPosition;
+
+uniform mat4 ULightSpace;
+
+void main()
+{
+	gl_Position = ULightSpace * vec4(VPosition, 1.f);
+}
+)GLSL",
+	0xb85c15593f3d26ceull
+};
+
+// Terrain.frag
+constexpr FShaderSource TerrainFrag =
+{
+	"Terrain.frag",
+	R"GLSL(#version 330 core
+
+// Lighting.glsl, the light and shadow uniforms and functions, is spliced in right after #version by GShader
+
+// Lights compiled in, the permutations define them 0 for the inactive ones instead of running their math on black
+#ifndef DIRECTIONAL_LIGHT
+#define DIRECTIONAL_LIGHT 1
+#endif
+#ifndef POINT_LIGHT
+#define POINT_LIGHT 1
+#endif
+#ifndef SPOT_LIGHT
+#define SPOT_LIGHT 1
+#endif
+#ifndef CLUSTERED_LIGHTS
+#define CLUSTERED_LIGHTS 1
+#endif
+
+// Froxel grid of the clustered point lights, EUniformBlock::Clusters. Grid is tiles across, tiles up, depth slices and
+// lights, the slice of a view depth d is log(d) * Mapping.x + Mapping.y and the tile of a pixel its coordinates * Mapping.zw
+layout (std140) uniform UClusters
+{
+	ivec4 UClusterGrid;
+	vec4 UClusterMapping;
+};
+
+// Four texels per light: position and range, then ambient, diffuse and specular with the constant, linear and quadratic factors
+uniform samplerBuffer UClusterLights;
+// Offset and count in UClusterIndices of every froxel
+uniform usamplerBuffer UClusterRanges;
+uniform usamplerBuffer UClusterIndices;
+
+in vec3 FPosition;
+in vec3 FNormal;
+in float FNormalDifference;
+
+// The lit color, or the albedo of the G-buffer in the DEFERRED permutation, with the normal in ONormal
+layout (location = 0) out vec4 OFragColor;
+#ifdef DEFERRED
+layout (location = 1) out vec4 ONormal;
+#endif
+
+#define GREEN	vec3(  0.f,   0.5f,   0.f)
+#define LIME	vec3(  0.f,    1.f,   0.f)
+#define YELLOW	vec3(  1.f,    1.f,   0.f)
+#define BROWN	vec3( 0.65f, 0.16f, 0.16f)
+#define GRAY	vec3(  0.5f,  0.5f,  0.5f)
+#define WHITE	vec3(   1.f,   1.f,   1.f)
+
+uniform float UHeight;
+
+// 0: finite differences, 1: analytic derivatives, 2: difference between both.
+// A constant in the permutations compiled with NORMAL_MODE, so the other modes are not compiled in
+#ifdef NORMAL_MODE
+const int NormalMode = NORMAL_MODE;
+#else
+uniform int UNormalMode;
+#define NormalMode UNormalMode
+#endif
+
+vec3 CalculateClusteredLights(vec3 Normal, vec3 FPosition, vec3 ViewDirection);
+
+void main()
+{
+#if defined(DEPTH_ONLY)
+	// The pre-pass only lays the depth, the color pass then shades the visible fragment of each pixel
+	return;
+#elif defined(OVERDRAW)
+	// Added once per shaded fragment over black: red at 4 fragments on a pixel, yellow at 12 and white at 32
+	OFragColor = vec4(1.f / 4.f, 1.f / 12.f, 1.f / 32.f, 1.f);
+	return;
+#endif
+
+	vec3 Normal = normalize(FNormal);
+	vec3 ViewDirection = normalize(UViewPosition - FPosition);
+
+	Material.Diffuse = GREEN * (smoothstep( -UHeight/12.0, UHeight/12.0, FPosition.y) - smoothstep( UHeight/12.0, 3.0*UHeight/12.0, FPosition.y)) +
+					LIME * (smoothstep( UHeight/12.0, 3.0*UHeight/12.0, FPosition.y) - smoothstep( 3.0*UHeight/12.0, 5.0*UHeight/12.0, FPosition.y)) +
+					YELLOW * (smoothstep( 3.0*UHeight/12.0, 5.0*UHeight/12.0, FPosition.y) - smoothstep( 5.0*UHeight/12.0, 7.0*UHeight/12.0, FPosition.y)) +
+					BROWN * (smoothstep( 5.0*UHeight/12.0, 7.0*UHeight/12.0, FPosition.y) - smoothstep( 7.0*UHeight/12.0, 9.0*UHeight/12.0, FPosition.y)) +
+					GRAY * (smoothstep( 7.0*UHeight/12.0, 9.0*UHeight/12.0, FPosition.y) - smoothstep( 9.0*UHeight/12.0, 11.0*UHeight/12.0, FPosition.y)) +
+					WHITE * (smoothstep( 9.0*UHeight/12.0, 11.0*UHeight/12.0, FPosition.y) - smoothstep( 11.0*UHeight/12.0, 13.0*UHeight/12.0, FPosition.y));
+
+#ifdef DEFERRED
+	// Lit by GDeferred
+	OFragColor = vec4(Material.Diffuse, 1.f);
+	ONormal = vec4(Normal, 0.f);
+#else
+	vec3 Result = vec3(0.f);
+
+#if DIRECTIONAL_LIGHT
+	Result += CalculateDirectonalLight(UDirectionalLight, Normal, ViewDirection, CalculateShadow(FPosition, Normal));
+#endif
+
+#if POINT_LIGHT
+	for(int i = 0; i < POINT_LIGHTS; ++i)
+	{
+		Result += CalculatePointLight(UPointLights[i], Normal, FPosition, ViewDirection);
+	}
+#endif
+
+#if SPOT_LIGHT
+	Result += CalculateSpotLight(USpotLight, Normal, FPosition, ViewDirection);
+#endif
+
+#if CLUSTERED_LIGHTS
+	Result += CalculateClusteredLights(Normal, FPosition, ViewDirection);
+#endif
+
+	OFragColor = vec4(Result, 1.f);
+#endif
+
+	// Angle between the analytic and the finite differences normals, blue is 0 degrees and red 10 or more.
+	// Alpha 0 keeps it unlit in the G-buffer.
+	if (NormalMode == 2)
+	{
+		float Difference = clamp(FNormalDifference / 10.f, 0.f, 1.f);
+		OFragColor = vec4(Difference, 0.f, 1.f - Difference, 0.f);
+	}
+}
+
+vec3 CalculateClusteredLights(vec3 Normal, vec3 FPosition, vec3 ViewDirection)
+{
+	vec3 Result = vec3(0.f);
+	if (UClusterGrid.w == 0)
+	{
+		return Result;
+	}
+
+	float Depth = -(UView * vec4(FPosition, 1.f)).z;
+	int Slice = clamp(int(log(max(Depth, 0.0001f)) * UClusterMapping.x + UClusterMapping.y), 0, UClusterGrid.z - 1);
+	ivec2 Tile = clamp(ivec2(gl_FragCoord.xy * UClusterMapping.zw), ivec2(0), UClusterGrid.xy - 1);
+	uvec2 Range = texelFetch(UClusterRanges, (Slice * UClusterGrid.y + Tile.y) * UClusterGrid.x + Tile.x).xy;
+
+	for (uint i = 0u; i < Range.y; ++i)
+	{
+		int Light = 4 * int(texelFetch(UClusterIndices, int(Range.x + i)).x);
+		vec4 PositionRange = texelFetch(UClusterLights, Light);
+		vec4 Ambient = texelFetch(UClusterLights, Light + 1);
+		vec4 Diffuse = texelFetch(UClusterLights, Light + 2);
+		vec4 Specular = texelFetch(UClusterLights, Light + 3);
+		FPointLight PointLight = FPointLight(PositionRange.xyz, Ambient.w, Diffuse.w, Specular.w, FLight(Ambient.rgb, Diffuse.rgb, Specular.rgb));
+
+		// Faded out towards the end of the range, the froxels past it don't list the light
+		float Fade = clamp(1.f - pow(length(PositionRange.xyz - FPosition) / PositionRange.w, 4.f), 0.f, 1.f);
+		Result += CalculatePointLight(PointLight, Normal, FPosition, ViewDirection) * Fade * Fade;
+	}
+	return Result;
+}
+)GLSL",
+	0x101b38ef6d86c216ull
+};
+
+// Terrain.vert
+constexpr FShaderSource TerrainVert =
+{
+	"Terrain.vert",
+	R"GLSL(#version 330 core
+
+layout (location = 0) in vec2 VGridCoordinates;
+layout (location = 1) in vec3 VPatch; // First cell of the instanced patch and its cells per side
+
+uniform mat4 UModel;
+
+// Shared with every program, EUniformBlock::Camera
+layout (std140) uniform UCamera
+{
+	mat4 UProjection;
+	mat4 UView;
+	vec3 UViewPosition;
+};
+
+uniform float UWidth;
+uniform float UHeight;
+uniform float UTime;
+
+uniform float USeparationFactor;
+
+// 0: grid coordinates as given, 1: quadtree patch placed by UPatch and morphed towards the next level by distance,
+// 2: clipmap level placed by UPatch and morphed towards the next level near its border
+uniform int UGridMode;
+uniform vec4 UPatch; // xy: world corner or first strip cell, z: quadtree world size or clipmap cell size, w: quadtree cells per side or clipmap cells to the center
+uniform vec2 UMorph; // quadtree distances or clipmap cells from the center where the morph starts and ends
+
+// Grid mode only. 0: VGridCoordinates, 1: patch template vertex in VGridCoordinates placed by VPatch,
+// 2: row strips from the cell in UPatch.xy, two vertices per column and one row per instance
+uniform int UGridSource;
+uniform int UGridVertices; // Vertices of GenerateGrid, half the cells per side
+
+// 0: finite differences, 1: analytic derivatives, 2: difference between both.
+// A constant in the permutations compiled with NORMAL_MODE, so the other modes are not compiled in
+#ifdef NORMAL_MODE
+const int NormalMode = NORMAL_MODE;
+#else
+uniform int UNormalMode;
+#define NormalMode UNormalMode
+#endif
+
+// 0: fbm evaluated per vertex, 1: fbm and gradient fetched from the baked height map
+uniform int UHeightSource;
+uniform sampler2D UHeightMap;
+uniform float UHeightMapRange;
+
+out vec3 FPosition;
+out vec3 FNormal;
+out float FNormalDifference;
+
+// The same depth in every permutation, the color pass after the DEPTH_ONLY pre-pass tests it with GL_EQUAL
+invariant gl_Position;
+
+// Hashes, noises and fbms from https://www.shadertoy.com/view/4ttSWf
+
+//==========================================================================================
+// hashes
+//==========================================================================================
+
+float hash1( vec2 p )
+{
+    p  = 50.0*fract( p*0.3183099 );
+    return fract( p.x*p.y*(p.x+p.y) );
+}
+
+float hash1( float n )
+{
+    return fract( n*17.0*fract( n*0.3183099 ) );
+}
+
+vec2 hash2( float n ) { return fract(sin(vec2(n,n+1.0))*vec2(43758.5453123,22578.1459123)); }
+
+
+vec2 hash2( vec2 p ) 
+{
+    const vec2 k = vec2( 0.3183099, 0.3678794 );
+    p = p*k + k.yx;
+    return fract( 16.0 * k*fract( p.x*p.y*(p.x+p.y)) );
+}
+
+//==========================================================================================
+// noises
+//==========================================================================================
+
+// value noise, and its analytical derivatives
+vec4 noised( in vec3 x )
+{
+    vec3 p = floor(x);
+    vec3 w = fract(x);
+    
+    vec3 u = w*w*w*(w*(w*6.0-15.0)+10.0);
+    vec3 du = 30.0*w*w*(w*(w-2.0)+1.0);
+
+    float n = p.x + 317.0*p.y + 157.0*p.z;
+    
+    float a = hash1(n+0.0);
+    float b = hash1(n+1.0);
+    float c = hash1(n+317.0);
+    float d = hash1(n+318.0);
+    float e = hash1(n+157.0);
+	float f = hash1(n+158.0);
+    float g = hash1(n+474.0);
+    float h = hash1(n+475.0);
+
+    float k0 =   a;
+    float k1 =   b - a;
+    float k2 =   c - a;
+    float k3 =   e - a;
+    float k4 =   a - b - c + d;
+    float k5 =   a - c - e + g;
+    float k6 =   a - b - e + f;
+    float k7 = - a + b + c - d + e - f - g + h;
+
+    return vec4( -1.0+2.0*(k0 + k1*u.x + k2*u.y + k3*u.z + k4*u.x*u.y + k5*u.y*u.z + k6*u.z*u.x + k7*u.x*u.y*u.z), 
+                      2.0* du * vec3( k1 + k4*u.y + k6*u.z + k7*u.y*u.z,
+                                      k2 + k5*u.z + k4*u.x + k7*u.z*u.x,
+                                      k3 + k6*u.x + k5*u.y + k7*u.x*u.y ) );
+}
+
+float noise( in vec3 x )
+{
+    vec3 p = floor(x);
+    vec3 w = fract(x);
+    
+    vec3 u = w*w*w*(w*(w*6.0-15.0)+10.0);
+    
+    float n = p.x + 317.0*p.y + 157.0*p.z;
+    
+    float a = hash1(n+0.0);
+    float b = hash1(n+1.0);
+    float c = hash1(n+317.0);
+    float d = hash1(n+318.0);
+    float e = hash1(n+157.0);
+	float f = hash1(n+158.0);
+    float g = hash1(n+474.0);
+    float h = hash1(n+475.0);
+
+    float k0 =   a;
+    float k1 =   b - a;
+    float k2 =   c - a;
+    float k3 =   e - a;
+    float k4 =   a - b - c + d;
+    float k5 =   a - c - e + g;
+    float k6 =   a - b - e + f;
+    float k7 = - a + b + c - d + e - f - g + h;
+
+    return -1.0+2.0*(k0 + k1*u.x + k2*u.y + k3*u.z + k4*u.x*u.y + k5*u.y*u.z + k6*u.z*u.x + k7*u.x*u.y*u.z);
+}
+
+vec3 noised( in vec2 x )
+{
+    vec2 p = floor(x);
+    vec2 w = fract(x);
+    
+    vec2 u = w*w*w*(w*(w*6.0-15.0)+10.0);
+    vec2 du = 30.0*w*w*(w*(w-2.0)+1.0);
+    
+    float a = hash1(p+vec2(0,0));
+    float b = hash1(p+vec2(1,0));
+    float c = hash1(p+vec2(0,1));
+    float d = hash1(p+vec2(1,1));
+
+    float k0 = a;
+    float k1 = b - a;
+    float k2 = c - a;
+    float k4 = a - b - c + d;
+
+    return vec3( -1.0+2.0*(k0 + k1*u.x + k2*u.y + k4*u.x*u.y), 
+                      2.0* du * vec2( k1 + k4*u.y,
+                                      k2 + k4*u.x ) );
+}
+
+float noise( in vec2 x )
+{
+    vec2 p = floor(x);
+    vec2 w = fract(x);
+    vec2 u = w*w*w*(w*(w*6.0-15.0)+10.0);
+    
+#if 0
+    p *= 0.3183099;
+    float kx0 = 50.0*fract( p.x );
+    float kx1 = 50.0*fract( p.x+0.3183099 );
+    float ky0 = 50.0*fract( p.y );
+    float ky1 = 50.0*fract( p.y+0.3183099 );
+
+    float a = fract( kx0*ky0*(kx0+ky0) );
+    float b = fract( kx1*ky0*(kx1+ky0) );
+    float c = fract( kx0*ky1*(kx0+ky1) );
+    float d = fract( kx1*ky1*(kx1+ky1) );
+#else
+    float a = hash1(p+vec2(0,0));
+    float b = hash1(p+vec2(1,0));
+    float c = hash1(p+vec2(0,1));
+    float d = hash1(p+vec2(1,1));
+#endif
+    
+    return -1.0+2.0*( a + (b-a)*u.x + (c-a)*u.y + (a - b - c + d)*u.x*u.y );
+}
+
+//==========================================================================================
+// fbm constructions
+//==========================================================================================
+
+const mat3 m3  = mat3( 0.00,  0.80,  0.60,
+                      -0.80,  0.36, -0.48,
+                      -0.60, -0.48,  0.64 );
+const mat3 m3i = mat3( 0.00, -0.80, -0.60,
+                       0.80,  0.36, -0.48,
+                       0.60, -0.48,  0.64 );
+const mat2 m2 = mat2(  0.80,  0.60,
+                      -0.60,  0.80 );
+const mat2 m2i = mat2( 0.80, -0.60,
+                       0.60,  0.80 );
+
+//------------------------------------------------------------------------------------------
+
+float fbm_4( in vec3 x )
+{
+    float f = 2.0;
+    float s = 0.5;
+    float a = 0.0;
+    float b = 0.5;
+    for( int i=0; i<4; i++ )
+    {
+        float n = noise(x);
+        a += b*n;
+        b *= s;
+        x = f*m3*x;
+    }
+	return a;
+}
+
+vec4 fbmd_8( in vec3 x )
+{
+    float f = 1.92;
+    float s = 0.5;
+    float a = 0.0;
+    float b = 0.5;
+    vec3  d = vec3(0.0);
+    mat3  m = mat3(1.0,0.0,0.0,
+                   0.0,1.0,0.0,
+                   0.0,0.0,1.0);
+    for( int i=0; i<7; i++ )
+    {
+        vec4 n = noised(x);
+        a += b*n.x;          // accumulate values		
+        d += b*m*n.yzw;      // accumulate derivatives
+        b *= s;
+        x = f*m3*x;
+        m = f*m3i*m;
+    }
+	return vec4( a, d );
+}
+
+float fbm_9( in vec2 x )
+{
+    float f = 1.9;
+    float s = 0.55;
+    float a = 0.0;
+    float b = 0.5;
+    for( int i=0; i<9; i++ )
+    {
+        float n = noise(x + UTime);
+        a += b*n;
+        b *= s;
+        x = f*m2*x;
+    }
+	return a;
+}
+
+vec3 fbmd_9( in vec2 x )
+{
+    float f = 1.9;
+    float s = 0.55;
+    float a = 0.0;
+    float b = 0.5;
+    vec2  d = vec2(0.0);
+    mat2  m = mat2(1.0,0.0,0.0,1.0);
+    for( int i=0; i<9; i++ )
+    {
+        vec3 n = noised(x + UTime);
+        a += b*n.x;          // accumulate values		
+        d += b*m*n.yz;       // accumulate derivatives
+        b *= s;
+        x = f*m2*x;
+        m = f*m2i*m;
+    }
+	return vec3( a, d );
+}
+
+float fbm_4( in vec2 x )
+{
+    float f = 1.9;
+    float s = 0.55;
+    float a = 0.0;
+    float b = 0.5;
+    for( int i=0; i<4; i++ )
+    {
+        float n = noise(x);
+        a += b*n;
+        b *= s;
+        x = f*m2*x;
+    }
+	return a;
+}
+
+/////////////////////////////////////////////////
+
+vec3 GetNormal(in vec2 Position)
+{
+
+	vec2 Neighbour0 = UWidth * USeparationFactor * vec2(1.f, 0.f);
+	vec2 Neighbour1 = UWidth * USeparationFactor * vec2(1.f, -1.f);
+	vec2 Neighbour2 = UWidth * USeparationFactor * vec2(0.f, -1.f);
+	vec2 Neighbour3 = UWidth * USeparationFactor * vec2(-1.f, 0.f);
+	vec2 Neighbour4 = UWidth * USeparationFactor * vec2(-1.f, 1.f);
+	vec2 Neighbour5 = UWidth * USeparationFactor * vec2(0.f, 1.f);
+
+	vec3 Point = vec3(0.f, (fbm_9(Position) + 1.0) * (UHeight / 2.0), 0.f);
+	vec3 Point0 = vec3(Neighbour0.x, (fbm_9(Position + Neighbour0) + 1.0) * (UHeight / 2.0), Neighbour0.y);
+	vec3 Point1 = vec3(Neighbour1.x, (fbm_9(Position + Neighbour1) + 1.0) * (UHeight / 2.0), Neighbour1.y);
+	vec3 Point2 = vec3(Neighbour2.x, (fbm_9(Position + Neighbour2) + 1.0) * (UHeight / 2.0), Neighbour2.y);
+	vec3 Point3 = vec3(Neighbour3.x, (fbm_9(Position + Neighbour3) + 1.0) * (UHeight / 2.0), Neighbour3.y);
+	vec3 Point4 = vec3(Neighbour4.x, (fbm_9(Position + Neighbour4) + 1.0) * (UHeight / 2.0), Neighbour4.y);
+	vec3 Point5 = vec3(Neighbour5.x, (fbm_9(Position + Neighbour5) + 1.0) * (UHeight / 2.0), Neighbour5.y);
+
+	vec3 Normal0 = normalize(cross(Point0 - Point, Point1 - Point));
+	vec3 Normal1 = normalize(cross(Point1 - Point, Point2 - Point));
+	vec3 Normal2 = normalize(cross(Point2 - Point, Point3 - Point));
+	vec3 Normal3 = normalize(cross(Point3 - Point, Point4 - Point));
+	vec3 Normal4 = normalize(cross(Point4 - Point, Point5 - Point));
+	vec3 Normal5 = normalize(cross(Point5 - Point, Point0 - Point));
+
+	return normalize(Normal0 + Normal1 + Normal2 + Normal3 + Normal4 + Normal5);
+}
+
+// Normal from the fbmd_9 gradient. GetNormal places its neighbours at the same offsets in noise and world space,
+// so the slope is taken in noise space too and both modes shade alike.
+vec3 GetAnalyticNormal(in vec2 Gradient)
+{
+	vec2 Slope = (UHeight / 2.0) * Gradient;
+	return normalize(vec3(-Slope.x, 1.f, -Slope.y));
+}
+
+// Patch vertices at odd positions slide onto the edge shared with their neighbour, so at the end of the morph
+// the patch matches the one of the next level exactly
+vec2 GetGridCoordinates()
+{
+	if (UGridMode == 0)
+	{
+		if (UGridSource == 0)
+		{
+			return VGridCoordinates;
+		}
+		// Same rows and columns as GenerateGrid, strips follow the diagonal of its cells
+		ivec2 Vertex = UGridSource == 1 ? ivec2(round(VPatch.xy + VGridCoordinates * VPatch.z)) : ivec2(UPatch.xy) + ivec2(gl_VertexID / 2, gl_InstanceID + gl_VertexID % 2);
+		return USeparationFactor * vec2(Vertex.x - UGridVertices, UGridVertices - Vertex.y);
+	}
+	if (UGridMode == 2)
+	{
+		// Clipmap vertices are whole cells, odd ones are moved onto the even ones the next level shares
+		vec2 Offset = abs(VGridCoordinates - UPatch.w);
+		float Morph = clamp((max(Offset.x, Offset.y) - UMorph.x) / (UMorph.y - UMorph.x), 0.f, 1.f);
+		vec2 Cells = VGridCoordinates - mod(VGridCoordinates, 2.0) * Morph;
+		return (UPatch.xy + Cells * UPatch.z) / UWidth;
+	}
+	vec2 World = UPatch.xy + VGridCoordinates * UPatch.z;
+	float Distance = distance(UViewPosition, vec3(World.x, UHeight / 2.0, World.y));
+	float Morph = clamp((Distance - UMorph.x) / (UMorph.y - UMorph.x), 0.f, 1.f);
+	vec2 Fraction = fract(VGridCoordinates * UPatch.w * 0.5) * 2.0 / UPatch.w;
+	return (UPatch.xy + (VGridCoordinates - Fraction * Morph) * UPatch.z) / UWidth;
+}
+
+void main()
+{
+	vec2 GridCoordinates = GetGridCoordinates();
+
+	float Height;
+	vec3 Normal;
+	FNormalDifference = 0.f;
+	if (UHeightSource == 1)
+	{
+		vec3 Fbm = texture(UHeightMap, GridCoordinates / UHeightMapRange + 0.5).xyz;
+		Height = Fbm.x;
+		Normal = GetAnalyticNormal(Fbm.yz);
+	}
+	else if (NormalMode == 0)
+	{
+		Height = fbm_9(GridCoordinates);
+#ifndef DEPTH_ONLY
+		Normal = GetNormal(GridCoordinates);
+#endif
+	}
+	else
+	{
+		vec3 Fbm = fbmd_9(GridCoordinates);
+		Height = Fbm.x;
+		Normal = GetAnalyticNormal(Fbm.yz);
+#ifndef DEPTH_ONLY
+		if (NormalMode == 2)
+		{
+			FNormalDifference = degrees(acos(clamp(dot(Normal, GetNormal(GridCoordinates)), -1.f, 1.f)));
+		}
+#endif
+	}
+
+	vec3 Position = vec3(GridCoordinates.x * UWidth, (Height + 1.0) * (UHeight / 2.0), GridCoordinates.y * UWidth);
+	FPosition = vec3(UModel * vec4(Position, 1.f));
+	FNormal = mat3(transpose(inverse(UModel))) * Normal;
+
+	gl_Position = UProjection * UView * UModel * vec4(Position , 1.f);
+})GLSL",
+	0x28e5e326c14f737aull
+};
+
+// TerrainCached.vert
+constexpr FShaderSource TerrainCachedVert =
+{
+	"TerrainCached.vert",
+	R"GLSL(#version 330 core
+
+// Pass-through for the terrain vertices captured from Terrain.vert with transform feedback, already displaced and in world space
+
+layout (location = 0) in vec3 VPosition;
+layout (location = 1) in vec3 VNormal;
+
+// Shared with every program, EUniformBlock::Camera
+layout (std140) uniform UCamera
+{
+	mat4 UProjection;
+	mat4 UView;
+	vec3 UViewPosition;
+};
+
+out vec3 FPosition;
+out vec3 FNormal;
+out float FNormalDifference;
+
+// Like Terrain.vert, for the GL_EQUAL color pass after the pre-pass
+invariant gl_Position;
+
+void main()
+{
+	FPosition = VPosition;
+	FNormal = VNormal;
+	FNormalDifference = 0.f;
+
+	gl_Position = UProjection * UView * vec4(VPosition, 1.f);
+})GLSL",
+	0x898e6b331942e962ull
+};
@@ -0,0 +1,185 @@
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#ifdef _WIN32
+// Keeps the min and max macros away from glm::max and std::min in the rest of the translation unit
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#elif defined(__linux__)
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+// Watches the files of a folder for writes without blocking. The system notification (a change handle on Windows,
+// inotify on Linux) only wakes the check, the files are then told apart by their write times, so editors that save
+// to a temporary file and rename it over the source are seen too. Elsewhere the folder is checked twice per second.
+class GShaderWatcher
+{
+public:
+	GShaderWatcher(const char* Directory);
+
+	// Names of the files written since the last poll
+	std::vector<std::string> Poll();
+	// Returns false when the file can't be read, an editor may be replacing it
+	bool Read(const std::string &Name, std::string &Source) const;
+
+	// False when the folder doesn't exist, like next to the stand-alone .exe
+	bool IsWatching() const;
+	void Delete();
+
+public:
+	std::string Directory;
+
+private:
+	// Whether the folder may have changed since the last call
+	bool IsNotified();
+	// Returns the files whose write time differs from the last scan
+	std::vector<std::string> Scan();
+
+	std::unordered_map<std::string, std::filesystem::file_time_type> WriteTimes;
+	bool bWatching;
+#ifdef _WIN32
+	HANDLE Notification;
+#elif defined(__linux__)
+	int Notify;
+#else
+	std::chrono::steady_clock::time_point LastScan;
+#endif
+};
+
+__forceinline GShaderWatcher::GShaderWatcher(const char* InDirectory) : Directory(InDirectory)
+{
+	std::error_code Error;
+	bWatching = std::filesystem::is_directory(Directory, Error);
+#ifdef _WIN32
+	Notification = bWatching ? FindFirstChangeNotificationA(Directory.c_str(), FALSE, FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME) : INVALID_HANDLE_VALUE;
+	bWatching = Notification != INVALID_HANDLE_VALUE;
+#elif defined(__linux__)
+	Notify = bWatching ? inotify_init1(IN_NONBLOCK | IN_CLOEXEC) : -1;
+	if (Notify >= 0 && inotify_add_watch(Notify, Directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0)
+	{
+		close(Notify);
+		Notify = -1;
+	}
+	bWatching = Notify >= 0;
+#else
+	LastScan = std::chrono::steady_clock::now();
+#endif
+	if (bWatching)
+	{
+		// The files as they are now, only later writes are reported
+		Scan();
+	}
+}
+
+__forceinline std::vector<std::string> GShaderWatcher::Poll()
+{
+	if (!bWatching || !IsNotified())
+	{
+		return {};
+	}
+	return Scan();
+}
+
+__forceinline bool GShaderWatcher::Read(const std::string &Name, std::string &Source) const
+{
+	std::ifstream File(Directory + "/" + Name, std::ios::binary);
+	if (!File)
+	{
+		return false;
+	}
+	std::stringstream Stream;
+	Stream << File.rdbuf();
+	Source = Stream.str();
+	return !Source.empty();
+}
+
+__forceinline bool GShaderWatcher::IsWatching() const
+{
+	return bWatching;
+}
+
+__forceinline void GShaderWatcher::Delete()
+{
+#ifdef _WIN32
+	if (Notification != INVALID_HANDLE_VALUE)
+	{
+		FindCloseChangeNotification(Notification);
+		Notification = INVALID_HANDLE_VALUE;
+	}
+#elif defined(__linux__)
+	if (Notify >= 0)
+	{
+		close(Notify);
+		Notify = -1;
+	}
+#endif
+	bWatching = false;
+}
+
+__forceinline bool GShaderWatcher::IsNotified()
+{
+#ifdef _WIN32
+	if (WaitForSingleObject(Notification, 0) != WAIT_OBJECT_0)
+	{
+		return false;
+	}
+	FindNextChangeNotification(Notification);
+	return true;
+#elif defined(__linux__)
+	// Drains every pending event, which files they name doesn't matter
+	alignas(inotify_event) char Events[4096];
+	bool bNotified = false;
+	while (read(Notify, Events, sizeof(Events)) > 0)
+	{
+		bNotified = true;
+	}
+	return bNotified;
+#else
+	auto Now = std::chrono::steady_clock::now();
+	if (Now - LastScan < std::chrono::milliseconds(500))
+	{
+		return false;
+	}
+	LastScan = Now;
+	return true;
+#endif
+}
+
+__forceinline std::vector<std::string> GShaderWatcher::Scan()
+{
+	std::vector<std::string> Written;
+	std::error_code Error;
+	for (const std::filesystem::directory_entry &Entry : std::filesystem::directory_iterator(Directory, Error))
+	{
+		if (!Entry.is_regular_file(Error))
+		{
+			continue;
+		}
+		std::filesystem::file_time_type WriteTime = Entry.last_write_time(Error);
+		if (Error)
+		{
+			continue;
+		}
+		std::string Name = Entry.path().filename().string();
+		auto Known = WriteTimes.find(Name);
+		if (Known == WriteTimes.end() || Known->second != WriteTime)
+		{
+			WriteTimes[Name] = WriteTime;
+			Written.push_back(Name);
+		}
+	}
+	return Written;
+}
@@ -28,9 +28,16 @@ struct FSpotLight {
 
     FLight Light;
 };
+// Headlight of the arrow, not the spot light of the scene
 uniform FSpotLight USpotLight;
 
-uniform vec3 UViewPosition;
+// Shared with every program, EUniformBlock::Camera
+layout (std140) uniform UCamera
+{
+	mat4 UProjection;
+	mat4 UView;
+	vec3 UViewPosition;
+};
 
 in vec3 FPosition;
 in vec3 FNormal;
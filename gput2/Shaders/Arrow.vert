@@ -4,8 +4,14 @@ layout (location = 0) in vec3 VPosition;
 layout (location = 1) in vec3 VNormal;
 
 uniform mat4 UModel;
-uniform mat4 UView;
-uniform mat4 UProjection;
+
+// Shared with every program, EUniformBlock::Camera
+layout (std140) uniform UCamera
+{
+	mat4 UProjection;
+	mat4 UView;
+	vec3 UViewPosition;
+};
 
 out vec3 FPosition;
 out vec3 FNormal;
@@ -0,0 +1,46 @@
+#version 330 core
+
+// Lighting.glsl, the light and shadow uniforms and functions, is spliced in right after #version by GShader
+
+// G-buffer of GDeferred. Albedo alpha 0 is a color shown as it is, the normal difference mode.
+uniform sampler2D UAlbedo;
+uniform sampler2D UNormal;
+uniform sampler2D UDepth;
+uniform mat4 UInverseViewProjection;
+
+out vec4 OFragColor;
+
+void main()
+{
+	ivec2 Pixel = ivec2(gl_FragCoord.xy);
+	float Depth = texelFetch(UDepth, Pixel, 0).r;
+	// Background, the clear color stays
+	if (Depth == 1.f)
+	{
+		discard;
+	}
+	vec4 Albedo = texelFetch(UAlbedo, Pixel, 0);
+	if (Albedo.a == 0.f)
+	{
+		OFragColor = vec4(Albedo.rgb, 1.f);
+		return;
+	}
+
+	vec4 Clip = vec4((gl_FragCoord.xy / vec2(textureSize(UDepth, 0))) * 2.f - 1.f, Depth * 2.f - 1.f, 1.f);
+	vec4 World = UInverseViewProjection * Clip;
+	vec3 FPosition = World.xyz / World.w;
+
+	vec3 Normal = normalize(texelFetch(UNormal, Pixel, 0).xyz);
+	vec3 ViewDirection = normalize(UViewPosition - FPosition);
+	Material.Diffuse = Albedo.rgb;
+
+	// Black when inactive, like the forward program without permutations
+	vec3 Result = CalculateDirectonalLight(UDirectionalLight, Normal, ViewDirection, CalculateShadow(FPosition, Normal));
+	for(int i = 0; i < POINT_LIGHTS; ++i)
+	{
+		Result += CalculatePointLight(UPointLights[i], Normal, FPosition, ViewDirection);
+	}
+	Result += CalculateSpotLight(USpotLight, Normal, FPosition, ViewDirection);
+
+	OFragColor = vec4(Result, 1.f);
+}
@@ -0,0 +1,8 @@
+#version 330 core
+
+// Full screen triangle from gl_VertexID, the VAO is empty
+void main()
+{
+	vec2 Position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+	gl_Position = vec4(Position * 2.f - 1.f, 0.f, 1.f);
+}
@@ -0,0 +1,65 @@
+#version 330 core
+
+struct FMaterial {
+    vec3 Ambient;
+	vec3 Diffuse;
+	vec3 Specular;
+    float Shininess;
+}; 
+// Specular and shininess of the terrain, the diffuse color comes from the G-buffer
+uniform FMaterial UMaterial;
+
+// Shared with every program, EUniformBlock::Camera
+layout (std140) uniform UCamera
+{
+	mat4 UProjection;
+	mat4 UView;
+	vec3 UViewPosition;
+};
+
+// G-buffer of GDeferred. Albedo alpha 0 is a color shown as it is, the normal difference mode.
+uniform sampler2D UAlbedo;
+uniform sampler2D UNormal;
+uniform sampler2D UDepth;
+uniform mat4 UInverseViewProjection;
+
+flat in vec4 FPositionRange;
+flat in vec4 FAmbientConstant;
+flat in vec4 FDiffuseLinear;
+flat in vec4 FSpecularQuadratic;
+
+out vec4 OFragColor;
+
+// Far side of the sphere, the depth test keeps the terrain in front of it and the range drops what is in front of the sphere
+void main()
+{
+	ivec2 Pixel = ivec2(gl_FragCoord.xy);
+	vec4 Albedo = texelFetch(UAlbedo, Pixel, 0);
+	float Depth = texelFetch(UDepth, Pixel, 0).r;
+	vec4 Clip = vec4((gl_FragCoord.xy / vec2(textureSize(UDepth, 0))) * 2.f - 1.f, Depth * 2.f - 1.f, 1.f);
+	vec4 World = UInverseViewProjection * Clip;
+	vec3 Position = World.xyz / World.w;
+
+	float Distance = length(FPositionRange.xyz - Position);
+	if (Distance >= FPositionRange.w || Albedo.a == 0.f)
+	{
+		discard;
+	}
+
+	vec3 Normal = normalize(texelFetch(UNormal, Pixel, 0).xyz);
+	vec3 ViewDirection = normalize(UViewPosition - Position);
+	vec3 LightDirection = normalize(FPositionRange.xyz - Position);
+
+	float DiffuseRatio = max(dot(Normal, LightDirection), 0.f);
+	vec3 ReflectionDirection = reflect(-LightDirection, Normal);
+	float SpecularRatio = pow(max(dot(ViewDirection, ReflectionDirection), 0.f), UMaterial.Shininess);
+
+	vec3 Ambient = FAmbientConstant.rgb * Albedo.rgb / 2.f;
+	vec3 Diffuse = FDiffuseLinear.rgb * DiffuseRatio * Albedo.rgb;
+	vec3 Specular = FSpecularQuadratic.rgb * SpecularRatio * UMaterial.Specular;
+	float Attenuation = 1.f / (FAmbientConstant.w + FDiffuseLinear.w * Distance + FSpecularQuadratic.w * (Distance * Distance));
+
+	// Faded out towards the end of the range like the clustered lights of Terrain.frag
+	float Fade = clamp(1.f - pow(Distance / FPositionRange.w, 4.f), 0.f, 1.f);
+	OFragColor = vec4((Ambient + Diffuse + Specular) * Attenuation * Fade * Fade, 1.f);
+}
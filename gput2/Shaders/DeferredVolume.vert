@@ -0,0 +1,34 @@
+#version 330 core
+
+layout (location = 0) in vec3 VPosition;
+// The four texels of a light in GClusteredLights, one light per instance
+layout (location = 2) in vec4 VPositionRange;
+layout (location = 3) in vec4 VAmbientConstant;
+layout (location = 4) in vec4 VDiffuseLinear;
+layout (location = 5) in vec4 VSpecularQuadratic;
+
+// Shared with every program, EUniformBlock::Camera
+layout (std140) uniform UCamera
+{
+	mat4 UProjection;
+	mat4 UView;
+	vec3 UViewPosition;
+};
+
+flat out vec4 FPositionRange;
+flat out vec4 FAmbientConstant;
+flat out vec4 FDiffuseLinear;
+flat out vec4 FSpecularQuadratic;
+
+// The sphere of GDeferred, 16 segments by 8 rings, only reaches cos(pi / 16)^2 of its radius between the vertices
+const float VolumeScale = 1.04f;
+
+void main()
+{
+	gl_Position = UProjection * UView * vec4(VPosition * VPositionRange.w * VolumeScale + VPositionRange.xyz, 1.f);
+
+	FPositionRange = VPositionRange;
+	FAmbientConstant = VAmbientConstant;
+	FDiffuseLinear = VDiffuseLinear;
+	FSpecularQuadratic = VSpecularQuadratic;
+}
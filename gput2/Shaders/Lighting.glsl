@@ -0,0 +1,250 @@
+// Lights and shadows of the lit terrain programs, Terrain.frag and DeferredLight.frag. Spliced right after their #version by
+// GShader, without a #version of its own. The including shader sets Material.Diffuse before calling the lights.
+
+struct FMaterial {
+    vec3 Ambient;
+	vec3 Diffuse;
+	vec3 Specular;
+    float Shininess;
+}; 
+// Specular and shininess of the terrain
+uniform FMaterial UMaterial;
+FMaterial Material;
+
+
+struct FLight {
+
+    vec3 Ambient;
+    vec3 Diffuse;
+    vec3 Specular;
+};
+
+struct FDirectionalLight {
+    vec3 Direction;
+
+    FLight Light;
+};
+
+struct FPointLight {    
+    vec3 Position;
+
+	float Constant;
+	float Linear;
+	float Quadratic;
+  
+    FLight Light;
+};  
+#define POINT_LIGHTS 1  
+
+struct FSpotLight {
+    vec3 Position;
+    vec3 Direction;
+
+	float Constant;
+	float Linear;
+	float Quadratic;
+
+	float CutOff;
+	float OuterCutOff;
+
+    FLight Light;
+};
+
+// Shared with the lit programs, EUniformBlock::Lights. POINT_LIGHTS matches PointLightsCount in UniformBlocks.h
+layout (std140) uniform ULights
+{
+	FDirectionalLight UDirectionalLight;
+	FPointLight UPointLights[POINT_LIGHTS];
+	FSpotLight USpotLight;
+};
+
+// Shared with every program, EUniformBlock::Camera
+layout (std140) uniform UCamera
+{
+	mat4 UProjection;
+	mat4 UView;
+	vec3 UViewPosition;
+};
+
+// Shadows of the directional light, EUniformBlock::Shadows. SHADOW_CASCADES matches ShadowCascadesMax in UniformBlocks.h.
+// UShadowParams is the cascades in use, 0 without them, the size of a texel in texture coordinates, and the step budget of
+// the heightfield march, 0 without it. UShadowHeightfield is the texture coordinates of the height map per world unit, the
+// world height per fbm unit, the top level of UShadowHeights and its texels per side.
+#define SHADOW_CASCADES 4
+layout (std140) uniform UShadows
+{
+	mat4 UShadowLightSpace[SHADOW_CASCADES];
+	vec4 UShadowSplits;
+	vec4 UShadowTexelSizes;
+	vec4 UShadowParams;
+	vec4 UShadowHeightfield;
+};
+
+// A layer per cascade, compared with the depth of the lookup
+uniform sampler2DArrayShadow UShadowMap;
+// Highest fbm of each texel of UHeightMap and of each 2^L x 2^L texels on level L, from GHeightMaxPyramid
+uniform sampler2D UShadowHeights;
+uniform sampler2D UHeightMap;
+
+void CalculateLight(FLight SpotLight, vec3 Normal, vec3 LightDirection, vec3 ViewDirection, out vec3 Ambient, out vec3 Diffuse, out vec3 Specular);
+float CalculateHeightfieldShadow(vec3 FPosition, vec3 Normal);
+
+vec3 CalculateDirectonalLight(FDirectionalLight DirectionalLight, vec3 Normal, vec3 ViewDirection, float Shadow)
+{
+    vec3 LightDirection = normalize(-DirectionalLight.Direction);
+
+    vec3 Ambient, Diffuse, Specular;
+	CalculateLight(DirectionalLight.Light, Normal, LightDirection, ViewDirection, Ambient, Diffuse, Specular);
+
+    return  Ambient + (Diffuse + Specular) * Shadow;
+}
+
+float CalculateShadow(vec3 FPosition, vec3 Normal)
+{
+	if (UShadowParams.z > 0.f)
+	{
+		return CalculateHeightfieldShadow(FPosition, Normal);
+	}
+
+	int Cascades = int(UShadowParams.x);
+	float Depth = -(UView * vec4(FPosition, 1.f)).z;
+	if (Cascades == 0 || Depth > UShadowSplits[Cascades - 1])
+	{
+		return 1.f;
+	}
+	int Cascade = 0;
+	while (Depth > UShadowSplits[Cascade])
+	{
+		++Cascade;
+	}
+
+	// A texel and a half along the normal, so the slopes don't shadow themselves
+	vec4 Light = UShadowLightSpace[Cascade] * vec4(FPosition + Normal * UShadowTexelSizes[Cascade] * 1.5f, 1.f);
+	vec3 Coordinates = Light.xyz * 0.5f + 0.5f;
+
+	// 3 x 3 PCF, each tap blends four comparisons
+	float Lit = 0.f;
+	for (int y = -1; y <= 1; ++y)
+	{
+		for (int x = -1; x <= 1; ++x)
+		{
+			Lit += texture(UShadowMap, vec4(Coordinates.xy + vec2(x, y) * UShadowParams.y, float(Cascade), Coordinates.z));
+		}
+	}
+	return Lit / 9.f;
+}
+
+float CalculateHeightfieldShadow(vec3 FPosition, vec3 Normal)
+{
+	float Scale = UShadowHeightfield.x;
+	float HeightScale = UShadowHeightfield.y;
+	int Top = int(UShadowHeightfield.z);
+	float Resolution = UShadowHeightfield.w;
+
+	vec3 Sun = normalize(-UDirectionalLight.Direction);
+	if (Sun.y <= 0.f || Scale == 0.f || HeightScale <= 0.f)
+	{
+		return 1.f;
+	}
+
+	// In texture coordinates and fbm, from a texel above the surface so it doesn't shadow itself. Direction advances one
+	// texture coordinate across the map per unit.
+	vec3 Start = FPosition + Normal / (abs(Scale) * Resolution);
+	vec3 Position = vec3(Start.xz * Scale + 0.5f, Start.y / HeightScale - 1.f);
+	vec3 Direction = vec3(Sun.xz * Scale, Sun.y / HeightScale);
+	if (length(Direction.xy) < 1e-6f)
+	{
+		return 1.f;
+	}
+	Direction /= length(Direction.xy);
+	vec2 Inverse = 1.f / mix(Direction.xy, vec2(1e-6f), lessThan(abs(Direction.xy), vec2(1e-6f)));
+
+	// Climbs to coarser levels while the ray passes above them and goes down where it doesn't, the empty space is crossed
+	// in about log2(Resolution) steps
+	float Highest = texelFetch(UShadowHeights, ivec2(0), Top).r;
+	int Level = 0;
+	for (int Step = 0; Step < int(UShadowParams.z); ++Step)
+	{
+		if (Position.z > Highest || any(lessThan(Position.xy, vec2(0.f))) || any(greaterThanEqual(Position.xy, vec2(1.f))))
+		{
+			return 1.f;
+		}
+
+		float CellSize = exp2(float(Level)) / Resolution;
+		vec2 Cell = floor(Position.xy / CellSize);
+		// Where the ray leaves the cell, it is at its lowest where it enters since it climbs towards the light
+		vec2 Exit = ((Cell + step(0.f, Direction.xy)) * CellSize - Position.xy) * Inverse;
+		float Distance = min(Exit.x, Exit.y) + CellSize * 0.001f;
+
+		if (Position.z > texelFetch(UShadowHeights, ivec2(Cell), Level).r)
+		{
+			Position += Direction * Distance;
+			Level = min(Level + 1, Top);
+		}
+		else if (Level > 0)
+		{
+			--Level;
+		}
+		else
+		{
+			// Under the bound of a texel, the filtered heights where the ray enters and leaves it decide
+			vec3 Exited = Position + Direction * Distance;
+			if (Position.z < texture(UHeightMap, Position.xy).r || Exited.z < texture(UHeightMap, Exited.xy).r)
+			{
+				return 0.f;
+			}
+			Position = Exited;
+		}
+	}
+	// Out of steps, lit rather than a band of false shadows in the distance
+	return 1.f;
+}
+
+vec3 CalculatePointLight(FPointLight PointLight, vec3 Normal, vec3 FPosition, vec3 ViewDirection)
+{
+	vec3 LightDirection = normalize(PointLight.Position - FPosition);
+
+    vec3 Ambient, Diffuse, Specular;
+    CalculateLight(PointLight.Light, Normal, LightDirection, ViewDirection, Ambient, Diffuse, Specular);
+
+	float Distance = length(PointLight.Position - FPosition);
+	float Attenuation = 1.0 / (PointLight.Constant + PointLight.Linear * Distance + PointLight.Quadratic * (Distance * Distance));  
+
+	Ambient *= Attenuation;
+	Diffuse *= Attenuation;
+	Specular *= Attenuation;
+
+	return Ambient + Diffuse + Specular;
+}
+
+vec3 CalculateSpotLight(FSpotLight SpotLight, vec3 Normal, vec3 FPosition, vec3 ViewDirection)
+{
+	vec3 LightDirection = normalize(SpotLight.Position - FPosition);
+
+    vec3 Ambient, Diffuse, Specular;
+    CalculateLight(SpotLight.Light, Normal, LightDirection, ViewDirection, Ambient, Diffuse, Specular);
+
+	float Distance = length(SpotLight.Position - FPosition);
+	float Attenuation = 1.0 / (SpotLight.Constant + SpotLight.Linear * Distance + SpotLight.Quadratic * (Distance * Distance));
+
+	float Theta = dot(LightDirection, normalize(-SpotLight.Direction));
+	float Epsilon   = SpotLight.CutOff - SpotLight.OuterCutOff;
+	float Intensity = clamp((Theta - SpotLight.OuterCutOff) / Epsilon, 0.0, 1.0);
+
+	Ambient *= Attenuation * Intensity;
+	Diffuse *= Attenuation * Intensity;
+	Specular *= Attenuation * Intensity;
+
+	return Ambient + Diffuse + Specular;
+}
+
+void CalculateLight(FLight Light, vec3 Normal, vec3 LightDirection, vec3 ViewDirection, out vec3 Ambient, out vec3 Diffuse, out vec3 Specular)
+{
+	float DiffuseRatio = max(dot(Normal, LightDirection), 0.f);
+    vec3 ReflectionDirection = reflect(-LightDirection, Normal);
+    float SpecularRatio = pow(max(dot(ViewDirection, ReflectionDirection), 0.f), UMaterial.Shininess);
+
+    Ambient  = Light.Ambient  * Material.Diffuse / 2.f;
+    Diffuse  = Light.Diffuse  * DiffuseRatio * Material.Diffuse;
+    Specular = Light.Specular * SpecularRatio * UMaterial.Specular;
+}
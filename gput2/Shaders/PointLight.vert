@@ -2,12 +2,20 @@
 
 layout (location = 0) in vec3 VPosition;
 layout (location = 1) in vec3 VNormal;
+// Position and scale of the instanced markers of the clustered lights. Not enabled for the single light, which reads (0, 0, 0, 1)
+layout (location = 2) in vec4 VInstance;
 
 uniform mat4 UModel;
-uniform mat4 UView;
-uniform mat4 UProjection;
+
+// Shared with every program, EUniformBlock::Camera
+layout (std140) uniform UCamera
+{
+	mat4 UProjection;
+	mat4 UView;
+	vec3 UViewPosition;
+};
 
 void main()
 {
-	gl_Position = UProjection * UView * UModel * vec4(VPosition, 1.f);
+	gl_Position = UProjection * UView * UModel * vec4(VPosition * VInstance.w + VInstance.xyz, 1.f);
 }
\ No newline at end of file
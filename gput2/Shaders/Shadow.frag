@@ -0,0 +1,7 @@
+#version 330 core
+
+// Depth only, the cascade has no color attachment
+
+void main()
+{
+}
@@ -0,0 +1,12 @@
+#version 330 core
+
+// Depth of the terrain vertices cached by GTerrainCache, already displaced and in world space, in a cascade of GShadowCascades
+
+layout (location = 0) in vec3 VPosition;
+
+uniform mat4 ULightSpace;
+
+void main()
+{
+	gl_Position = ULightSpace * vec4(VPosition, 1.f);
+}
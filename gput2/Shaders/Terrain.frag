@@ -1,62 +1,44 @@
 #version 330 core
 
-struct FMaterial {
-    vec3 Ambient;
-	vec3 Diffuse;
-	vec3 Specular;
-    float Shininess;
-}; 
-uniform FMaterial UMaterial;
-FMaterial Material;
-
-
-struct FLight {
-
-    vec3 Ambient;
-    vec3 Diffuse;
-    vec3 Specular;
-};
-
-struct FDirectionalLight {
-    vec3 Direction;
-
-    FLight Light;
-};
-uniform FDirectionalLight UDirectionalLight;
-
-struct FPointLight {    
-    vec3 Position;
-
-	float Constant;
-	float Linear;
-	float Quadratic;
-  
-    FLight Light;
-};  
-#define POINT_LIGHTS 1  
-uniform FPointLight UPointLights[POINT_LIGHTS];
-
-struct FSpotLight {
-    vec3 Position;
-    vec3 Direction;
-
-	float Constant;
-	float Linear;
-	float Quadratic;
-
-	float CutOff;
-	float OuterCutOff;
-
-    FLight Light;
+// Lighting.glsl, the light and shadow uniforms and functions, is spliced in right after #version by GShader
+
+// Lights compiled in, the permutations define them 0 for the inactive ones instead of running their math on black
+#ifndef DIRECTIONAL_LIGHT
+#define DIRECTIONAL_LIGHT 1
+#endif
+#ifndef POINT_LIGHT
+#define POINT_LIGHT 1
+#endif
+#ifndef SPOT_LIGHT
+#define SPOT_LIGHT 1
+#endif
+#ifndef CLUSTERED_LIGHTS
+#define CLUSTERED_LIGHTS 1
+#endif
+
+// Froxel grid of the clustered point lights, EUniformBlock::Clusters. Grid is tiles across, tiles up, depth slices and
+// lights, the slice of a view depth d is log(d) * Mapping.x + Mapping.y and the tile of a pixel its coordinates * Mapping.zw
+layout (std140) uniform UClusters
+{
+	ivec4 UClusterGrid;
+	vec4 UClusterMapping;
 };
-uniform FSpotLight USpotLight;
 
-uniform vec3 UViewPosition;
+// Four texels per light: position and range, then ambient, diffuse and specular with the constant, linear and quadratic factors
+uniform samplerBuffer UClusterLights;
+// Offset and count in UClusterIndices of every froxel
+uniform usamplerBuffer UClusterRanges;
+uniform usamplerBuffer UClusterIndices;
 
 in vec3 FPosition;
 in vec3 FNormal;
+in float FNormalDifference;
 
-out vec4 OFragColor;
+// The lit color, or the albedo of the G-buffer in the DEFERRED permutation, with the normal in ONormal
+layout (location = 0) out vec4 OFragColor;
+#ifdef DEFERRED
+layout (location = 1) out vec4 ONormal;
+#endif
 
 #define GREEN	vec3(  0.f,   0.5f,   0.f)
 #define LIME	vec3(  0.f,    1.f,   0.f)
@@ -67,13 +49,28 @@ out vec4 OFragColor;
 
 uniform float UHeight;
 
-vec3 CalculateDirectonalLight(FDirectionalLight DirectionalLight, vec3 Normal, vec3 ViewDirection);
-vec3 CalculatePointLight(FPointLight PointLight, vec3 Normal, vec3 FPosition, vec3 ViewDirection);
-vec3 CalculateSpotLight(FSpotLight Light, vec3 Normal, vec3 FPosition, vec3 ViewDirection);
-void CalculateLight(FLight SpotLight, vec3 Normal, vec3 LightDirection, vec3 ViewDirection, out vec3 Ambient, out vec3 Diffuse, out vec3 Specular);
+// 0: finite differences, 1: analytic derivatives, 2: difference between both.
+// A constant in the permutations compiled with NORMAL_MODE, so the other modes are not compiled in
+#ifdef NORMAL_MODE
+const int NormalMode = NORMAL_MODE;
+#else
+uniform int UNormalMode;
+#define NormalMode UNormalMode
+#endif
+
+vec3 CalculateClusteredLights(vec3 Normal, vec3 FPosition, vec3 ViewDirection);
 
 void main()
 {
+#if defined(DEPTH_ONLY)
+	// The pre-pass only lays the depth, the color pass then shades the visible fragment of each pixel
+	return;
+#elif defined(OVERDRAW)
+	// Added once per shaded fragment over black: red at 4 fragments on a pixel, yellow at 12 and white at 32
+	OFragColor = vec4(1.f / 4.f, 1.f / 12.f, 1.f / 32.f, 1.f);
+	return;
+#endif
+
 	vec3 Normal = normalize(FNormal);
 	vec3 ViewDirection = normalize(UViewPosition - FPosition);
 
@@ -84,74 +81,69 @@ void main()
 					GRAY * (smoothstep( 7.0*UHeight/12.0, 9.0*UHeight/12.0, FPosition.y) - smoothstep( 9.0*UHeight/12.0, 11.0*UHeight/12.0, FPosition.y)) +
 					WHITE * (smoothstep( 9.0*UHeight/12.0, 11.0*UHeight/12.0, FPosition.y) - smoothstep( 11.0*UHeight/12.0, 13.0*UHeight/12.0, FPosition.y));
 
-	vec3 Result = CalculateDirectonalLight(UDirectionalLight, Normal, ViewDirection);
+#ifdef DEFERRED
+	// Lit by GDeferred
+	OFragColor = vec4(Material.Diffuse, 1.f);
+	ONormal = vec4(Normal, 0.f);
+#else
+	vec3 Result = vec3(0.f);
+
+#if DIRECTIONAL_LIGHT
+	Result += CalculateDirectonalLight(UDirectionalLight, Normal, ViewDirection, CalculateShadow(FPosition, Normal));
+#endif
 
+#if POINT_LIGHT
 	for(int i = 0; i < POINT_LIGHTS; ++i)
 	{
 		Result += CalculatePointLight(UPointLights[i], Normal, FPosition, ViewDirection);
 	}
+#endif
 
+#if SPOT_LIGHT
 	Result += CalculateSpotLight(USpotLight, Normal, FPosition, ViewDirection);
+#endif
 
-	OFragColor = vec4(Result, 1.f);
-}
-
-vec3 CalculateDirectonalLight(FDirectionalLight DirectionalLight, vec3 Normal, vec3 ViewDirection)
-{
-    vec3 LightDirection = normalize(-DirectionalLight.Direction);
-
-    vec3 Ambient, Diffuse, Specular;
-	CalculateLight(DirectionalLight.Light, Normal, LightDirection, ViewDirection, Ambient, Diffuse, Specular);
+#if CLUSTERED_LIGHTS
+	Result += CalculateClusteredLights(Normal, FPosition, ViewDirection);
+#endif
 
-    return  Ambient + Diffuse + Specular;
-}
-
-vec3 CalculatePointLight(FPointLight PointLight, vec3 Normal, vec3 FPosition, vec3 ViewDirection)
-{
-	vec3 LightDirection = normalize(PointLight.Position - FPosition);
-
-    vec3 Ambient, Diffuse, Specular;
-    CalculateLight(PointLight.Light, Normal, LightDirection, ViewDirection, Ambient, Diffuse, Specular);
-
-	float Distance = length(PointLight.Position - FPosition);
-	float Attenuation = 1.0 / (PointLight.Constant + PointLight.Linear * Distance + PointLight.Quadratic * (Distance * Distance));  
-
-	Ambient *= Attenuation;
-	Diffuse *= Attenuation;
-	Specular *= Attenuation;
+	OFragColor = vec4(Result, 1.f);
+#endif
 
-	return Ambient + Diffuse + Specular;
+	// Angle between the analytic and the finite differences normals, blue is 0 degrees and red 10 or more.
+	// Alpha 0 keeps it unlit in the G-buffer.
+	if (NormalMode == 2)
+	{
+		float Difference = clamp(FNormalDifference / 10.f, 0.f, 1.f);
+		OFragColor = vec4(Difference, 0.f, 1.f - Difference, 0.f);
+	}
 }
 
-vec3 CalculateSpotLight(FSpotLight SpotLight, vec3 Normal, vec3 FPosition, vec3 ViewDirection)
+vec3 CalculateClusteredLights(vec3 Normal, vec3 FPosition, vec3 ViewDirection)
 {
-	vec3 LightDirection = normalize(SpotLight.Position - FPosition);
-
-    vec3 Ambient, Diffuse, Specular;
-    CalculateLight(SpotLight.Light, Normal, LightDirection, ViewDirection, Ambient, Diffuse, Specular);
-
-	float Distance = length(SpotLight.Position - FPosition);
-	float Attenuation = 1.0 / (SpotLight.Constant + SpotLight.Linear * Distance + SpotLight.Quadratic * (Distance * Distance));
-
-	float Theta = dot(LightDirection, normalize(-SpotLight.Direction));
-	float Epsilon   = SpotLight.CutOff - SpotLight.OuterCutOff;
-	float Intensity = clamp((Theta - SpotLight.OuterCutOff) / Epsilon, 0.0, 1.0);
-
-	Ambient *= Attenuation * Intensity;
-	Diffuse *= Attenuation * Intensity;
-	Specular *= Attenuation * Intensity;
-
-	return Ambient + Diffuse + Specular;
-}
+	vec3 Result = vec3(0.f);
+	if (UClusterGrid.w == 0)
+	{
+		return Result;
+	}
 
-void CalculateLight(FLight Light, vec3 Normal, vec3 LightDirection, vec3 ViewDirection, out vec3 Ambient, out vec3 Diffuse, out vec3 Specular)
-{
-	float DiffuseRatio = max(dot(Normal, LightDirection), 0.f);
-    vec3 ReflectionDirection = reflect(-LightDirection, Normal);
-    float SpecularRatio = pow(max(dot(ViewDirection, ReflectionDirection), 0.f), UMaterial.Shininess);
+	float Depth = -(UView * vec4(FPosition, 1.f)).z;
+	int Slice = clamp(int(log(max(Depth, 0.0001f)) * UClusterMapping.x + UClusterMapping.y), 0, UClusterGrid.z - 1);
+	ivec2 Tile = clamp(ivec2(gl_FragCoord.xy * UClusterMapping.zw), ivec2(0), UClusterGrid.xy - 1);
+	uvec2 Range = texelFetch(UClusterRanges, (Slice * UClusterGrid.y + Tile.y) * UClusterGrid.x + Tile.x).xy;
 
-    Ambient  = Light.Ambient  * Material.Diffuse / 2.f;
-    Diffuse  = Light.Diffuse  * DiffuseRatio * Material.Diffuse;
-    Specular = Light.Specular * SpecularRatio * UMaterial.Specular;
+	for (uint i = 0u; i < Range.y; ++i)
+	{
+		int Light = 4 * int(texelFetch(UClusterIndices, int(Range.x + i)).x);
+		vec4 PositionRange = texelFetch(UClusterLights, Light);
+		vec4 Ambient = texelFetch(UClusterLights, Light + 1);
+		vec4 Diffuse = texelFetch(UClusterLights, Light + 2);
+		vec4 Specular = texelFetch(UClusterLights, Light + 3);
+		FPointLight PointLight = FPointLight(PositionRange.xyz, Ambient.w, Diffuse.w, Specular.w, FLight(Ambient.rgb, Diffuse.rgb, Specular.rgb));
+
+		// Faded out towards the end of the range, the froxels past it don't list the light
+		float Fade = clamp(1.f - pow(length(PositionRange.xyz - FPosition) / PositionRange.w, 4.f), 0.f, 1.f);
+		Result += CalculatePointLight(PointLight, Normal, FPosition, ViewDirection) * Fade * Fade;
+	}
+	return Result;
 }
-
@@ -1,10 +1,17 @@
 #version 330 core
 
 layout (location = 0) in vec2 VGridCoordinates;
+layout (location = 1) in vec3 VPatch; // First cell of the instanced patch and its cells per side
 
 uniform mat4 UModel;
-uniform mat4 UView;
-uniform mat4 UProjection;
+
+// Shared with every program, EUniformBlock::Camera
+layout (std140) uniform UCamera
+{
+	mat4 UProjection;
+	mat4 UView;
+	vec3 UViewPosition;
+};
 
 uniform float UWidth;
 uniform float UHeight;
@@ -12,8 +19,37 @@ uniform float UTime;
 
 uniform float USeparationFactor;
 
+// 0: grid coordinates as given, 1: quadtree patch placed by UPatch and morphed towards the next level by distance,
+// 2: clipmap level placed by UPatch and morphed towards the next level near its border
+uniform int UGridMode;
+uniform vec4 UPatch; // xy: world corner or first strip cell, z: quadtree world size or clipmap cell size, w: quadtree cells per side or clipmap cells to the center
+uniform vec2 UMorph; // quadtree distances or clipmap cells from the center where the morph starts and ends
+
+// Grid mode only. 0: VGridCoordinates, 1: patch template vertex in VGridCoordinates placed by VPatch,
+// 2: row strips from the cell in UPatch.xy, two vertices per column and one row per instance
+uniform int UGridSource;
+uniform int UGridVertices; // Vertices of GenerateGrid, half the cells per side
+
+// 0: finite differences, 1: analytic derivatives, 2: difference between both.
+// A constant in the permutations compiled with NORMAL_MODE, so the other modes are not compiled in
+#ifdef NORMAL_MODE
+const int NormalMode = NORMAL_MODE;
+#else
+uniform int UNormalMode;
+#define NormalMode UNormalMode
+#endif
+
+// 0: fbm evaluated per vertex, 1: fbm and gradient fetched from the baked height map
+uniform int UHeightSource;
+uniform sampler2D UHeightMap;
+uniform float UHeightMapRange;
+
 out vec3 FPosition;
 out vec3 FNormal;
+out float FNormalDifference;
+
+// The same depth in every permutation, the color pass after the DEPTH_ONLY pre-pass tests it with GL_EQUAL
+invariant gl_Position;
 
 // Hashes, noises and fbms from https://www.shadertoy.com/view/4ttSWf
 
@@ -242,7 +278,7 @@ vec3 fbmd_9( in vec2 x )
     mat2  m = mat2(1.0,0.0,0.0,1.0);
     for( int i=0; i<9; i++ )
     {
-        vec3 n = noised(x);
+        vec3 n = noised(x + UTime);
         a += b*n.x;          // accumulate values		
         d += b*m*n.yz;       // accumulate derivatives
         b *= s;
@@ -298,11 +334,79 @@ vec3 GetNormal(in vec2 Position)
 	return normalize(Normal0 + Normal1 + Normal2 + Normal3 + Normal4 + Normal5);
 }
 
+// Normal from the fbmd_9 gradient. GetNormal places its neighbours at the same offsets in noise and world space,
+// so the slope is taken in noise space too and both modes shade alike.
+vec3 GetAnalyticNormal(in vec2 Gradient)
+{
+	vec2 Slope = (UHeight / 2.0) * Gradient;
+	return normalize(vec3(-Slope.x, 1.f, -Slope.y));
+}
+
+// Patch vertices at odd positions slide onto the edge shared with their neighbour, so at the end of the morph
+// the patch matches the one of the next level exactly
+vec2 GetGridCoordinates()
+{
+	if (UGridMode == 0)
+	{
+		if (UGridSource == 0)
+		{
+			return VGridCoordinates;
+		}
+		// Same rows and columns as GenerateGrid, strips follow the diagonal of its cells
+		ivec2 Vertex = UGridSource == 1 ? ivec2(round(VPatch.xy + VGridCoordinates * VPatch.z)) : ivec2(UPatch.xy) + ivec2(gl_VertexID / 2, gl_InstanceID + gl_VertexID % 2);
+		return USeparationFactor * vec2(Vertex.x - UGridVertices, UGridVertices - Vertex.y);
+	}
+	if (UGridMode == 2)
+	{
+		// Clipmap vertices are whole cells, odd ones are moved onto the even ones the next level shares
+		vec2 Offset = abs(VGridCoordinates - UPatch.w);
+		float Morph = clamp((max(Offset.x, Offset.y) - UMorph.x) / (UMorph.y - UMorph.x), 0.f, 1.f);
+		vec2 Cells = VGridCoordinates - mod(VGridCoordinates, 2.0) * Morph;
+		return (UPatch.xy + Cells * UPatch.z) / UWidth;
+	}
+	vec2 World = UPatch.xy + VGridCoordinates * UPatch.z;
+	float Distance = distance(UViewPosition, vec3(World.x, UHeight / 2.0, World.y));
+	float Morph = clamp((Distance - UMorph.x) / (UMorph.y - UMorph.x), 0.f, 1.f);
+	vec2 Fraction = fract(VGridCoordinates * UPatch.w * 0.5) * 2.0 / UPatch.w;
+	return (UPatch.xy + (VGridCoordinates - Fraction * Morph) * UPatch.z) / UWidth;
+}
+
 void main()
 {
-	vec3 Position = vec3(VGridCoordinates.x * UWidth, (fbm_9(VGridCoordinates) + 1.0) * (UHeight / 2.0), VGridCoordinates.y * UWidth);
+	vec2 GridCoordinates = GetGridCoordinates();
+
+	float Height;
+	vec3 Normal;
+	FNormalDifference = 0.f;
+	if (UHeightSource == 1)
+	{
+		vec3 Fbm = texture(UHeightMap, GridCoordinates / UHeightMapRange + 0.5).xyz;
+		Height = Fbm.x;
+		Normal = GetAnalyticNormal(Fbm.yz);
+	}
+	else if (NormalMode == 0)
+	{
+		Height = fbm_9(GridCoordinates);
+#ifndef DEPTH_ONLY
+		Normal = GetNormal(GridCoordinates);
+#endif
+	}
+	else
+	{
+		vec3 Fbm = fbmd_9(GridCoordinates);
+		Height = Fbm.x;
+		Normal = GetAnalyticNormal(Fbm.yz);
+#ifndef DEPTH_ONLY
+		if (NormalMode == 2)
+		{
+			FNormalDifference = degrees(acos(clamp(dot(Normal, GetNormal(GridCoordinates)), -1.f, 1.f)));
+		}
+#endif
+	}
+
+	vec3 Position = vec3(GridCoordinates.x * UWidth, (Height + 1.0) * (UHeight / 2.0), GridCoordinates.y * UWidth);
 	FPosition = vec3(UModel * vec4(Position, 1.f));
-	FNormal = mat3(transpose(inverse(UModel))) * GetNormal(VGridCoordinates);
+	FNormal = mat3(transpose(inverse(UModel))) * Normal;
 
 	gl_Position = UProjection * UView * UModel * vec4(Position , 1.f);
 }
\ No newline at end of file
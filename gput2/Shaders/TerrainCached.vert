@@ -0,0 +1,30 @@
+#version 330 core
+
+// Pass-through for the terrain vertices captured from Terrain.vert with transform feedback, already displaced and in world space
+
+layout (location = 0) in vec3 VPosition;
+layout (location = 1) in vec3 VNormal;
+
+// Shared with every program, EUniformBlock::Camera
+layout (std140) uniform UCamera
+{
+	mat4 UProjection;
+	mat4 UView;
+	vec3 UViewPosition;
+};
+
+out vec3 FPosition;
+out vec3 FNormal;
+out float FNormalDifference;
+
+// Like Terrain.vert, for the GL_EQUAL color pass after the pre-pass
+invariant gl_Position;
+
+void main()
+{
+	FPosition = VPosition;
+	FNormal = VNormal;
+	FNormalDifference = 0.f;
+
+	gl_Position = UProjection * UView * vec4(VPosition, 1.f);
+}
\ No newline at end of file
@@ -0,0 +1,231 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cfloat>
+#include <iostream>
+
+#include "Camera.h"
+#include "UniformBlocks.h"
+
+// Cascaded shadow maps of the directional light, a layer of a depth texture array per cascade. The view range of the camera
+// is split in slices, closer to each other near the camera, and each slice is covered by an orthographic cascade around its
+// bounding sphere. The size of the sphere is fixed, so the texels keep their size when the camera turns, and its center,
+// which follows the view, is snapped to whole texels of the light view, so the shadow edges don't crawl. A cascade that
+// lands on the same texels keeps the depth it rendered before.
+class GShadowCascades
+{
+public:
+	GShadowCascades(int Count, int Resolution);
+
+	// Allocates the layers again when the count or the resolution differ
+	void SetCascades(int Count, int Resolution);
+
+	// Fits the cascades to the camera between Near and Far, lit along Direction. The cascades reach every caster in the box
+	// from BoundsMin to BoundsMax. A cascade needs a render when it moved, or when Version, of the casters, changed.
+	void Update(const GCamera &Camera, float Aspect, float Near, float Far, glm::vec3 Direction, glm::vec3 BoundsMin, glm::vec3 BoundsMax, int Version);
+
+	bool NeedsRender(int Cascade) const;
+	// Binds the layer of Cascade and clears it, the casters are then drawn with GetLightSpace(Cascade)
+	void Begin(int Cascade);
+	// Back to the default framebuffer and its viewport
+	void End(int Width, int Height);
+
+	const glm::mat4 &GetLightSpace(int Cascade) const;
+	FShadowsBlock GetBlock() const;
+	void Bind(int Unit) const;
+
+	void Delete();
+
+public:
+	int Count;
+	int Resolution;
+	// Blend between uniform and logarithmic splits, 1 is fully logarithmic
+	float SplitLambda;
+	// Cascades rendered since the start, the ones that kept their depth are not counted
+	int Renders;
+
+private:
+	void Allocate();
+
+	unsigned int FBO;
+	unsigned int Texture;
+
+	glm::mat4 LightSpaces[ShadowCascadesMax];
+	glm::mat4 RenderedLightSpaces[ShadowCascadesMax];
+	bool bRendered[ShadowCascadesMax];
+	float Splits[ShadowCascadesMax];
+	float TexelSizes[ShadowCascadesMax];
+	int Version;
+};
+
+__forceinline GShadowCascades::GShadowCascades(int InCount, int InResolution) : Count(InCount), Resolution(InResolution), SplitLambda(0.75f), Renders(0), Version(-1)
+{
+	glGenFramebuffers(1, &FBO);
+	glGenTextures(1, &Texture);
+	Allocate();
+}
+
+__forceinline void GShadowCascades::SetCascades(int InCount, int InResolution)
+{
+	if (InCount == Count && InResolution == Resolution)
+	{
+		return;
+	}
+	Count = InCount;
+	Resolution = InResolution;
+	Allocate();
+}
+
+__forceinline void GShadowCascades::Update(const GCamera &Camera, float Aspect, float Near, float Far, glm::vec3 Direction, glm::vec3 BoundsMin, glm::vec3 BoundsMax, int InVersion)
+{
+	if (InVersion != Version)
+	{
+		Version = InVersion;
+		for (int i = 0; i < ShadowCascadesMax; ++i)
+		{
+			bRendered[i] = false;
+		}
+	}
+
+	// The same light view for every cascade, only the orthographic windows move
+	glm::vec3 Forward = glm::normalize(Direction);
+	glm::vec3 Up = glm::abs(Forward.y) > 0.99f ? glm::vec3(0.f, 0.f, 1.f) : glm::vec3(0.f, 1.f, 0.f);
+	glm::mat4 LightView = glm::lookAt(glm::vec3(0.f), Forward, Up);
+
+	// Depth range of the casters along the light, shared by the cascades
+	float MinZ = FLT_MAX;
+	float MaxZ = -FLT_MAX;
+	for (int Corner = 0; Corner < 8; ++Corner)
+	{
+		glm::vec3 Position((Corner & 1) ? BoundsMax.x : BoundsMin.x, (Corner & 2) ? BoundsMax.y : BoundsMin.y, (Corner & 4) ? BoundsMax.z : BoundsMin.z);
+		float Z = (LightView * glm::vec4(Position, 1.f)).z;
+		MinZ = glm::min(MinZ, Z);
+		MaxZ = glm::max(MaxZ, Z);
+	}
+
+	// Squared tangent of the half diagonal of the view, a slice between n and f has its corners at n and f along the view
+	// and n * sqrt(Spread) and f * sqrt(Spread) away from it
+	float TanY = glm::tan(glm::radians(Camera.Zoom) / 2.f);
+	float Spread = TanY * TanY * (1.f + Aspect * Aspect);
+
+	float Start = Near;
+	for (int i = 0; i < Count; ++i)
+	{
+		float Ratio = (float)(i + 1) / (float)Count;
+		float End = SplitLambda * Near * glm::pow(Far / Near, Ratio) + (1.f - SplitLambda) * (Near + (Far - Near) * Ratio);
+
+		// Center along the view at the same distance from the near and far corners, or the far center when past it
+		float Center = glm::min((Start + End) * (1.f + Spread) / 2.f, End);
+		float Radius = glm::sqrt(glm::max((Center - Start) * (Center - Start) + Start * Start * Spread, (End - Center) * (End - Center) + End * End * Spread));
+		// Rounded up so float noise doesn't change the texel size
+		Radius = glm::ceil(Radius * 16.f) / 16.f;
+
+		float TexelSize = 2.f * Radius / (float)Resolution;
+		glm::vec3 LightCenter = glm::vec3(LightView * glm::vec4(Camera.Position + Camera.Front * Center, 1.f));
+		LightCenter.x = glm::floor(LightCenter.x / TexelSize) * TexelSize;
+		LightCenter.y = glm::floor(LightCenter.y / TexelSize) * TexelSize;
+
+		glm::mat4 Projection = glm::ortho(LightCenter.x - Radius, LightCenter.x + Radius, LightCenter.y - Radius, LightCenter.y + Radius, -MaxZ - 1.f, -MinZ + 1.f);
+		LightSpaces[i] = Projection * LightView;
+		Splits[i] = End;
+		TexelSizes[i] = TexelSize;
+		if (LightSpaces[i] != RenderedLightSpaces[i])
+		{
+			bRendered[i] = false;
+		}
+
+		Start = End;
+	}
+}
+
+__forceinline bool GShadowCascades::NeedsRender(int Cascade) const
+{
+	return !bRendered[Cascade];
+}
+
+__forceinline void GShadowCascades::Begin(int Cascade)
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+	glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, Texture, 0, Cascade);
+	glViewport(0, 0, Resolution, Resolution);
+	glClear(GL_DEPTH_BUFFER_BIT);
+	// Pushed back along the slopes against acne, the lookup adds a normal offset for the rest
+	glEnable(GL_POLYGON_OFFSET_FILL);
+	glPolygonOffset(2.f, 4.f);
+
+	RenderedLightSpaces[Cascade] = LightSpaces[Cascade];
+	bRendered[Cascade] = true;
+	++Renders;
+}
+
+__forceinline void GShadowCascades::End(int Width, int Height)
+{
+	glDisable(GL_POLYGON_OFFSET_FILL);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(0, 0, Width, Height);
+}
+
+__forceinline const glm::mat4 &GShadowCascades::GetLightSpace(int Cascade) const
+{
+	return LightSpaces[Cascade];
+}
+
+__forceinline FShadowsBlock GShadowCascades::GetBlock() const
+{
+	FShadowsBlock Block = {};
+	for (int i = 0; i < Count; ++i)
+	{
+		Block.LightSpace[i] = LightSpaces[i];
+		Block.Splits[i] = Splits[i];
+		Block.TexelSizes[i] = TexelSizes[i];
+	}
+	Block.Params = glm::vec4((float)Count, 1.f / (float)Resolution, 0.f, 0.f);
+	return Block;
+}
+
+__forceinline void GShadowCascades::Bind(int Unit) const
+{
+	glActiveTexture(GL_TEXTURE0 + Unit);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, Texture);
+	glActiveTexture(GL_TEXTURE0);
+}
+
+__forceinline void GShadowCascades::Delete()
+{
+	glDeleteFramebuffers(1, &FBO);
+	glDeleteTextures(1, &Texture);
+}
+
+__forceinline void GShadowCascades::Allocate()
+{
+	for (int i = 0; i < ShadowCascadesMax; ++i)
+	{
+		LightSpaces[i] = glm::mat4(1.f);
+		RenderedLightSpaces[i] = glm::mat4(1.f);
+		bRendered[i] = false;
+	}
+
+	// Compared in the lookup, the linear filter blends four comparisons under each PCF tap
+	glBindTexture(GL_TEXTURE_2D_ARRAY, Texture);
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, Resolution, Resolution, Count, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+	glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, Texture, 0, 0);
+	glDrawBuffer(GL_NONE);
+	glReadBuffer(GL_NONE);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "ERROR::FRAMEBUFFER::SHADOW_CASCADES_NOT_COMPLETE" << std::endl;
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
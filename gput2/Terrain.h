@@ -0,0 +1,156 @@
+#pragma once
+
+#include "Shader.h"
+
+// Matches UNormalMode in Terrain.vert, or NORMAL_MODE in its permutations
+enum class ETerrainNormals
+{
+	FiniteDifferences,
+	Analytic,
+	Difference
+};
+
+// Matches UHeightSource in Terrain.vert
+enum class ETerrainHeights
+{
+	Procedural,
+	Baked
+};
+
+// Matches UGridMode in Terrain.vert
+enum class ETerrainGeometry
+{
+	Grid,
+	Quadtree,
+	Clipmap
+};
+
+// Forward lights in Terrain.frag, or the G-buffer of its DEFERRED permutation lit by GDeferred
+enum class ETerrainShading
+{
+	Forward,
+	Deferred
+};
+
+// Shadows of the directional light: the depth of GShadowCascades, or a march towards the light over GHeightMaxPyramid
+enum class ETerrainShadows
+{
+	None,
+	Cascades,
+	Heightfield
+};
+
+// Where the grid geometry mode takes its vertices from, matches UGridSource in Terrain.vert
+enum class ETerrainGridSource
+{
+	// VGridCoordinates
+	Attribute,
+	// Template vertex VGridCoordinates of the instanced patch VPatch
+	Patches,
+	// Row strips of the cells from UPatch on, one row per instance
+	Strips
+};
+
+// Uniforms of Terrain.vert that change the displaced terrain
+struct FTerrainUniforms
+{
+	float Width;
+	float Height;
+	float Time;
+	float SeparationFactor;
+	ETerrainNormals Normals;
+	ETerrainHeights Heights;
+
+	bool operator==(const FTerrainUniforms &Other) const;
+	bool operator!=(const FTerrainUniforms &Other) const;
+};
+
+__forceinline bool FTerrainUniforms::operator==(const FTerrainUniforms &Other) const
+{
+	return Width == Other.Width && Height == Other.Height && Time == Other.Time && SeparationFactor == Other.SeparationFactor &&
+		Normals == Other.Normals && Heights == Other.Heights;
+}
+
+__forceinline bool FTerrainUniforms::operator!=(const FTerrainUniforms &Other) const
+{
+	return !(*this == Other);
+}
+
+// Handles of the Terrain.vert uniforms set while drawing, resolved once per program, and the values the program holds
+struct FTerrainHandles
+{
+	explicit FTerrainHandles(const GShader &Shader);
+
+	FUniform Width;
+	FUniform Height;
+	FUniform Time;
+	FUniform SeparationFactor;
+	FUniform NormalMode;
+	FUniform HeightSource;
+	FUniform GridMode;
+	FUniform GridSource;
+	FUniform Patch;
+	FUniform Morph;
+	FUniform Model;
+
+	// Last values sent by SetTerrainUniforms, only the fields that differ are sent again
+	FTerrainUniforms Uploaded;
+	bool bUploaded;
+};
+
+__forceinline FTerrainHandles::FTerrainHandles(const GShader &Shader) :
+	Width(Shader.GetUniform("UWidth")),
+	Height(Shader.GetUniform("UHeight")),
+	Time(Shader.GetUniform("UTime")),
+	SeparationFactor(Shader.GetUniform("USeparationFactor")),
+	NormalMode(Shader.GetUniform("UNormalMode")),
+	HeightSource(Shader.GetUniform("UHeightSource")),
+	GridMode(Shader.GetUniform("UGridMode")),
+	GridSource(Shader.GetUniform("UGridSource")),
+	Patch(Shader.GetUniform("UPatch")),
+	Morph(Shader.GetUniform("UMorph")),
+	Model(Shader.GetUniform("UModel")),
+	Uploaded(),
+	bUploaded(false)
+{
+}
+
+// The shader has to be in use, and nothing else may set these uniforms on it
+void SetTerrainUniforms(const GShader &Shader, FTerrainHandles &Handles, const FTerrainUniforms &Uniforms)
+{
+	bool bAll = !Handles.bUploaded;
+	const FTerrainUniforms &Uploaded = Handles.Uploaded;
+	if (bAll || Uniforms.Width != Uploaded.Width)
+	{
+		Shader.Set1f(Handles.Width, Uniforms.Width);
+	}
+	if (bAll || Uniforms.Height != Uploaded.Height)
+	{
+		Shader.Set1f(Handles.Height, Uniforms.Height);
+	}
+	if (bAll || Uniforms.Time != Uploaded.Time)
+	{
+		Shader.Set1f(Handles.Time, Uniforms.Time);
+	}
+	if (bAll || Uniforms.SeparationFactor != Uploaded.SeparationFactor)
+	{
+		Shader.Set1f(Handles.SeparationFactor, Uniforms.SeparationFactor);
+	}
+	if (bAll || Uniforms.Normals != Uploaded.Normals)
+	{
+		Shader.Set1i(Handles.NormalMode, (int)Uniforms.Normals);
+	}
+	if (bAll || Uniforms.Heights != Uploaded.Heights)
+	{
+		Shader.Set1i(Handles.HeightSource, (int)Uniforms.Heights);
+	}
+	Handles.Uploaded = Uniforms;
+	Handles.bUploaded = true;
+}
+
+// World heights the terrain can reach, fbm_9 stays within the sum of its octave amplitudes
+glm::vec2 GetTerrainHeightBounds(float Height)
+{
+	const float FbmBound = 0.5f / (1.f - 0.55f);
+	return glm::vec2(1.f - FbmBound, 1.f + FbmBound) * (Height / 2.f);
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "Shader.h"
+#include "Terrain.h"
+#include "TerrainPatches.h"
+
+// Displaced terrain vertices (position and normal) captured once from Terrain.vert with transform feedback.
+// While the terrain uniforms stay the same the grid is drawn from this buffer with a pass-through shader,
+// so the fbm is not evaluated again every frame. Vertices are captured patch after patch, each patch draws
+// the shared template indices from its own base vertex.
+class GTerrainCache
+{
+public:
+	// The cached draw reuses the template indices of Patches
+	GTerrainCache(GTerrainPatches &Patches);
+
+	// Captures again only if a uniform differs from the last capture, returns true when it did.
+	// With baked heights the height map has to be bound already.
+	bool Update(GShader &FeedbackShader, FTerrainHandles &FeedbackHandles, const FTerrainUniforms &Uniforms);
+	void Invalidate();
+	// Draws the given patches from the captured vertices, the pass-through shader has to be in use
+	void Draw(const std::vector<int> &Patches);
+
+	void Delete();
+
+public:
+	unsigned int VAO;
+	unsigned int VBO;
+	int Captures;
+
+private:
+	GTerrainPatches* Patches;
+
+	std::vector<GLsizei> DrawCounts;
+	std::vector<const void*> DrawOffsets;
+	std::vector<GLint> DrawBaseVertices;
+
+	bool bValid;
+	FTerrainUniforms Uniforms;
+};
+
+__forceinline GTerrainCache::GTerrainCache(GTerrainPatches &InPatches) : Captures(0), Patches(&InPatches), bValid(false)
+{
+	int GridVerticesCount = Patches->GetPatchesCount() * Patches->GetPatchVerticesCount();
+
+	glGenVertexArrays(1, &VAO);
+	glGenBuffers(1, &VBO);
+
+	glBindVertexArray(VAO);
+
+	// Interleaved FPosition and FNormal
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	glBufferData(GL_ARRAY_BUFFER, 6 * GridVerticesCount * sizeof(float), NULL, GL_DYNAMIC_COPY);
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, Patches->EBO);
+
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
+	glEnableVertexAttribArray(0);
+
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
+	glEnableVertexAttribArray(1);
+
+	glBindVertexArray(0);
+}
+
+__forceinline bool GTerrainCache::Update(GShader &FeedbackShader, FTerrainHandles &FeedbackHandles, const FTerrainUniforms &InUniforms)
+{
+	if (bValid && Uniforms == InUniforms)
+	{
+		return false;
+	}
+
+	Uniforms = InUniforms;
+
+	FeedbackShader.Use();
+	FeedbackShader.SetMat4(FeedbackHandles.Model, glm::mat4(1.f));
+	SetTerrainUniforms(FeedbackShader, FeedbackHandles, Uniforms);
+	FeedbackShader.Set1i(FeedbackHandles.GridSource, (int)ETerrainGridSource::Patches);
+
+	// Every patch vertex once, as points, without rasterizing anything
+	glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, VBO);
+	glEnable(GL_RASTERIZER_DISCARD);
+	glBeginTransformFeedback(GL_POINTS);
+	Patches->DrawPoints();
+	glEndTransformFeedback();
+	glDisable(GL_RASTERIZER_DISCARD);
+	glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+
+	bValid = true;
+	++Captures;
+	return true;
+}
+
+__forceinline void GTerrainCache::Invalidate()
+{
+	bValid = false;
+}
+
+__forceinline void GTerrainCache::Draw(const std::vector<int> &InPatches)
+{
+	DrawCounts.assign(InPatches.size(), Patches->GetPatchIndicesCount());
+	DrawOffsets.assign(InPatches.size(), (const void*)0);
+	DrawBaseVertices.clear();
+	for (int Patch : InPatches)
+	{
+		DrawBaseVertices.push_back(Patch * Patches->GetPatchVerticesCount());
+	}
+
+	if (!DrawCounts.empty())
+	{
+		glBindVertexArray(VAO);
+		glMultiDrawElementsBaseVertex(GL_TRIANGLES, DrawCounts.data(), GL_UNSIGNED_SHORT, DrawOffsets.data(), (GLsizei)DrawCounts.size(), DrawBaseVertices.data());
+	}
+}
+
+__forceinline void GTerrainCache::Delete()
+{
+	glDeleteVertexArrays(1, &VAO);
+	glDeleteBuffers(1, &VBO);
+}
@@ -0,0 +1,223 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "Shader.h"
+#include "Terrain.h"
+#include "Utils.h"
+
+// Range of the shared index buffer
+struct FIndexRange
+{
+	int First;
+	int Count;
+};
+
+// Geometry clipmap: nested square rings around the camera, each level with cells twice as big as the previous one.
+// Every level draws the same ring of the shared index buffer, so the vertex count per frame is fixed however far
+// the camera flies. Level origins are snapped to even cells so the vertices don't swim, and Terrain.vert morphs
+// the border of each level into the next one so there are no cracks between levels.
+class GTerrainClipmap
+{
+public:
+	// Each level covers 4 * BlockSize + 2 cells per side, its hole 2 * BlockSize + 2 cells of the next level
+	GTerrainClipmap(int BlockSize, float CellSize, int Levels);
+
+	// Moves the levels with the camera. Finest levels are skipped while the camera is higher above the terrain than they are wide.
+	void Update(glm::vec3 ViewPosition, float Height);
+	// Draws the levels, the shader has to be in use with the rest of the terrain uniforms set
+	void Draw(const GShader &Shader, const FTerrainHandles &Handles) const;
+
+	// Distance up to which the terrain is drawn
+	float GetViewDistance() const;
+
+	void Delete();
+
+public:
+	// World size of the cells of the finest level, powers of two keep the borders of neighbour levels exactly aligned
+	float CellSize;
+	int Levels;
+	// Cells before the border of a level where the morph into the next level starts, below BlockSize so the hole is never morphed
+	int TransitionWidth;
+
+	int LevelsDrawn;
+	int TrianglesCount;
+
+private:
+	void AddCells(std::vector<int> &Indices, int FirstX, int FirstY, int LastX, int LastY, int SkipX = -1) const;
+
+	unsigned int VAO, VBO, EBO;
+	int BlockSize;
+	// Cells per side of a level
+	int Size;
+
+	FIndexRange Full;
+	FIndexRange Ring;
+	// Interior trims, indexed by the cell offset of the finer level inside the hole: x + 2 * y
+	FIndexRange Trims[4];
+
+	int FirstLevel;
+	std::vector<glm::vec2> Origins;
+	std::vector<int> TrimOffsets;
+};
+
+__forceinline GTerrainClipmap::GTerrainClipmap(int InBlockSize, float InCellSize, int InLevels) : CellSize(InCellSize), Levels(InLevels), TransitionWidth(InBlockSize / 2), LevelsDrawn(0), TrianglesCount(0), BlockSize(InBlockSize), Size(4 * InBlockSize + 2), FirstLevel(0)
+{
+	// Vertices in cells, the draws scale them by the cell size of each level
+	std::vector<float> Vertices;
+	Vertices.reserve(2 * (Size + 1) * (Size + 1));
+	for (int y = 0; y <= Size; ++y)
+	{
+		for (int x = 0; x <= Size; ++x)
+		{
+			Vertices.push_back((float)x);
+			Vertices.push_back((float)y);
+		}
+	}
+
+	// Whole level, for the finest level drawn
+	std::vector<int> Indices;
+	Full.First = 0;
+	AddCells(Indices, 0, 0, Size, Size);
+	Full.Count = (int)Indices.size();
+
+	// Everything but the hole where the finer level goes
+	int HoleFirst = BlockSize;
+	int HoleLast = 3 * BlockSize + 2;
+	Ring.First = (int)Indices.size();
+	AddCells(Indices, 0, 0, Size, HoleFirst);
+	AddCells(Indices, 0, HoleLast, Size, Size);
+	AddCells(Indices, 0, HoleFirst, HoleFirst, HoleLast);
+	AddCells(Indices, HoleLast, HoleFirst, Size, HoleLast);
+	Ring.Count = (int)Indices.size() - Ring.First;
+
+	// The finer level covers 2 * BlockSize + 1 cells of the hole, the one cell wide L left goes on the other side
+	for (int Offset = 0; Offset < 4; ++Offset)
+	{
+		int Column = Offset % 2 ? HoleFirst : HoleLast - 1;
+		int Row = Offset / 2 ? HoleFirst : HoleLast - 1;
+		Trims[Offset].First = (int)Indices.size();
+		AddCells(Indices, Column, HoleFirst, Column + 1, HoleLast);
+		AddCells(Indices, HoleFirst, Row, HoleLast, Row + 1, Column);
+		Trims[Offset].Count = (int)Indices.size() - Trims[Offset].First;
+	}
+
+	// Each range is drawn on its own, so each one is reordered on its own
+	for (const FIndexRange &Range : { Full, Ring, Trims[0], Trims[1], Trims[2], Trims[3] })
+	{
+		OptimizeVertexCache(Indices.data() + Range.First, Range.Count, (int)Vertices.size() / 2);
+	}
+
+	glGenVertexArrays(1, &VAO);
+	glGenBuffers(1, &VBO);
+	glGenBuffers(1, &EBO);
+
+	glBindVertexArray(VAO);
+
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	glBufferData(GL_ARRAY_BUFFER, Vertices.size() * sizeof(float), Vertices.data(), GL_STATIC_DRAW);
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, Indices.size() * sizeof(int), Indices.data(), GL_STATIC_DRAW);
+
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+	glEnableVertexAttribArray(0);
+
+	glBindVertexArray(0);
+}
+
+__forceinline void GTerrainClipmap::Update(glm::vec3 ViewPosition, float Height)
+{
+	Origins.resize(Levels);
+	TrimOffsets.resize(Levels);
+
+	// Finest level centered on the camera, its origin on even cells so its border matches the cells of the next level
+	float Cell = CellSize;
+	glm::vec2 Center = glm::floor(glm::vec2(ViewPosition.x, ViewPosition.z) / (2.f * Cell)) * (2.f * Cell);
+	Origins[0] = Center - (float)(2 * BlockSize) * Cell;
+	TrimOffsets[0] = 0;
+
+	// Each level puts the previous one at cell BlockSize or BlockSize + 1 of its hole, whichever keeps its own origin on even cells
+	for (int Level = 1; Level < Levels; ++Level)
+	{
+		Cell *= 2.f;
+		glm::vec2 Cells = glm::floor(Origins[Level - 1] / Cell + 0.5f) - (float)BlockSize;
+		int OffsetX = ((int)Cells.x % 2 + 2) % 2;
+		int OffsetY = ((int)Cells.y % 2 + 2) % 2;
+		Origins[Level] = (Cells - glm::vec2((float)OffsetX, (float)OffsetY)) * Cell;
+		TrimOffsets[Level] = OffsetX + 2 * OffsetY;
+	}
+
+	// Levels much smaller than the camera height would only draw subpixel triangles
+	float HeightAboveTerrain = glm::abs(ViewPosition.y - GetTerrainHeightBounds(Height).y);
+	FirstLevel = 0;
+	while (FirstLevel < Levels - 1 && Size * CellSize * (float)(1 << FirstLevel) < HeightAboveTerrain)
+	{
+		++FirstLevel;
+	}
+
+	LevelsDrawn = Levels - FirstLevel;
+	TrianglesCount = (Full.Count + (LevelsDrawn - 1) * (Ring.Count + Trims[0].Count)) / 3;
+}
+
+__forceinline void GTerrainClipmap::Draw(const GShader &Shader, const FTerrainHandles &Handles) const
+{
+	glBindVertexArray(VAO);
+	Shader.Set1i(Handles.GridMode, (int)ETerrainGeometry::Clipmap);
+	Shader.Set2f(Handles.Morph, (float)(2 * BlockSize + 1 - TransitionWidth), (float)(2 * BlockSize + 1));
+	float Cell = CellSize * (float)(1 << FirstLevel);
+	for (int Level = FirstLevel; Level < Levels; ++Level)
+	{
+		Shader.Set4f(Handles.Patch, Origins[Level].x, Origins[Level].y, Cell, (float)(2 * BlockSize + 1));
+		if (Level == FirstLevel)
+		{
+			glDrawElements(GL_TRIANGLES, Full.Count, GL_UNSIGNED_INT, (void*)(Full.First * sizeof(int)));
+		}
+		else
+		{
+			const FIndexRange &Trim = Trims[TrimOffsets[Level]];
+			glDrawElements(GL_TRIANGLES, Ring.Count, GL_UNSIGNED_INT, (void*)(Ring.First * sizeof(int)));
+			glDrawElements(GL_TRIANGLES, Trim.Count, GL_UNSIGNED_INT, (void*)(Trim.First * sizeof(int)));
+		}
+		Cell *= 2.f;
+	}
+	Shader.Set1i(Handles.GridMode, (int)ETerrainGeometry::Grid);
+}
+
+__forceinline float GTerrainClipmap::GetViewDistance() const
+{
+	// Half the diagonal of the coarsest level, plus the offset of the camera inside it
+	return 1.41421356f * (Size / 2 + 2) * CellSize * (float)(1 << (Levels - 1));
+}
+
+__forceinline void GTerrainClipmap::Delete()
+{
+	glDeleteVertexArrays(1, &VAO);
+	glDeleteBuffers(1, &VBO);
+	glDeleteBuffers(1, &EBO);
+}
+
+__forceinline void GTerrainClipmap::AddCells(std::vector<int> &Indices, int FirstX, int FirstY, int LastX, int LastY, int SkipX) const
+{
+	int Stride = Size + 1;
+	for (int y = FirstY; y < LastY; ++y)
+	{
+		for (int x = FirstX; x < LastX; ++x)
+		{
+			if (x == SkipX)
+			{
+				continue;
+			}
+			int Corner = y * Stride + x;
+			Indices.push_back(Corner);
+			Indices.push_back(Corner + Stride);
+			Indices.push_back(Corner + 1);
+			Indices.push_back(Corner + 1);
+			Indices.push_back(Corner + Stride);
+			Indices.push_back(Corner + Stride + 1);
+		}
+	}
+}
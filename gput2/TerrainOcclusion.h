@@ -0,0 +1,248 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <thread>
+#include <vector>
+
+#include "HeightPyramid.h"
+#include "Terrain.h"
+#include "TerrainTiles.h"
+
+// Horizon occlusion of the grid tiles left by the frustum culling. A tile is hidden when, seen from the camera, every
+// direction towards it crosses a closer part of the terrain that rises above the highest sight line to the tile.
+// The occluders come from the min-max pyramid, walked top down so the whole terrain is never visited cell by cell.
+// Tiles are split between worker threads started after the frustum culling and joined right before the draw.
+class GTerrainOcclusion
+{
+public:
+	GTerrainOcclusion();
+
+	// Starts testing the visible tiles, does nothing unless the pyramid is valid for the procedural heights
+	void Start(const GTerrainTiles &Tiles, const GHeightPyramid &Pyramid, glm::vec3 ViewPosition, float NearPlane, const FTerrainUniforms &Uniforms);
+	// Waits for the tests and drops the hidden tiles
+	void Finish(GTerrainTiles &Tiles);
+
+public:
+	// Coarsest pyramid level whose cells are still split while looking for occluders
+	int OccluderLevel;
+
+private:
+	bool IsHidden(int Tile) const;
+
+	// Horizontal distances from the camera to the closest and farthest points of a box
+	glm::vec2 GetDistances(glm::vec2 Min, glm::vec2 Max) const;
+	// Directions from the camera covering a box, as angles from Reference
+	glm::vec2 GetAngles(glm::vec2 Min, glm::vec2 Max, float Reference) const;
+	// World box and heights of a tile or pyramid cell
+	void GetWorldBox(glm::vec4 Region, glm::vec2 Bounds, glm::vec2 &Min, glm::vec2 &Max, glm::vec2 &Heights) const;
+
+	std::vector<std::thread> Workers;
+	std::vector<char> Hidden;
+
+	const GTerrainTiles* Tiles;
+	const GHeightPyramid* Pyramid;
+	glm::vec3 ViewPosition;
+	float NearPlane;
+	float Width;
+	float Height;
+};
+
+__forceinline GTerrainOcclusion::GTerrainOcclusion() : OccluderLevel(2), Tiles(nullptr), Pyramid(nullptr), ViewPosition(0.f), NearPlane(0.f), Width(0.f), Height(0.f)
+{
+}
+
+__forceinline void GTerrainOcclusion::Start(const GTerrainTiles &InTiles, const GHeightPyramid &InPyramid, glm::vec3 InViewPosition, float InNearPlane, const FTerrainUniforms &Uniforms)
+{
+	if (Uniforms.Heights != ETerrainHeights::Procedural || !InPyramid.IsValid(Uniforms.Time) || Uniforms.Width == 0.f)
+	{
+		return;
+	}
+
+	Tiles = &InTiles;
+	Pyramid = &InPyramid;
+	ViewPosition = InViewPosition;
+	NearPlane = InNearPlane;
+	Width = Uniforms.Width;
+	Height = Uniforms.Height;
+
+	// Under the terrain every sight line goes through it
+	int Cells = InPyramid.GetLevelSize(0);
+	float Separation = InPyramid.GetCellRegion(0, 0, 0).z - InPyramid.GetCellRegion(0, 0, 0).x;
+	glm::vec4 Grid = InPyramid.GetCellRegion(InPyramid.GetLevelsCount() - 1, 0, 0);
+	int j = (int)glm::floor((ViewPosition.x / Width - Grid.x) / Separation);
+	int i = (int)glm::floor((Grid.w - ViewPosition.z / Width) / Separation);
+	if (i >= 0 && i < Cells && j >= 0 && j < Cells)
+	{
+		glm::vec2 Min, Max, Heights;
+		GetWorldBox(InPyramid.GetCellRegion(0, i, j), InPyramid.GetCellBounds(0, i, j), Min, Max, Heights);
+		if (ViewPosition.y <= Heights.y)
+		{
+			return;
+		}
+	}
+
+	Hidden.assign(InTiles.GetTilesCount(), 0);
+	int WorkersCount = glm::max(1, (int)std::thread::hardware_concurrency() - 1);
+	for (int Worker = 0; Worker < WorkersCount; ++Worker)
+	{
+		Workers.emplace_back([this, Worker, WorkersCount]()
+		{
+			const std::vector<int> &Visible = Tiles->GetVisibleTiles();
+			for (size_t i = Worker; i < Visible.size(); i += WorkersCount)
+			{
+				Hidden[Visible[i]] = IsHidden(Visible[i]);
+			}
+		});
+	}
+}
+
+__forceinline void GTerrainOcclusion::Finish(GTerrainTiles &InTiles)
+{
+	if (Workers.empty())
+	{
+		return;
+	}
+	for (std::thread &Worker : Workers)
+	{
+		Worker.join();
+	}
+	Workers.clear();
+	InTiles.Occlude(Hidden);
+}
+
+__forceinline bool GTerrainOcclusion::IsHidden(int Tile) const
+{
+	glm::vec4 Region = Tiles->GetRegion(Tile);
+	glm::vec2 TileMin, TileMax, TileHeights;
+	GetWorldBox(Region, Pyramid->GetBounds(glm::vec2(Region.x, Region.y), glm::vec2(Region.z, Region.w)), TileMin, TileMax, TileHeights);
+	glm::vec2 TileDistances = GetDistances(TileMin, TileMax);
+	if (TileDistances.x <= 0.f)
+	{
+		return false;
+	}
+
+	// Steepest sight line from the camera to any point of the tile
+	float TileRise = TileHeights.y - ViewPosition.y;
+	float TileSlope = TileRise / (TileRise > 0.f ? TileDistances.x : TileDistances.y);
+
+	// Directions to the tile, split in bins which have to be covered each by a single occluder
+	glm::vec2 Center = (TileMin + TileMax) / 2.f;
+	float Reference = glm::atan(Center.y - ViewPosition.z, Center.x - ViewPosition.x);
+	glm::vec2 TileAngles = GetAngles(TileMin, TileMax, Reference);
+	const int BinsCount = 32;
+	float BinWidth = (TileAngles.y - TileAngles.x) / BinsCount;
+	bool bCovered[BinsCount] = {};
+	int CoveredCount = 0;
+
+	std::vector<glm::ivec3> Stack;
+	int Top = Pyramid->GetLevelsCount() - 1;
+	Stack.push_back(glm::ivec3(Top, 0, 0));
+	while (!Stack.empty())
+	{
+		glm::ivec3 Cell = Stack.back();
+		Stack.pop_back();
+
+		glm::vec2 Min, Max, Heights;
+		GetWorldBox(Pyramid->GetCellRegion(Cell.x, Cell.y, Cell.z), Pyramid->GetCellBounds(Cell.x, Cell.y, Cell.z), Min, Max, Heights);
+		glm::vec2 Distances = GetDistances(Min, Max);
+		if (Distances.x >= TileDistances.x || Distances.y <= NearPlane)
+		{
+			continue;
+		}
+
+		bool bAroundCamera = Distances.x <= 0.f;
+		if (!bAroundCamera)
+		{
+			// Nothing in the cell rises above the sight lines to the tile
+			float Rise = Heights.y - ViewPosition.y;
+			if (Rise / (Rise > 0.f ? Distances.x : Distances.y) <= TileSlope)
+			{
+				continue;
+			}
+
+			glm::vec2 Angles = GetAngles(Min, Max, Reference);
+			if (Angles.y <= TileAngles.x || Angles.x >= TileAngles.y)
+			{
+				continue;
+			}
+
+			// Whole cell in front of the tile and past the near plane, its lowest point blocks the sight lines
+			float LowRise = Heights.x - ViewPosition.y;
+			if (Distances.y <= TileDistances.x && Distances.x >= NearPlane && LowRise / (LowRise > 0.f ? Distances.y : Distances.x) > TileSlope)
+			{
+				int FirstBin = (int)glm::ceil((Angles.x - TileAngles.x) / BinWidth);
+				int LastBin = (int)glm::floor((Angles.y - TileAngles.x) / BinWidth);
+				for (int Bin = glm::max(FirstBin, 0); Bin < glm::min(LastBin, BinsCount); ++Bin)
+				{
+					if (!bCovered[Bin])
+					{
+						bCovered[Bin] = true;
+						if (++CoveredCount == BinsCount)
+						{
+							return true;
+						}
+					}
+				}
+				continue;
+			}
+		}
+
+		if (Cell.x > OccluderLevel)
+		{
+			int ChildrenSize = Pyramid->GetLevelSize(Cell.x - 1);
+			for (int Child = 0; Child < 4; ++Child)
+			{
+				int i = 2 * Cell.y + Child / 2;
+				int j = 2 * Cell.z + Child % 2;
+				if (i < ChildrenSize && j < ChildrenSize)
+				{
+					Stack.push_back(glm::ivec3(Cell.x - 1, i, j));
+				}
+			}
+		}
+	}
+	return false;
+}
+
+__forceinline glm::vec2 GTerrainOcclusion::GetDistances(glm::vec2 Min, glm::vec2 Max) const
+{
+	glm::vec2 View(ViewPosition.x, ViewPosition.z);
+	glm::vec2 Closest = glm::clamp(View, Min, Max);
+	glm::vec2 Farthest(View.x - Min.x > Max.x - View.x ? Min.x : Max.x, View.y - Min.y > Max.y - View.y ? Min.y : Max.y);
+	return glm::vec2(glm::length(Closest - View), glm::length(Farthest - View));
+}
+
+__forceinline glm::vec2 GTerrainOcclusion::GetAngles(glm::vec2 Min, glm::vec2 Max, float Reference) const
+{
+	const float Pi = 3.14159265f;
+
+	// Around the direction to the center first, a box not holding the camera spans less than half a turn from it
+	glm::vec2 View(ViewPosition.x, ViewPosition.z);
+	glm::vec2 Center = (Min + Max) / 2.f - View;
+	float CenterAngle = glm::atan(Center.y, Center.x);
+	glm::vec2 Angles(0.f);
+	for (int Corner = 0; Corner < 4; ++Corner)
+	{
+		glm::vec2 Offset = glm::vec2(Corner % 2 ? Max.x : Min.x, Corner / 2 ? Max.y : Min.y) - View;
+		float Angle = glm::atan(Offset.y, Offset.x) - CenterAngle;
+		Angle -= 2.f * Pi * glm::floor((Angle + Pi) / (2.f * Pi));
+		Angles.x = glm::min(Angles.x, Angle);
+		Angles.y = glm::max(Angles.y, Angle);
+	}
+
+	float Shift = CenterAngle - Reference;
+	Shift -= 2.f * Pi * glm::floor((Shift + Pi) / (2.f * Pi));
+	return Angles + Shift;
+}
+
+__forceinline void GTerrainOcclusion::GetWorldBox(glm::vec4 Region, glm::vec2 Bounds, glm::vec2 &Min, glm::vec2 &Max, glm::vec2 &Heights) const
+{
+	// Negative widths and heights mirror the terrain
+	glm::vec2 Corner0 = Width * glm::vec2(Region.x, Region.y);
+	glm::vec2 Corner1 = Width * glm::vec2(Region.z, Region.w);
+	Min = glm::min(Corner0, Corner1);
+	Max = glm::max(Corner0, Corner1);
+	glm::vec2 Scaled = (Bounds + 1.f) * (Height / 2.f);
+	Heights = glm::vec2(glm::min(Scaled.x, Scaled.y), glm::max(Scaled.x, Scaled.y));
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "Utils.h"
+
+// The grid as square patches of one shared template, PatchQuads cells per side with 16-bit indices, drawn instanced.
+// Each instance reads the first cell of its patch and the patch size in cells from VPatch, so the grid costs a few
+// kilobytes of template plus one vec3 per drawn patch. Patches are numbered like the tiles of GTerrainTiles with
+// TileCells = PatchQuads, row by row.
+class GTerrainPatches
+{
+public:
+	// (PatchQuads + 1)^2 vertices have to fit 16-bit indices
+	GTerrainPatches(int PatchQuads, int PatchesPerSide);
+
+	// Draws the given patches, the terrain shader has to be in use with the patches grid source
+	void Draw(const std::vector<int> &Patches);
+	// Every template vertex of every patch once as a point, patch after patch, for transform feedback
+	void DrawPoints();
+
+	int GetPatchesCount() const;
+	int GetPatchVerticesCount() const;
+	int GetPatchIndicesCount() const;
+
+	void Delete();
+
+public:
+	unsigned int VAO;
+	unsigned int EBO;
+
+private:
+	void UploadInstances(const std::vector<int> &Patches);
+
+	unsigned int VBO, InstanceVBO;
+	int PatchQuads;
+	int PatchesPerSide;
+	int PatchVerticesCount;
+	int PatchIndicesCount;
+
+	std::vector<glm::vec3> Instances;
+	// Patches in InstanceVBO, skips the upload while they don't change
+	std::vector<int> Uploaded;
+};
+
+__forceinline GTerrainPatches::GTerrainPatches(int InPatchQuads, int InPatchesPerSide) : PatchQuads(InPatchQuads), PatchesPerSide(InPatchesPerSide)
+{
+	float* Patch;
+	int* PatchIndices;
+	int PatchSize;
+	GeneratePatch(Patch, PatchIndices, PatchQuads, PatchSize, PatchIndicesCount);
+	PatchVerticesCount = PatchSize / 2;
+	OptimizeVertexCache(PatchIndices, PatchIndicesCount, PatchVerticesCount);
+
+	std::vector<unsigned short> ShortIndices(PatchIndices, PatchIndices + PatchIndicesCount);
+
+	glGenVertexArrays(1, &VAO);
+	glGenBuffers(1, &VBO);
+	glGenBuffers(1, &EBO);
+	glGenBuffers(1, &InstanceVBO);
+
+	glBindVertexArray(VAO);
+
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	glBufferData(GL_ARRAY_BUFFER, PatchSize * sizeof(float), Patch, GL_STATIC_DRAW);
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, ShortIndices.size() * sizeof(unsigned short), ShortIndices.data(), GL_STATIC_DRAW);
+
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+	glEnableVertexAttribArray(0);
+
+	glBindBuffer(GL_ARRAY_BUFFER, InstanceVBO);
+	glBufferData(GL_ARRAY_BUFFER, GetPatchesCount() * sizeof(glm::vec3), NULL, GL_DYNAMIC_DRAW);
+
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+	glEnableVertexAttribArray(1);
+	glVertexAttribDivisor(1, 1);
+
+	glBindVertexArray(0);
+
+	delete[] Patch;
+	delete[] PatchIndices;
+}
+
+__forceinline void GTerrainPatches::Draw(const std::vector<int> &Patches)
+{
+	if (Patches.empty())
+	{
+		return;
+	}
+	UploadInstances(Patches);
+	glBindVertexArray(VAO);
+	glDrawElementsInstanced(GL_TRIANGLES, PatchIndicesCount, GL_UNSIGNED_SHORT, 0, (GLsizei)Patches.size());
+}
+
+__forceinline void GTerrainPatches::DrawPoints()
+{
+	std::vector<int> Patches(GetPatchesCount());
+	for (int Patch = 0; Patch < GetPatchesCount(); ++Patch)
+	{
+		Patches[Patch] = Patch;
+	}
+	UploadInstances(Patches);
+	glBindVertexArray(VAO);
+	glDrawArraysInstanced(GL_POINTS, 0, PatchVerticesCount, GetPatchesCount());
+}
+
+__forceinline int GTerrainPatches::GetPatchesCount() const
+{
+	return PatchesPerSide * PatchesPerSide;
+}
+
+__forceinline int GTerrainPatches::GetPatchVerticesCount() const
+{
+	return PatchVerticesCount;
+}
+
+__forceinline int GTerrainPatches::GetPatchIndicesCount() const
+{
+	return PatchIndicesCount;
+}
+
+__forceinline void GTerrainPatches::Delete()
+{
+	glDeleteVertexArrays(1, &VAO);
+	glDeleteBuffers(1, &VBO);
+	glDeleteBuffers(1, &EBO);
+	glDeleteBuffers(1, &InstanceVBO);
+}
+
+__forceinline void GTerrainPatches::UploadInstances(const std::vector<int> &Patches)
+{
+	if (Patches == Uploaded)
+	{
+		return;
+	}
+	Uploaded = Patches;
+
+	Instances.clear();
+	for (int Patch : Patches)
+	{
+		Instances.push_back(glm::vec3((float)(Patch % PatchesPerSide * PatchQuads), (float)(Patch / PatchesPerSide * PatchQuads), (float)PatchQuads));
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, InstanceVBO);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, Instances.size() * sizeof(glm::vec3), Instances.data());
+}
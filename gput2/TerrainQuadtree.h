@@ -0,0 +1,229 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "Shader.h"
+#include "Terrain.h"
+#include "Utils.h"
+
+// Node picked by the selection, drawn with the patch scaled to its size
+struct FTerrainNode
+{
+	glm::vec2 Corner;
+	float Size;
+	int Level;
+	// One bit per quadrant to draw, the other quadrants are covered by finer nodes
+	int Quadrants;
+};
+
+// Continuous distance-dependent LOD (CDLOD) over a quadtree of square nodes centered on the origin.
+// Every node draws the same patch, the level is picked from the camera distance so the screen-space error
+// stays under ErrorThreshold, and Terrain.vert morphs each level into the next one before the switch,
+// so there are neither popping nor cracks between levels. Sizes and distances are in world units.
+class GTerrainQuadtree
+{
+public:
+	// PatchQuads cells per patch side, has to be even
+	GTerrainQuadtree(int PatchQuads, float LeafSize, int Levels);
+
+	// Selects the nodes to draw from the camera, FieldOfView in degrees and ViewportHeight in pixels
+	void Select(glm::vec3 ViewPosition, float FieldOfView, int ViewportHeight, float Height);
+	// Draws the selected nodes, the shader has to be in use with the rest of the terrain uniforms set
+	void Draw(const GShader &Shader, const FTerrainHandles &Handles) const;
+
+	// Distance up to which the terrain is drawn
+	float GetViewDistance() const;
+	float GetRootSize() const;
+
+	void Delete();
+
+public:
+	float LeafSize;
+	int Levels;
+	// Largest allowed screen-space error, in pixels
+	float ErrorThreshold;
+	// Fraction of each level range drawn before the morph into the next level starts
+	float MorphStartRatio;
+
+	int NodesCount;
+	int TrianglesCount;
+
+private:
+	bool SelectNode(glm::vec2 Corner, float Size, int Level);
+	bool IntersectsSphere(glm::vec2 Corner, float Size, float Radius) const;
+
+	unsigned int VAO, VBO, EBO;
+	int PatchQuads;
+	int PatchIndicesSize;
+
+	// Per level, farthest distance the level is drawn at and distance where its morph starts
+	std::vector<float> Ranges;
+	std::vector<float> MorphStarts;
+	std::vector<FTerrainNode> Nodes;
+
+	glm::vec3 ViewPosition;
+	glm::vec2 HeightBounds;
+};
+
+__forceinline GTerrainQuadtree::GTerrainQuadtree(int InPatchQuads, float InLeafSize, int InLevels) : LeafSize(InLeafSize), Levels(InLevels), ErrorThreshold(12.f), MorphStartRatio(0.7f), NodesCount(0), TrianglesCount(0), PatchQuads(InPatchQuads)
+{
+	float* Patch;
+	int* PatchIndices;
+	int PatchSize;
+	GeneratePatch(Patch, PatchIndices, PatchQuads, PatchSize, PatchIndicesSize);
+	for (int Quadrant = 0; Quadrant < 4; ++Quadrant)
+	{
+		OptimizeVertexCache(PatchIndices + Quadrant * PatchIndicesSize / 4, PatchIndicesSize / 4, PatchSize / 2);
+	}
+
+	glGenVertexArrays(1, &VAO);
+	glGenBuffers(1, &VBO);
+	glGenBuffers(1, &EBO);
+
+	glBindVertexArray(VAO);
+
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	glBufferData(GL_ARRAY_BUFFER, PatchSize * sizeof(float), Patch, GL_STATIC_DRAW);
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, PatchIndicesSize * sizeof(int), PatchIndices, GL_STATIC_DRAW);
+
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+	glEnableVertexAttribArray(0);
+
+	glBindVertexArray(0);
+
+	delete[] Patch;
+	delete[] PatchIndices;
+}
+
+__forceinline void GTerrainQuadtree::Select(glm::vec3 InViewPosition, float FieldOfView, int ViewportHeight, float Height)
+{
+	ViewPosition = InViewPosition;
+	HeightBounds = GetTerrainHeightBounds(Height);
+
+	// A cell of size S seen from distance D covers S * PixelsPerUnit / D pixels. A level is drawn up to the distance
+	// where the next one, with cells twice as big, gets under the threshold. The ranges also have to be at least
+	// twice the node diagonal, so neighbour nodes never differ by more than one level.
+	float PixelsPerUnit = ViewportHeight / (2.f * glm::tan(glm::radians(FieldOfView) / 2.f));
+	Ranges.resize(Levels);
+	MorphStarts.resize(Levels);
+	for (int Level = 0; Level < Levels; ++Level)
+	{
+		float Size = LeafSize * (float)(1 << Level);
+		float Range = 2.f * Size / PatchQuads * PixelsPerUnit / ErrorThreshold;
+		Range = glm::max(Range, 2.f * 1.41421356f * Size);
+		float Previous = Level > 0 ? Ranges[Level - 1] : 0.f;
+		Ranges[Level] = glm::max(Range, 2.f * Previous);
+		MorphStarts[Level] = Previous + (Ranges[Level] - Previous) * MorphStartRatio;
+	}
+
+	Nodes.clear();
+	float RootSize = GetRootSize();
+	if (!SelectNode(glm::vec2(-RootSize / 2.f), RootSize, Levels - 1))
+	{
+		// Camera beyond the coarsest range, the whole terrain is still drawn
+		Nodes.push_back({ glm::vec2(-RootSize / 2.f), RootSize, Levels - 1, 0xF });
+	}
+
+	NodesCount = (int)Nodes.size();
+	TrianglesCount = 0;
+	for (const FTerrainNode &Node : Nodes)
+	{
+		for (int Quadrant = 0; Quadrant < 4; ++Quadrant)
+		{
+			if (Node.Quadrants & (1 << Quadrant))
+			{
+				TrianglesCount += PatchIndicesSize / 12;
+			}
+		}
+	}
+}
+
+__forceinline void GTerrainQuadtree::Draw(const GShader &Shader, const FTerrainHandles &Handles) const
+{
+	glBindVertexArray(VAO);
+	Shader.Set1i(Handles.GridMode, (int)ETerrainGeometry::Quadtree);
+	for (const FTerrainNode &Node : Nodes)
+	{
+		Shader.Set4f(Handles.Patch, Node.Corner.x, Node.Corner.y, Node.Size, (float)PatchQuads);
+		Shader.Set2f(Handles.Morph, MorphStarts[Node.Level], Ranges[Node.Level]);
+		if (Node.Quadrants == 0xF)
+		{
+			glDrawElements(GL_TRIANGLES, PatchIndicesSize, GL_UNSIGNED_INT, 0);
+			continue;
+		}
+		int QuadrantIndicesSize = PatchIndicesSize / 4;
+		for (int Quadrant = 0; Quadrant < 4; ++Quadrant)
+		{
+			if (Node.Quadrants & (1 << Quadrant))
+			{
+				glDrawElements(GL_TRIANGLES, QuadrantIndicesSize, GL_UNSIGNED_INT, (void*)(Quadrant * QuadrantIndicesSize * sizeof(int)));
+			}
+		}
+	}
+	Shader.Set1i(Handles.GridMode, (int)ETerrainGeometry::Grid);
+}
+
+__forceinline float GTerrainQuadtree::GetViewDistance() const
+{
+	// Farther than the root diagonal there is nothing to draw
+	float RootReach = 1.41421356f * GetRootSize() + glm::length(glm::vec2(ViewPosition.x, ViewPosition.z));
+	return Ranges.empty() ? RootReach : glm::min(Ranges.back(), RootReach);
+}
+
+__forceinline float GTerrainQuadtree::GetRootSize() const
+{
+	return LeafSize * (float)(1 << (Levels - 1));
+}
+
+__forceinline void GTerrainQuadtree::Delete()
+{
+	glDeleteVertexArrays(1, &VAO);
+	glDeleteBuffers(1, &VBO);
+	glDeleteBuffers(1, &EBO);
+}
+
+inline bool GTerrainQuadtree::SelectNode(glm::vec2 Corner, float Size, int Level)
+{
+	// Out of the range of its level, the parent covers it
+	if (!IntersectsSphere(Corner, Size, Ranges[Level]))
+	{
+		return false;
+	}
+
+	if (Level == 0 || !IntersectsSphere(Corner, Size, Ranges[Level - 1]))
+	{
+		Nodes.push_back({ Corner, Size, Level, 0xF });
+		return true;
+	}
+
+	// Quadrants follow GeneratePatch, x halves first
+	int Quadrants = 0;
+	float Half = Size / 2.f;
+	for (int Quadrant = 0; Quadrant < 4; ++Quadrant)
+	{
+		glm::vec2 ChildCorner = Corner + Half * glm::vec2((float)(Quadrant % 2), (float)(Quadrant / 2));
+		if (!SelectNode(ChildCorner, Half, Level - 1))
+		{
+			Quadrants |= 1 << Quadrant;
+		}
+	}
+	if (Quadrants)
+	{
+		Nodes.push_back({ Corner, Size, Level, Quadrants });
+	}
+	return true;
+}
+
+__forceinline bool GTerrainQuadtree::IntersectsSphere(glm::vec2 Corner, float Size, float Radius) const
+{
+	glm::vec3 Min(Corner.x, HeightBounds.x, Corner.y);
+	glm::vec3 Max(Corner.x + Size, HeightBounds.y, Corner.y + Size);
+	glm::vec3 Closest = glm::clamp(ViewPosition, Min, Max);
+	glm::vec3 Offset = ViewPosition - Closest;
+	return glm::dot(Offset, Offset) <= Radius * Radius;
+}
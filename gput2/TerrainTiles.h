@@ -0,0 +1,211 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "Frustum.h"
+#include "HeightMap.h"
+#include "Shader.h"
+#include "Terrain.h"
+
+// What the last culling kept and skipped
+struct FCullingStats
+{
+	int TilesDrawn;
+	int TilesCulled;
+	int TrianglesDrawn;
+	int TrianglesCulled;
+	// Part of the culled ones hidden behind the terrain
+	int TilesOccluded;
+	int TrianglesOccluded;
+};
+
+// Square tiles of the grid, each one with a conservative bounding box, so the tiles out of the view frustum are not submitted.
+class GTerrainTiles
+{
+public:
+	// Tiles of TileCells x TileCells cells over the grid of 2 * Vertices cells per side, row by row
+	GTerrainTiles(int Vertices, float SeparationFactor, int TileCells);
+
+	// Per tile fbm bounds of the last bake, used instead of the fbm amplitude while the heights are baked
+	void UpdateBakedBounds(const GHeightMap &HeightMap);
+	// Keeps the tiles whose box touches the frustum of ViewProjection
+	void Cull(const glm::mat4 &ViewProjection, const FTerrainUniforms &Uniforms);
+	// Keeps every tile
+	void KeepAll();
+	// The tiles whose box touches the frustum of ViewProjection in Tiles, the kept ones stay as they are
+	void Select(const glm::mat4 &ViewProjection, const FTerrainUniforms &Uniforms, std::vector<int> &Tiles) const;
+	// Box around every tile
+	void GetBounds(const FTerrainUniforms &Uniforms, glm::vec3 &Min, glm::vec3 &Max) const;
+	// Drops the kept tiles marked in Hidden, indexed by tile
+	void Occlude(const std::vector<char> &Hidden);
+	// Draws the kept tiles without grid buffers, the shader has to be in use with the strips grid source
+	void DrawStrips(const GShader &Shader, const FTerrainHandles &Handles) const;
+
+	const std::vector<int> &GetVisibleTiles() const;
+	// Grid coordinates of a tile, min in xy and max in zw
+	glm::vec4 GetRegion(int Tile) const;
+	int GetTilesCount() const;
+
+public:
+	FCullingStats Stats;
+
+private:
+	void GetTileBox(int Tile, const FTerrainUniforms &Uniforms, glm::vec3 &Min, glm::vec3 &Max) const;
+
+	std::vector<glm::vec4> Regions;
+	// First column and row, columns and rows of cells
+	std::vector<glm::ivec4> CellRanges;
+	std::vector<glm::vec2> BakedBounds;
+	std::vector<int> Triangles;
+
+	std::vector<int> Visible;
+};
+
+__forceinline GTerrainTiles::GTerrainTiles(int Vertices, float SeparationFactor, int TileCells)
+{
+	// Same layout as GenerateGrid: vertex (i, j) at SeparationFactor * (j - Vertices, Vertices - i)
+	int Cells = 2 * Vertices;
+	for (int TileI = 0; TileI < Cells; TileI += TileCells)
+	{
+		for (int TileJ = 0; TileJ < Cells; TileJ += TileCells)
+		{
+			int LastI = glm::min(TileI + TileCells, Cells);
+			int LastJ = glm::min(TileJ + TileCells, Cells);
+			Regions.push_back(SeparationFactor * glm::vec4((float)(TileJ - Vertices), (float)(Vertices - LastI), (float)(LastJ - Vertices), (float)(Vertices - TileI)));
+			CellRanges.push_back(glm::ivec4(TileJ, TileI, LastJ - TileJ, LastI - TileI));
+
+			Triangles.push_back(2 * (LastI - TileI) * (LastJ - TileJ));
+		}
+	}
+	BakedBounds.resize(Regions.size(), glm::vec2(-1.f, 1.f));
+	KeepAll();
+}
+
+__forceinline void GTerrainTiles::UpdateBakedBounds(const GHeightMap &HeightMap)
+{
+	for (size_t i = 0; i < Regions.size(); ++i)
+	{
+		BakedBounds[i] = HeightMap.GetBounds(glm::vec2(Regions[i].x, Regions[i].y), glm::vec2(Regions[i].z, Regions[i].w));
+	}
+}
+
+__forceinline void GTerrainTiles::Cull(const glm::mat4 &ViewProjection, const FTerrainUniforms &Uniforms)
+{
+	FFrustum Frustum(ViewProjection);
+
+	Visible.clear();
+	Stats = { 0, 0, 0, 0, 0, 0 };
+	for (size_t i = 0; i < Regions.size(); ++i)
+	{
+		glm::vec3 Min, Max;
+		GetTileBox((int)i, Uniforms, Min, Max);
+		if (Frustum.IntersectsBox(Min, Max))
+		{
+			Visible.push_back((int)i);
+			++Stats.TilesDrawn;
+			Stats.TrianglesDrawn += Triangles[i];
+		}
+		else
+		{
+			++Stats.TilesCulled;
+			Stats.TrianglesCulled += Triangles[i];
+		}
+	}
+}
+
+__forceinline void GTerrainTiles::KeepAll()
+{
+	Visible.clear();
+	Stats = { 0, 0, 0, 0, 0, 0 };
+	for (size_t i = 0; i < Regions.size(); ++i)
+	{
+		Visible.push_back((int)i);
+		++Stats.TilesDrawn;
+		Stats.TrianglesDrawn += Triangles[i];
+	}
+}
+
+__forceinline void GTerrainTiles::Select(const glm::mat4 &ViewProjection, const FTerrainUniforms &Uniforms, std::vector<int> &Tiles) const
+{
+	FFrustum Frustum(ViewProjection);
+
+	Tiles.clear();
+	for (size_t i = 0; i < Regions.size(); ++i)
+	{
+		glm::vec3 Min, Max;
+		GetTileBox((int)i, Uniforms, Min, Max);
+		if (Frustum.IntersectsBox(Min, Max))
+		{
+			Tiles.push_back((int)i);
+		}
+	}
+}
+
+__forceinline void GTerrainTiles::GetBounds(const FTerrainUniforms &Uniforms, glm::vec3 &Min, glm::vec3 &Max) const
+{
+	GetTileBox(0, Uniforms, Min, Max);
+	for (size_t i = 1; i < Regions.size(); ++i)
+	{
+		glm::vec3 TileMin, TileMax;
+		GetTileBox((int)i, Uniforms, TileMin, TileMax);
+		Min = glm::min(Min, TileMin);
+		Max = glm::max(Max, TileMax);
+	}
+}
+
+__forceinline void GTerrainTiles::Occlude(const std::vector<char> &Hidden)
+{
+	std::vector<int> Kept;
+	for (int Tile : Visible)
+	{
+		if (!Hidden[Tile])
+		{
+			Kept.push_back(Tile);
+			continue;
+		}
+		--Stats.TilesDrawn;
+		++Stats.TilesCulled;
+		++Stats.TilesOccluded;
+		Stats.TrianglesDrawn -= Triangles[Tile];
+		Stats.TrianglesCulled += Triangles[Tile];
+		Stats.TrianglesOccluded += Triangles[Tile];
+	}
+	Visible.swap(Kept);
+}
+
+__forceinline void GTerrainTiles::DrawStrips(const GShader &Shader, const FTerrainHandles &Handles) const
+{
+	for (int Tile : Visible)
+	{
+		Shader.Set4f(Handles.Patch, (float)CellRanges[Tile].x, (float)CellRanges[Tile].y, 0.f, 0.f);
+		glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 2 * (CellRanges[Tile].z + 1), CellRanges[Tile].w);
+	}
+}
+
+__forceinline const std::vector<int> &GTerrainTiles::GetVisibleTiles() const
+{
+	return Visible;
+}
+
+__forceinline glm::vec4 GTerrainTiles::GetRegion(int Tile) const
+{
+	return Regions[Tile];
+}
+
+__forceinline int GTerrainTiles::GetTilesCount() const
+{
+	return (int)Regions.size();
+}
+
+__forceinline void GTerrainTiles::GetTileBox(int Tile, const FTerrainUniforms &Uniforms, glm::vec3 &Min, glm::vec3 &Max) const
+{
+	// Negative widths mirror the grid
+	glm::vec2 Corner0 = Uniforms.Width * glm::vec2(Regions[Tile].x, Regions[Tile].y);
+	glm::vec2 Corner1 = Uniforms.Width * glm::vec2(Regions[Tile].z, Regions[Tile].w);
+	glm::vec2 Heights = Uniforms.Heights == ETerrainHeights::Baked ? (BakedBounds[Tile] + 1.f) * (Uniforms.Height / 2.f) : GetTerrainHeightBounds(Uniforms.Height);
+	Min = glm::vec3(glm::min(Corner0.x, Corner1.x), glm::min(Heights.x, Heights.y), glm::min(Corner0.y, Corner1.y));
+	Max = glm::vec3(glm::max(Corner0.x, Corner1.x), glm::max(Heights.x, Heights.y), glm::max(Corner0.y, Corner1.y));
+}
@@ -0,0 +1,416 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#ifdef _WIN32
+// Keeps the min and max macros away from glm::max and std::min in the rest of the translation unit
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "stb_image.h"
+
+// Texels of a .gtex file, the block compressed ones need GL_EXT_texture_compression_s3tc
+enum class ETextureFileFormat : uint32_t
+{
+	R8,
+	RG8,
+	RGB8,
+	RGBA8,
+	// 4x4 blocks of 8 bytes, no alpha
+	BC1,
+	// 4x4 blocks of 16 bytes, alpha first
+	BC3
+};
+
+// .gtex: this header, one FTextureFileLevel per mip level, then the levels from the largest, each starting at a multiple
+// of 16 bytes. The levels are sent to GL as they are in the file, so it can be mapped and uploaded without decoding.
+struct FTextureFileHeader
+{
+	// "GTEX"
+	uint32_t Magic;
+	uint32_t Version;
+	ETextureFileFormat Format;
+	uint32_t Width;
+	uint32_t Height;
+	uint32_t LevelsCount;
+};
+
+struct FTextureFileLevel
+{
+	// From the start of the file
+	uint64_t Offset;
+	uint64_t Size;
+	uint32_t Width;
+	uint32_t Height;
+};
+
+const uint32_t TextureFileMagic = 0x58455447;
+const uint32_t TextureFileVersion = 1;
+
+// Read-only view of a whole file, the pages are only read from disk when touched
+class GMappedFile
+{
+public:
+	GMappedFile();
+
+	bool Open(const char* Path);
+	void Close();
+
+public:
+	const unsigned char* Data;
+	size_t Size;
+
+private:
+#ifdef _WIN32
+	HANDLE File;
+	HANDLE Mapping;
+#else
+	int File;
+#endif
+};
+
+__forceinline GMappedFile::GMappedFile() : Data(nullptr), Size(0)
+{
+#ifdef _WIN32
+	File = INVALID_HANDLE_VALUE;
+	Mapping = NULL;
+#else
+	File = -1;
+#endif
+}
+
+__forceinline bool GMappedFile::Open(const char* Path)
+{
+#ifdef _WIN32
+	File = CreateFileA(Path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	LARGE_INTEGER FileSize;
+	if (File == INVALID_HANDLE_VALUE || !GetFileSizeEx(File, &FileSize) || FileSize.QuadPart == 0)
+	{
+		Close();
+		return false;
+	}
+	Mapping = CreateFileMappingA(File, NULL, PAGE_READONLY, 0, 0, NULL);
+	Data = Mapping ? (const unsigned char*)MapViewOfFile(Mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	Size = (size_t)FileSize.QuadPart;
+#else
+	File = open(Path, O_RDONLY);
+	struct stat Stat;
+	if (File < 0 || fstat(File, &Stat) != 0 || Stat.st_size == 0)
+	{
+		Close();
+		return false;
+	}
+	void* View = mmap(NULL, (size_t)Stat.st_size, PROT_READ, MAP_PRIVATE, File, 0);
+	Data = View != MAP_FAILED ? (const unsigned char*)View : nullptr;
+	Size = (size_t)Stat.st_size;
+#endif
+	if (!Data)
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+
+__forceinline void GMappedFile::Close()
+{
+#ifdef _WIN32
+	if (Data)
+	{
+		UnmapViewOfFile(Data);
+	}
+	if (Mapping)
+	{
+		CloseHandle(Mapping);
+	}
+	if (File != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(File);
+	}
+	File = INVALID_HANDLE_VALUE;
+	Mapping = NULL;
+#else
+	if (Data)
+	{
+		munmap((void*)Data, Size);
+	}
+	if (File >= 0)
+	{
+		close(File);
+	}
+	File = -1;
+#endif
+	Data = nullptr;
+	Size = 0;
+}
+
+// Bytes of a level of Width x Height texels, rows packed without alignment
+uint64_t GetTextureFileLevelSize(ETextureFileFormat Format, uint32_t Width, uint32_t Height)
+{
+	if (Format == ETextureFileFormat::BC1 || Format == ETextureFileFormat::BC3)
+	{
+		return (uint64_t)((Width + 3) / 4) * ((Height + 3) / 4) * (Format == ETextureFileFormat::BC1 ? 8 : 16);
+	}
+	return (uint64_t)Width * Height * ((uint32_t)Format + 1);
+}
+
+// Header of a mapped .gtex, nullptr when it isn't one, its levels run past the end of the file or don't match the mip
+// chain of the format, since they are uploaded with sizes taken from the level table
+const FTextureFileHeader* GetTextureFileHeader(const GMappedFile &File)
+{
+	if (File.Size < sizeof(FTextureFileHeader))
+	{
+		return nullptr;
+	}
+	const FTextureFileHeader* Header = (const FTextureFileHeader*)File.Data;
+	if (Header->Magic != TextureFileMagic || Header->Version != TextureFileVersion || Header->LevelsCount == 0 || Header->LevelsCount > 32 ||
+		(uint32_t)Header->Format > (uint32_t)ETextureFileFormat::BC3 || Header->Width == 0 || Header->Height == 0 ||
+		(std::max(Header->Width, Header->Height) >> (Header->LevelsCount - 1)) == 0 ||
+		File.Size < sizeof(FTextureFileHeader) + Header->LevelsCount * sizeof(FTextureFileLevel))
+	{
+		return nullptr;
+	}
+	const FTextureFileLevel* Levels = (const FTextureFileLevel*)(Header + 1);
+	for (uint32_t Level = 0; Level < Header->LevelsCount; ++Level)
+	{
+		uint32_t Width = std::max(Header->Width >> Level, 1u);
+		uint32_t Height = std::max(Header->Height >> Level, 1u);
+		if (Levels[Level].Width != Width || Levels[Level].Height != Height || Levels[Level].Size != GetTextureFileLevelSize(Header->Format, Width, Height) ||
+			Levels[Level].Size > INT32_MAX || Levels[Level].Offset > File.Size || Levels[Level].Size > File.Size - Levels[Level].Offset)
+		{
+			return nullptr;
+		}
+	}
+	return Header;
+}
+
+const FTextureFileLevel* GetTextureFileLevels(const FTextureFileHeader* Header)
+{
+	return (const FTextureFileLevel*)(Header + 1);
+}
+
+// Next level with a 2x2 box filter, the last row or column is repeated on odd sizes
+std::vector<unsigned char> DownsampleLevel(const std::vector<unsigned char> &Pixels, int Width, int Height, int Channels)
+{
+	int NextWidth = std::max(Width / 2, 1);
+	int NextHeight = std::max(Height / 2, 1);
+	std::vector<unsigned char> Next((size_t)NextWidth * NextHeight * Channels);
+	for (int y = 0; y < NextHeight; ++y)
+	{
+		int y0 = std::min(2 * y, Height - 1), y1 = std::min(2 * y + 1, Height - 1);
+		for (int x = 0; x < NextWidth; ++x)
+		{
+			int x0 = std::min(2 * x, Width - 1), x1 = std::min(2 * x + 1, Width - 1);
+			for (int c = 0; c < Channels; ++c)
+			{
+				int Sum = Pixels[((size_t)y0 * Width + x0) * Channels + c] + Pixels[((size_t)y0 * Width + x1) * Channels + c] +
+					Pixels[((size_t)y1 * Width + x0) * Channels + c] + Pixels[((size_t)y1 * Width + x1) * Channels + c];
+				Next[((size_t)y * NextWidth + x) * Channels + c] = (unsigned char)((Sum + 2) / 4);
+			}
+		}
+	}
+	return Next;
+}
+
+// 8 bytes of BC1 for 16 RGBA texels, endpoints from the bounds of the colors, always the 4 color mode
+void CompressBC1Block(const unsigned char Texels[16][4], unsigned char* Block)
+{
+	int Min[3] = { 255, 255, 255 }, Max[3] = { 0, 0, 0 };
+	for (int i = 0; i < 16; ++i)
+	{
+		for (int c = 0; c < 3; ++c)
+		{
+			Min[c] = std::min(Min[c], (int)Texels[i][c]);
+			Max[c] = std::max(Max[c], (int)Texels[i][c]);
+		}
+	}
+	auto To565 = [](const int Color[3]) { return (uint16_t)(((Color[0] >> 3) << 11) | ((Color[1] >> 2) << 5) | (Color[2] >> 3)); };
+	uint16_t Color0 = To565(Max), Color1 = To565(Min);
+
+	// The palette as the GPU expands it
+	int Palette[4][3];
+	for (int c = 0; c < 3; ++c)
+	{
+		int Bits = c == 1 ? 6 : 5, Shift = c == 0 ? 11 : c == 1 ? 5 : 0, Mask = (1 << Bits) - 1;
+		int A = ((Color0 >> Shift) & Mask) * 255 / Mask, B = ((Color1 >> Shift) & Mask) * 255 / Mask;
+		Palette[0][c] = A;
+		Palette[1][c] = B;
+		Palette[2][c] = (2 * A + B) / 3;
+		Palette[3][c] = (A + 2 * B) / 3;
+	}
+
+	uint32_t Indices = 0;
+	if (Color0 != Color1)
+	{
+		for (int i = 0; i < 16; ++i)
+		{
+			int Best = 0, BestDistance = INT32_MAX;
+			for (int p = 0; p < 4; ++p)
+			{
+				int Distance = 0;
+				for (int c = 0; c < 3; ++c)
+				{
+					Distance += (Texels[i][c] - Palette[p][c]) * (Texels[i][c] - Palette[p][c]);
+				}
+				if (Distance < BestDistance)
+				{
+					Best = p;
+					BestDistance = Distance;
+				}
+			}
+			Indices |= (uint32_t)Best << (2 * i);
+		}
+	}
+	std::memcpy(Block, &Color0, 2);
+	std::memcpy(Block + 2, &Color1, 2);
+	std::memcpy(Block + 4, &Indices, 4);
+}
+
+// 8 bytes of BC3 alpha for 16 RGBA texels, endpoints from the bounds of the alphas, the 8 alphas mode
+void CompressBC3AlphaBlock(const unsigned char Texels[16][4], unsigned char* Block)
+{
+	int Min = 255, Max = 0;
+	for (int i = 0; i < 16; ++i)
+	{
+		Min = std::min(Min, (int)Texels[i][3]);
+		Max = std::max(Max, (int)Texels[i][3]);
+	}
+	int Palette[8] = { Max, Min };
+	for (int p = 1; p < 7; ++p)
+	{
+		Palette[p + 1] = ((7 - p) * Max + p * Min) / 7;
+	}
+
+	uint64_t Indices = 0;
+	if (Max != Min)
+	{
+		for (int i = 0; i < 16; ++i)
+		{
+			int Best = 0;
+			for (int p = 1; p < 8; ++p)
+			{
+				if (std::abs(Texels[i][3] - Palette[p]) < std::abs(Texels[i][3] - Palette[Best]))
+				{
+					Best = p;
+				}
+			}
+			Indices |= (uint64_t)Best << (3 * i);
+		}
+	}
+	Block[0] = (unsigned char)Max;
+	Block[1] = (unsigned char)Min;
+	for (int Byte = 0; Byte < 6; ++Byte)
+	{
+		Block[2 + Byte] = (unsigned char)(Indices >> (8 * Byte));
+	}
+}
+
+// A level of RGBA texels in BC1 or BC3 blocks, the texels past the edges repeat the last row or column
+std::vector<unsigned char> CompressLevel(const std::vector<unsigned char> &Pixels, int Width, int Height, ETextureFileFormat Format)
+{
+	int BlockSize = Format == ETextureFileFormat::BC1 ? 8 : 16;
+	int BlocksX = (Width + 3) / 4, BlocksY = (Height + 3) / 4;
+	std::vector<unsigned char> Blocks((size_t)BlocksX * BlocksY * BlockSize);
+	unsigned char Texels[16][4];
+	for (int by = 0; by < BlocksY; ++by)
+	{
+		for (int bx = 0; bx < BlocksX; ++bx)
+		{
+			for (int i = 0; i < 16; ++i)
+			{
+				int x = std::min(bx * 4 + i % 4, Width - 1), y = std::min(by * 4 + i / 4, Height - 1);
+				std::memcpy(Texels[i], &Pixels[((size_t)y * Width + x) * 4], 4);
+			}
+			unsigned char* Block = &Blocks[((size_t)by * BlocksX + bx) * BlockSize];
+			if (Format == ETextureFileFormat::BC3)
+			{
+				CompressBC3AlphaBlock(Texels, Block);
+				Block += 8;
+			}
+			CompressBC1Block(Texels, Block);
+		}
+	}
+	return Blocks;
+}
+
+// Decodes an image stb_image reads and writes it as .gtex with its whole mip chain, in BC1 (BC3 with alpha) when
+// bCompress is set. Rows go bottom up like the textures of LoadTexture. Offline, by BakeTexture.
+bool BakeTextureFile(const char* SourcePath, const char* Path, bool bCompress)
+{
+	int Width, Height, Channels;
+	stbi_set_flip_vertically_on_load(true);
+	unsigned char* Data = stbi_load(SourcePath, &Width, &Height, &Channels, 0);
+	if (!Data)
+	{
+		return false;
+	}
+	// Blocks take RGBA, gray is spread to RGB and anything with alpha goes to BC3
+	int StoredChannels = bCompress ? 4 : Channels;
+	bool bAlpha = Channels == 2 || Channels == 4;
+	ETextureFileFormat Format = bCompress ? (bAlpha ? ETextureFileFormat::BC3 : ETextureFileFormat::BC1) : (ETextureFileFormat)(Channels - 1);
+	std::vector<unsigned char> Pixels(Data, Data + (size_t)Width * Height * Channels);
+	if (bCompress)
+	{
+		Pixels.resize((size_t)Width * Height * 4);
+		for (size_t i = 0; i < (size_t)Width * Height; ++i)
+		{
+			const unsigned char* Texel = Data + i * Channels;
+			bool bGray = Channels < 3;
+			Pixels[i * 4 + 0] = Texel[0];
+			Pixels[i * 4 + 1] = Texel[bGray ? 0 : 1];
+			Pixels[i * 4 + 2] = Texel[bGray ? 0 : 2];
+			Pixels[i * 4 + 3] = bAlpha ? Texel[Channels - 1] : 255;
+		}
+	}
+	stbi_image_free(Data);
+
+	FTextureFileHeader Header = { TextureFileMagic, TextureFileVersion, Format, (uint32_t)Width, (uint32_t)Height, 0 };
+	std::vector<FTextureFileLevel> Levels;
+	std::vector<std::vector<unsigned char>> LevelData;
+	for (int LevelWidth = Width, LevelHeight = Height;; LevelWidth = std::max(LevelWidth / 2, 1), LevelHeight = std::max(LevelHeight / 2, 1))
+	{
+		LevelData.push_back(bCompress ? CompressLevel(Pixels, LevelWidth, LevelHeight, Format) : Pixels);
+		Levels.push_back({ 0, LevelData.back().size(), (uint32_t)LevelWidth, (uint32_t)LevelHeight });
+		if (LevelWidth == 1 && LevelHeight == 1)
+		{
+			break;
+		}
+		Pixels = DownsampleLevel(Pixels, LevelWidth, LevelHeight, StoredChannels);
+	}
+	Header.LevelsCount = (uint32_t)Levels.size();
+
+	uint64_t Offset = sizeof(FTextureFileHeader) + Levels.size() * sizeof(FTextureFileLevel);
+	for (FTextureFileLevel &Level : Levels)
+	{
+		Offset = (Offset + 15) & ~15ull;
+		Level.Offset = Offset;
+		Offset += Level.Size;
+	}
+
+	std::ofstream File(Path, std::ios::binary);
+	File.write((const char*)&Header, sizeof(Header));
+	File.write((const char*)Levels.data(), Levels.size() * sizeof(FTextureFileLevel));
+	for (size_t Level = 0; Level < Levels.size(); ++Level)
+	{
+		const char Padding[16] = {};
+		File.write(Padding, (std::streamsize)(Levels[Level].Offset - (uint64_t)File.tellp()));
+		File.write((const char*)LevelData[Level].data(), LevelData[Level].size());
+	}
+	return (bool)File;
+}
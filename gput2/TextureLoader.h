@@ -0,0 +1,495 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "stb_image.h"
+#include "TextureFile.h"
+
+// GL_EXT_texture_compression_s3tc, not in the glad profile
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+enum class ETextureState
+{
+	// Waiting for or in a worker
+	Decoding,
+	// Pixels going up through the buffer ring
+	Uploading,
+	Ready,
+	Failed
+};
+
+// A texture asked to GTextureLoader, polled with GetState until it's ready
+struct FTextureHandle
+{
+	int Index;
+};
+
+// Textures loaded without stalling the render loop. Files are decoded by a pool of worker threads, then their rows are
+// copied a band at a time into a ring of pixel unpack buffers and sent with glTexSubImage2D, which returns right away.
+// A fence after each band tells when its buffer can take the next one, Update never waits for it. The mipmaps are
+// generated once the last band has arrived.
+// Baked .gtex files are mapped by the workers instead, and sent a mip level per buffer straight from the mapping.
+class GTextureLoader
+{
+public:
+	// SlotsCount buffers of SlotSize bytes, at most that much is copied per frame
+	GTextureLoader(int SlotsCount, int SlotSize);
+
+	// Starts loading the file, the handle is valid for the life of the loader
+	FTextureHandle Load(const char* Path);
+	// Takes the decoded files and the finished bands, fills the free buffers. Once per frame on the render thread.
+	void Update();
+
+	ETextureState GetState(FTextureHandle Handle) const;
+	// Whether .gtex files in BC1 and BC3 can be loaded
+	static bool IsBlockCompressionSupported();
+	// 0 until it's ready
+	unsigned int GetTexture(FTextureHandle Handle) const;
+	const std::string &GetPath(FTextureHandle Handle) const;
+	int GetCount() const;
+	// Loads not ready nor failed yet
+	int GetPendingCount() const;
+
+	void Delete();
+
+public:
+	// Bytes copied into the buffers by the last Update
+	int UploadedBytes;
+
+private:
+	struct FLoad
+	{
+		std::string Path;
+		ETextureState State;
+		unsigned int Texture;
+		int Width;
+		int Height;
+		int Channels;
+		unsigned char* Pixels;
+		// Rows sent and bands whose fence hasn't signaled yet
+		int SentRows;
+		int PendingBands;
+		// Baked levels instead of pixels, each level is a band
+		GMappedFile* File;
+		const FTextureFileHeader* Header;
+		int SentLevels;
+	};
+
+	// Decoded by a worker, waiting for the render thread
+	struct FDecoded
+	{
+		int Load;
+		int Width;
+		int Height;
+		int Channels;
+		unsigned char* Pixels;
+		GMappedFile* File;
+		const FTextureFileHeader* Header;
+	};
+
+	struct FSlot
+	{
+		unsigned int PBO;
+		GLsync Fence;
+		int Load;
+	};
+
+	void Decode();
+	void Send(FSlot &Slot, FLoad &Load);
+	void SendLevel(FSlot &Slot, FLoad &Load);
+	bool IsSent(const FLoad &Load) const;
+	void Finish(FLoad &Load);
+
+	int SlotSize;
+	std::vector<FSlot> Slots;
+	std::vector<FLoad> Loads;
+	// Loads with rows left to send, oldest first
+	std::deque<int> Uploads;
+
+	std::vector<std::thread> Workers;
+	std::mutex Mutex;
+	std::condition_variable Wake;
+	std::deque<std::pair<int, std::string>> Requests;
+	std::vector<FDecoded> Decoded;
+	bool bQuit;
+};
+
+__forceinline GTextureLoader::GTextureLoader(int SlotsCount, int InSlotSize) : UploadedBytes(0), SlotSize(InSlotSize), bQuit(false)
+{
+	for (int i = 0; i < SlotsCount; ++i)
+	{
+		FSlot Slot = { 0, 0, -1 };
+		glGenBuffers(1, &Slot.PBO);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, Slot.PBO);
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, SlotSize, NULL, GL_STREAM_DRAW);
+		Slots.push_back(Slot);
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	// Same orientation as LoadTexture, set before any worker reads it
+	stbi_set_flip_vertically_on_load(true);
+
+	int WorkersCount = glm::max(1, (int)std::thread::hardware_concurrency() - 1);
+	for (int Worker = 0; Worker < WorkersCount; ++Worker)
+	{
+		Workers.emplace_back(&GTextureLoader::Decode, this);
+	}
+}
+
+__forceinline FTextureHandle GTextureLoader::Load(const char* Path)
+{
+	int Index = (int)Loads.size();
+	Loads.push_back({ Path, ETextureState::Decoding, 0, 0, 0, 0, nullptr, 0, 0, nullptr, nullptr, 0 });
+	{
+		std::lock_guard<std::mutex> Lock(Mutex);
+		Requests.emplace_back(Index, Path);
+	}
+	Wake.notify_one();
+	return { Index };
+}
+
+__forceinline void GTextureLoader::Update()
+{
+	UploadedBytes = 0;
+
+	std::vector<FDecoded> Arrived;
+	{
+		std::lock_guard<std::mutex> Lock(Mutex);
+		Arrived.swap(Decoded);
+	}
+	for (const FDecoded &File : Arrived)
+	{
+		FLoad &Load = Loads[File.Load];
+		bool bCompressed = File.Header && File.Header->Format >= ETextureFileFormat::BC1;
+		if ((!File.Pixels && !File.Header) || (bCompressed && !IsBlockCompressionSupported()))
+		{
+			std::cout << "Failed to load texture " << Load.Path << std::endl;
+			if (File.File)
+			{
+				File.File->Close();
+				delete File.File;
+			}
+			Load.State = ETextureState::Failed;
+			continue;
+		}
+		Load.Width = File.Width;
+		Load.Height = File.Height;
+		Load.Channels = File.Channels;
+		Load.Pixels = File.Pixels;
+		Load.File = File.File;
+		Load.Header = File.Header;
+		Load.State = ETextureState::Uploading;
+		Uploads.push_back(File.Load);
+	}
+
+	for (FSlot &Slot : Slots)
+	{
+		if (Slot.Fence)
+		{
+			// Timeout 0, only asks
+			GLenum Status = glClientWaitSync(Slot.Fence, 0, 0);
+			if (Status != GL_ALREADY_SIGNALED && Status != GL_CONDITION_SATISFIED)
+			{
+				continue;
+			}
+			glDeleteSync(Slot.Fence);
+			Slot.Fence = 0;
+
+			FLoad &Load = Loads[Slot.Load];
+			if (--Load.PendingBands == 0 && IsSent(Load))
+			{
+				Finish(Load);
+			}
+		}
+		if (!Uploads.empty())
+		{
+			FLoad &Load = Loads[Uploads.front()];
+			Slot.Load = Uploads.front();
+			if (Load.File)
+			{
+				SendLevel(Slot, Load);
+			}
+			else
+			{
+				Send(Slot, Load);
+			}
+			if (IsSent(Load))
+			{
+				Uploads.pop_front();
+			}
+		}
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+__forceinline ETextureState GTextureLoader::GetState(FTextureHandle Handle) const
+{
+	return Loads[Handle.Index].State;
+}
+
+__forceinline bool GTextureLoader::IsBlockCompressionSupported()
+{
+	static int Supported = -1;
+	if (Supported < 0)
+	{
+		int ExtensionsCount = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &ExtensionsCount);
+		Supported = 0;
+		for (int i = 0; i < ExtensionsCount; ++i)
+		{
+			if (strcmp((const char*)glGetStringi(GL_EXTENSIONS, i), "GL_EXT_texture_compression_s3tc") == 0)
+			{
+				Supported = 1;
+			}
+		}
+	}
+	return Supported != 0;
+}
+
+__forceinline unsigned int GTextureLoader::GetTexture(FTextureHandle Handle) const
+{
+	return Loads[Handle.Index].State == ETextureState::Ready ? Loads[Handle.Index].Texture : 0;
+}
+
+__forceinline const std::string &GTextureLoader::GetPath(FTextureHandle Handle) const
+{
+	return Loads[Handle.Index].Path;
+}
+
+__forceinline int GTextureLoader::GetCount() const
+{
+	return (int)Loads.size();
+}
+
+__forceinline int GTextureLoader::GetPendingCount() const
+{
+	int Pending = 0;
+	for (const FLoad &Load : Loads)
+	{
+		Pending += Load.State == ETextureState::Decoding || Load.State == ETextureState::Uploading;
+	}
+	return Pending;
+}
+
+__forceinline void GTextureLoader::Delete()
+{
+	{
+		std::lock_guard<std::mutex> Lock(Mutex);
+		bQuit = true;
+	}
+	Wake.notify_all();
+	for (std::thread &Worker : Workers)
+	{
+		Worker.join();
+	}
+	Workers.clear();
+
+	for (const FDecoded &File : Decoded)
+	{
+		stbi_image_free(File.Pixels);
+		if (File.File)
+		{
+			File.File->Close();
+			delete File.File;
+		}
+	}
+	for (FLoad &Load : Loads)
+	{
+		stbi_image_free(Load.Pixels);
+		if (Load.File)
+		{
+			Load.File->Close();
+			delete Load.File;
+		}
+		glDeleteTextures(1, &Load.Texture);
+	}
+	for (FSlot &Slot : Slots)
+	{
+		if (Slot.Fence)
+		{
+			glDeleteSync(Slot.Fence);
+		}
+		glDeleteBuffers(1, &Slot.PBO);
+	}
+}
+
+__forceinline void GTextureLoader::Decode()
+{
+	while (true)
+	{
+		std::pair<int, std::string> Request;
+		{
+			std::unique_lock<std::mutex> Lock(Mutex);
+			Wake.wait(Lock, [this]() { return bQuit || !Requests.empty(); });
+			if (bQuit)
+			{
+				return;
+			}
+			Request = std::move(Requests.front());
+			Requests.pop_front();
+		}
+
+		FDecoded File = { Request.first, 0, 0, 0, nullptr, nullptr, nullptr };
+		const std::string &Path = Request.second;
+		if (Path.size() > 5 && Path.compare(Path.size() - 5, 5, ".gtex") == 0)
+		{
+			// Nothing to decode, the pages are read while the levels are copied
+			File.File = new GMappedFile();
+			File.Header = File.File->Open(Path.c_str()) ? GetTextureFileHeader(*File.File) : nullptr;
+			if (File.Header)
+			{
+				File.Width = (int)File.Header->Width;
+				File.Height = (int)File.Header->Height;
+			}
+			else
+			{
+				File.File->Close();
+				delete File.File;
+				File.File = nullptr;
+			}
+		}
+		else
+		{
+			File.Pixels = stbi_load(Path.c_str(), &File.Width, &File.Height, &File.Channels, 0);
+		}
+
+		std::lock_guard<std::mutex> Lock(Mutex);
+		Decoded.push_back(File);
+	}
+}
+
+__forceinline void GTextureLoader::Send(FSlot &Slot, FLoad &Load)
+{
+	const GLenum Formats[] = { GL_RED, GL_RG, GL_RGB, GL_RGBA };
+	GLenum Format = Formats[Load.Channels - 1];
+	if (Load.Texture == 0)
+	{
+		glGenTextures(1, &Load.Texture);
+		glBindTexture(GL_TEXTURE_2D, Load.Texture);
+		// NULL is an offset into the bound unpack buffer otherwise
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		glTexImage2D(GL_TEXTURE_2D, 0, Format, Load.Width, Load.Height, 0, Format, GL_UNSIGNED_BYTE, NULL);
+	}
+
+	// Whole rows, at least one even when a row doesn't fit the slot
+	int RowSize = Load.Width * Load.Channels;
+	int Rows = glm::min(glm::max(SlotSize / RowSize, 1), Load.Height - Load.SentRows);
+	int Size = Rows * RowSize;
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, Slot.PBO);
+	if (Size > SlotSize)
+	{
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, Size, NULL, GL_STREAM_DRAW);
+	}
+	// The fence has signaled, nothing reads this buffer anymore
+	void* Buffer = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, Size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+	std::memcpy(Buffer, Load.Pixels + (size_t)Load.SentRows * RowSize, Size);
+	glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+	glBindTexture(GL_TEXTURE_2D, Load.Texture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, Load.SentRows, Load.Width, Rows, Format, GL_UNSIGNED_BYTE, (void*)0);
+	Slot.Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	Load.SentRows += Rows;
+	++Load.PendingBands;
+	UploadedBytes += Size;
+}
+
+__forceinline void GTextureLoader::SendLevel(FSlot &Slot, FLoad &Load)
+{
+	const GLenum Formats[] = { GL_RED, GL_RG, GL_RGB, GL_RGBA, GL_COMPRESSED_RGB_S3TC_DXT1_EXT, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT };
+	const GLenum InternalFormats[] = { GL_R8, GL_RG8, GL_RGB8, GL_RGBA8, GL_COMPRESSED_RGB_S3TC_DXT1_EXT, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT };
+	const FTextureFileHeader* Header = Load.Header;
+	const FTextureFileLevel* Levels = GetTextureFileLevels(Header);
+	GLenum Format = Formats[(int)Header->Format];
+	bool bCompressed = Header->Format >= ETextureFileFormat::BC1;
+	if (Load.Texture == 0)
+	{
+		// Every level up front, the texture is complete with the levels of the file only
+		glGenTextures(1, &Load.Texture);
+		glBindTexture(GL_TEXTURE_2D, Load.Texture);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		for (int Level = 0; Level < (int)Header->LevelsCount; ++Level)
+		{
+			if (bCompressed)
+			{
+				glCompressedTexImage2D(GL_TEXTURE_2D, Level, Format, Levels[Level].Width, Levels[Level].Height, 0, (GLsizei)Levels[Level].Size, NULL);
+			}
+			else
+			{
+				glTexImage2D(GL_TEXTURE_2D, Level, InternalFormats[(int)Header->Format], Levels[Level].Width, Levels[Level].Height, 0, Format, GL_UNSIGNED_BYTE, NULL);
+			}
+		}
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, Header->LevelsCount - 1);
+	}
+
+	const FTextureFileLevel &Level = Levels[Load.SentLevels];
+	int Size = (int)Level.Size;
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, Slot.PBO);
+	if (Size > SlotSize)
+	{
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, Size, NULL, GL_STREAM_DRAW);
+	}
+	void* Buffer = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, Size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+	std::memcpy(Buffer, Load.File->Data + Level.Offset, Size);
+	glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+	glBindTexture(GL_TEXTURE_2D, Load.Texture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	if (bCompressed)
+	{
+		glCompressedTexSubImage2D(GL_TEXTURE_2D, Load.SentLevels, 0, 0, Level.Width, Level.Height, Format, Size, (void*)0);
+	}
+	else
+	{
+		glTexSubImage2D(GL_TEXTURE_2D, Load.SentLevels, 0, 0, Level.Width, Level.Height, Format, GL_UNSIGNED_BYTE, (void*)0);
+	}
+	Slot.Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	++Load.SentLevels;
+	++Load.PendingBands;
+	UploadedBytes += Size;
+}
+
+__forceinline bool GTextureLoader::IsSent(const FLoad &Load) const
+{
+	return Load.File ? Load.SentLevels == (int)Load.Header->LevelsCount : Load.SentRows == Load.Height;
+}
+
+__forceinline void GTextureLoader::Finish(FLoad &Load)
+{
+	glBindTexture(GL_TEXTURE_2D, Load.Texture);
+	if (Load.File)
+	{
+		Load.File->Close();
+		delete Load.File;
+		Load.File = nullptr;
+		Load.Header = nullptr;
+	}
+	else
+	{
+		stbi_image_free(Load.Pixels);
+		Load.Pixels = nullptr;
+		glGenerateMipmap(GL_TEXTURE_2D);
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	Load.State = ETextureState::Ready;
+}
@@ -0,0 +1,34 @@
+// Offline converter to .gtex, the mip chain baked so GTextureLoader maps and uploads it without decoding.
+// Stand-alone, outside gput2.vcxproj:
+//     cl /std:c++17 /O2 /EHsc BakeTexture.cpp
+//     g++ -std=c++17 -O2 BakeTexture.cpp -o BakeTexture
+// Usage: BakeTexture [-bc] Source.png Texture.gtex
+//     -bc  BC1 blocks, BC3 when the image has alpha. Needs GL_EXT_texture_compression_s3tc to load.
+#ifndef _MSC_VER
+#define __forceinline inline
+#endif
+
+#define STB_IMAGE_IMPLEMENTATION
+
+#include <cstring>
+#include <iostream>
+
+#include "../TextureFile.h"
+
+int main(int ArgumentsCount, char** Arguments)
+{
+	bool bCompress = ArgumentsCount == 4 && std::strcmp(Arguments[1], "-bc") == 0;
+	if (ArgumentsCount != (bCompress ? 4 : 3))
+	{
+		std::cout << "Usage: BakeTexture [-bc] Source.png Texture.gtex" << std::endl;
+		return 1;
+	}
+	const char* SourcePath = Arguments[ArgumentsCount - 2];
+	const char* Path = Arguments[ArgumentsCount - 1];
+	if (!BakeTextureFile(SourcePath, Path, bCompress))
+	{
+		std::cout << "ERROR::TEXTURE::BAKE_FAILED " << SourcePath << std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,185 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstring>
+#include <vector>
+
+#include "Shader.h"
+
+// Binding points of the uniform blocks shared by every program, each one matches the block of the same name in the shaders
+enum class EUniformBlock
+{
+	// UCamera
+	Camera,
+	// ULights
+	Lights,
+	// UClusters
+	Clusters,
+	// UShadows
+	Shadows,
+
+	Count
+};
+
+const char* const UniformBlockNames[] = { "UCamera", "ULights", "UClusters", "UShadows" };
+
+// POINT_LIGHTS in Terrain.frag
+const int PointLightsCount = 1;
+// SHADOW_CASCADES in Terrain.frag
+const int ShadowCascadesMax = 4;
+
+// std140 layouts of the blocks, every vec3 and struct starts at a multiple of 16 bytes
+struct FCameraBlock
+{
+	glm::mat4 Projection;
+	glm::mat4 View;
+	glm::vec3 ViewPosition;
+	float Padding;
+};
+
+struct FLightBlock
+{
+	glm::vec3 Ambient;
+	float Padding0;
+	glm::vec3 Diffuse;
+	float Padding1;
+	glm::vec3 Specular;
+	float Padding2;
+};
+
+struct FDirectionalLightBlock
+{
+	glm::vec3 Direction;
+	float Padding;
+	FLightBlock Light;
+};
+
+struct FPointLightBlock
+{
+	glm::vec3 Position;
+	float Constant;
+	float Linear;
+	float Quadratic;
+	float Padding[2];
+	FLightBlock Light;
+};
+
+struct FSpotLightBlock
+{
+	glm::vec3 Position;
+	float Padding;
+	glm::vec3 Direction;
+	float Constant;
+	float Linear;
+	float Quadratic;
+	float CutOff;
+	float OuterCutOff;
+	FLightBlock Light;
+};
+
+struct FLightsBlock
+{
+	FDirectionalLightBlock DirectionalLight;
+	FPointLightBlock PointLights[PointLightsCount];
+	FSpotLightBlock SpotLight;
+};
+
+// Froxel grid of GClusteredLights
+struct FClustersBlock
+{
+	// Tiles across, tiles up, depth slices and lights
+	glm::ivec4 Grid;
+	// Slice of a view depth d is log(d) * x + y, tile of a pixel is its coordinates times zw
+	glm::vec4 Mapping;
+};
+
+// Cascades of GShadowCascades
+struct FShadowsBlock
+{
+	// Clip space of each cascade from world space
+	glm::mat4 LightSpace[ShadowCascadesMax];
+	// View depth where each cascade ends
+	glm::vec4 Splits;
+	// World size of a texel of each cascade
+	glm::vec4 TexelSizes;
+	// Cascades, 0 without them, the size of a texel in texture coordinates, and the step budget of the heightfield march,
+	// 0 without it
+	glm::vec4 Params;
+	// Texture coordinates of the height map per world unit, world height per fbm unit, top level of GHeightMaxPyramid and its
+	// texels per side
+	glm::vec4 Heightfield;
+};
+
+static_assert(sizeof(FCameraBlock) == 144, "UCamera doesn't match its std140 layout");
+static_assert(sizeof(FLightsBlock) == 64 + 80 * PointLightsCount + 96, "ULights doesn't match its std140 layout");
+static_assert(sizeof(FClustersBlock) == 32, "UClusters doesn't match its std140 layout");
+static_assert(sizeof(FShadowsBlock) == 64 * ShadowCascadesMax + 64, "UShadows doesn't match its std140 layout");
+
+// Uniform buffer bound to its binding point for good, the data is sent only when it differs from the last upload
+class GUniformBlock
+{
+public:
+	GUniformBlock(EUniformBlock Binding, int Size);
+
+	// Returns true when Data was sent, with a single glBufferSubData
+	bool Update(const void* Data);
+	void Delete();
+
+public:
+	unsigned int UBO;
+
+	// glBufferSubData calls and bytes sent by every block
+	static int Uploads;
+	static int UploadedBytes;
+
+private:
+	std::vector<char> Uploaded;
+	bool bValid;
+};
+
+int GUniformBlock::Uploads = 0;
+int GUniformBlock::UploadedBytes = 0;
+
+__forceinline GUniformBlock::GUniformBlock(EUniformBlock Binding, int Size) : Uploaded(Size), bValid(false)
+{
+	glGenBuffers(1, &UBO);
+	glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+	glBufferData(GL_UNIFORM_BUFFER, Size, NULL, GL_DYNAMIC_DRAW);
+	glBindBufferBase(GL_UNIFORM_BUFFER, (GLuint)Binding, UBO);
+}
+
+__forceinline bool GUniformBlock::Update(const void* Data)
+{
+	if (bValid && std::memcmp(Uploaded.data(), Data, Uploaded.size()) == 0)
+	{
+		return false;
+	}
+	std::memcpy(Uploaded.data(), Data, Uploaded.size());
+	bValid = true;
+
+	glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, Uploaded.size(), Uploaded.data());
+	++Uploads;
+	UploadedBytes += (int)Uploaded.size();
+	return true;
+}
+
+__forceinline void GUniformBlock::Delete()
+{
+	glDeleteBuffers(1, &UBO);
+}
+
+// Points the shared blocks the program reads to their binding points, once after linking
+void BindUniformBlocks(const GShader &Shader)
+{
+	for (int Block = 0; Block < (int)EUniformBlock::Count; ++Block)
+	{
+		unsigned int Index = glGetUniformBlockIndex(Shader.Id, UniformBlockNames[Block]);
+		if (Index != GL_INVALID_INDEX)
+		{
+			glUniformBlockBinding(Shader.Id, Index, (GLuint)Block);
+		}
+	}
+}
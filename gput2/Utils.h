@@ -4,31 +4,42 @@
 
 #include <cmath>
 
+#include <algorithm>
 #include <iostream>
+#include <string>
 #include <vector>
 
 #include "stb_image.h"
 
-char* FileToChar(const char *FilePath)
+// Whole file into Contents, returns false when it can't be opened
+bool FileToString(const char *FilePath, std::string &Contents)
 {
 	FILE *File;
-	long Length;
-	char *Buffer;
-
-	fopen_s(&File, FilePath, "rb"); /* Open file for reading */
-	if (!File) /* Display error on failure */
+	if (fopen_s(&File, FilePath, "rb") != 0 || !File) /* Open file for reading */
 	{
-		std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
+		std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ " << FilePath << std::endl;
+		return false;
 	}
 	fseek(File, 0, SEEK_END); /* Seek to the end of the file */
-	Length = ftell(File); /* Find out how many bytes into the file we are */
-	Buffer = (char*)malloc(Length + 1); /* Allocate a buffer for the entire length of the file and a null terminator */
+	long Length = ftell(File); /* Find out how many bytes into the file we are */
 	fseek(File, 0, SEEK_SET); /* Go back to the beginning of the file */
-	fread(Buffer, Length, 1, File); /* Read the contents of the file in to the buffer */
+	Contents.resize(Length > 0 ? Length : 0);
+	size_t Read = Contents.empty() ? 0 : fread(&Contents[0], 1, Contents.size(), File); /* Read the contents of the file in to the string */
 	fclose(File); /* Close the file */
-	Buffer[Length] = 0; /* Null terminator */
+	Contents.resize(Read);
 
-	return Buffer;
+	return true;
+}
+
+// 64-bit FNV-1a, chain calls through Hash to cover several buffers
+unsigned long long HashBytes(const void* Data, size_t Size, unsigned long long Hash = 14695981039346656037ull)
+{
+	const unsigned char* Bytes = (const unsigned char*)Data;
+	for (size_t i = 0; i < Size; ++i)
+	{
+		Hash = (Hash ^ Bytes[i]) * 1099511628211ull;
+	}
+	return Hash;
 }
 
 unsigned int LoadTexture(const char* TexturePath)
@@ -348,13 +359,20 @@ void GenerateSphere(float* &Sphere, int* &SphereIndices, int Segments, int Rings
 	}
 }
 
-void GenerateGrid(float* &Grid, int* &GridIndices, int Vertices, float Range, int& GridSize, int& GridIndicesSize, float& SeparationFactor)
+// Distance between the vertices of GenerateGrid
+float GetGridSeparationFactor(int Vertices, float Range)
+{
+	return Range / (2 * Vertices + 1);
+}
+
+// With TileCells the indices are stored tile by tile, each tile of TileCells x TileCells cells is a contiguous range
+void GenerateGrid(float* &Grid, int* &GridIndices, int Vertices, float Range, int& GridSize, int& GridIndicesSize, float& SeparationFactor, int TileCells = 0)
 {
 	int Size = 2 * Vertices + 1;
 	GridSize = 2 * (int)glm::pow(Size, 2);
 	Grid = new float[GridSize];
 
-	SeparationFactor = Range / Size;
+	SeparationFactor = GetGridSeparationFactor(Vertices, Range);
 
 	for (int i = 0; i < Size; ++i)
 	{
@@ -367,12 +385,247 @@ void GenerateGrid(float* &Grid, int* &GridIndices, int Vertices, float Range, in
 	GridIndicesSize = 6 * (int)glm::pow(Size - 1, 2);
 	GridIndices = new int[GridIndicesSize];
 
-	for (int i = 0; i < Size - 1; ++i)
+	int Cells = Size - 1;
+	int Tile = TileCells > 0 ? TileCells : Cells;
+	int Index = 0;
+	for (int TileI = 0; TileI < Cells; TileI += Tile)
+	{
+		for (int TileJ = 0; TileJ < Cells; TileJ += Tile)
+		{
+			for (int i = TileI; i < glm::min(TileI + Tile, Cells); ++i)
+			{
+				for (int j = TileJ; j < glm::min(TileJ + Tile, Cells); ++j)
+				{
+					InsertIndex(GridIndices, Index, i * Size + j, (i + 1) * Size + j, i * Size + 1 + j);
+					InsertIndex(GridIndices, Index + 3, i * Size + 1 + j, (i + 1) * Size + j, (i + 1) * Size + 1 + j);
+					Index += 6;
+				}
+			}
+		}
+	}
+}
+
+// Patch of Quads x Quads cells covering [0, 1]^2. Indices are grouped by quadrant (x then y halves),
+// so each quarter can be drawn on its own with a quarter of the indices.
+void GeneratePatch(float* &Patch, int* &PatchIndices, int Quads, int& PatchSize, int& PatchIndicesSize)
+{
+	int Size = Quads + 1;
+	PatchSize = 2 * Size * Size;
+	Patch = new float[PatchSize];
+
+	for (int i = 0; i < Size; ++i)
+	{
+		for (int j = 0; j < Size; ++j)
+		{
+			InsertVertex2D(Patch, 2 * (i * Size + j), (float)j / (float)Quads, (float)i / (float)Quads);
+		}
+	}
+
+	PatchIndicesSize = 6 * Quads * Quads;
+	PatchIndices = new int[PatchIndicesSize];
+
+	int Half = Quads / 2;
+	int Index = 0;
+	for (int Quadrant = 0; Quadrant < 4; ++Quadrant)
+	{
+		int FirstI = (Quadrant / 2) * Half;
+		int FirstJ = (Quadrant % 2) * Half;
+		for (int i = FirstI; i < FirstI + Half; ++i)
+		{
+			for (int j = FirstJ; j < FirstJ + Half; ++j)
+			{
+				InsertIndex(PatchIndices, Index, i * Size + j, (i + 1) * Size + j, i * Size + 1 + j);
+				InsertIndex(PatchIndices, Index + 3, i * Size + 1 + j, (i + 1) * Size + j, (i + 1) * Size + 1 + j);
+				Index += 6;
+			}
+		}
+	}
+}
+
+// Post-transform vertex cache behaviour of an index list
+struct FVertexCacheStats
+{
+	// Vertices shaded per triangle, 3 without any reuse and about 0.5 at best for a regular grid
+	float ACMR;
+	// Vertices shaded per vertex, 1 at best
+	float ATVR;
+};
+
+// Simulates a FIFO cache of CacheSize vertices
+FVertexCacheStats GetVertexCacheStats(const int* Indices, int IndicesSize, int VerticesCount, int CacheSize = 32)
+{
+	std::vector<int> LastMiss(VerticesCount, -CacheSize - 1);
+	int Misses = 0;
+	for (int i = 0; i < IndicesSize; ++i)
+	{
+		// A vertex is still cached while fewer than CacheSize misses happened after its own
+		if (Misses - LastMiss[Indices[i]] > CacheSize)
+		{
+			LastMiss[Indices[i]] = Misses;
+			++Misses;
+		}
+	}
+	return { (float)Misses / (IndicesSize / 3), (float)Misses / VerticesCount };
+}
+
+float GetVertexCacheScore(int CachePosition, int RemainingTriangles, int CacheSize)
+{
+	if (RemainingTriangles == 0)
+	{
+		return -1.f;
+	}
+
+	float Score = 0.f;
+	if (CachePosition >= 0)
+	{
+		// The last triangle's vertices score a bit lower, so the next triangle doesn't just go back and forth
+		Score = CachePosition < 3 ? 0.75f : (float)glm::pow(1.f - (float)(CachePosition - 3) / (CacheSize - 3), 1.5f);
+	}
+	// Vertices with few triangles left are finished first, so they don't come back into the cache later
+	return Score + 2.f * (float)glm::pow((float)RemainingTriangles, -0.5f);
+}
+
+// Reorders the triangles of an index list for the post-transform vertex cache, greedily picking the triangle whose vertices
+// score best by their position in a simulated LRU cache and their triangles left (Tom Forsyth, Linear-Speed Vertex Cache
+// Optimisation). Vertices and the winding of each triangle stay the same. Every generator output can go through it.
+void OptimizeVertexCache(int* Indices, int IndicesSize, int VerticesCount, int CacheSize = 32)
+{
+	int TrianglesCount = IndicesSize / 3;
+
+	// Triangles of each vertex
+	std::vector<int> Remaining(VerticesCount, 0);
+	for (int i = 0; i < IndicesSize; ++i)
+	{
+		++Remaining[Indices[i]];
+	}
+	std::vector<int> FirstTriangle(VerticesCount + 1, 0);
+	for (int Vertex = 0; Vertex < VerticesCount; ++Vertex)
+	{
+		FirstTriangle[Vertex + 1] = FirstTriangle[Vertex] + Remaining[Vertex];
+	}
+	std::vector<int> VertexTriangles(IndicesSize);
+	std::vector<int> Filled(FirstTriangle.begin(), FirstTriangle.end() - 1);
+	for (int i = 0; i < IndicesSize; ++i)
+	{
+		VertexTriangles[Filled[Indices[i]]++] = i / 3;
+	}
+
+	std::vector<float> VertexScores(VerticesCount);
+	for (int Vertex = 0; Vertex < VerticesCount; ++Vertex)
+	{
+		VertexScores[Vertex] = GetVertexCacheScore(-1, Remaining[Vertex], CacheSize);
+	}
+	std::vector<float> TriangleScores(TrianglesCount);
+	std::vector<char> bEmitted(TrianglesCount, 0);
+	int BestTriangle = 0;
+	for (int Triangle = 0; Triangle < TrianglesCount; ++Triangle)
 	{
-		for (int j = 0; j < Size - 1; ++j)
+		TriangleScores[Triangle] = VertexScores[Indices[3 * Triangle]] + VertexScores[Indices[3 * Triangle + 1]] + VertexScores[Indices[3 * Triangle + 2]];
+		if (TriangleScores[Triangle] > TriangleScores[BestTriangle])
 		{
-			InsertIndex(GridIndices, 6 * (i * (Size - 1) + j), i * Size + j, (i + 1) * Size + j, i * Size + 1 + j);
-			InsertIndex(GridIndices, 6 * (i * (Size - 1) + j) + 3, i * Size + 1 + j, (i + 1) * Size + j, (i + 1) * Size + 1 + j);
+			BestTriangle = Triangle;
 		}
 	}
+
+	std::vector<int> Output;
+	Output.reserve(IndicesSize);
+	std::vector<int> Cache, NextCache;
+	int NextUnemitted = 0;
+	while ((int)Output.size() < IndicesSize)
+	{
+		bEmitted[BestTriangle] = 1;
+		NextCache.clear();
+		for (int Corner = 0; Corner < 3; ++Corner)
+		{
+			int Vertex = Indices[3 * BestTriangle + Corner];
+			Output.push_back(Vertex);
+			--Remaining[Vertex];
+			NextCache.push_back(Vertex);
+		}
+		for (int Vertex : Cache)
+		{
+			if (Vertex != NextCache[0] && Vertex != NextCache[1] && Vertex != NextCache[2])
+			{
+				NextCache.push_back(Vertex);
+			}
+		}
+
+		// Vertices pushed out of the cache lose their cache score
+		for (size_t Position = CacheSize; Position < NextCache.size(); ++Position)
+		{
+			int Vertex = NextCache[Position];
+			VertexScores[Vertex] = GetVertexCacheScore(-1, Remaining[Vertex], CacheSize);
+			for (int t = FirstTriangle[Vertex]; t < FirstTriangle[Vertex + 1]; ++t)
+			{
+				int Triangle = VertexTriangles[t];
+				TriangleScores[Triangle] = VertexScores[Indices[3 * Triangle]] + VertexScores[Indices[3 * Triangle + 1]] + VertexScores[Indices[3 * Triangle + 2]];
+			}
+		}
+		if ((int)NextCache.size() > CacheSize)
+		{
+			NextCache.resize(CacheSize);
+		}
+		Cache.swap(NextCache);
+
+		// Only the triangles of cached vertices changed, the best one is among them
+		float BestScore = -1.f;
+		BestTriangle = -1;
+		for (int Position = 0; Position < (int)Cache.size(); ++Position)
+		{
+			int Vertex = Cache[Position];
+			VertexScores[Vertex] = GetVertexCacheScore(Position, Remaining[Vertex], CacheSize);
+		}
+		for (int Vertex : Cache)
+		{
+			for (int t = FirstTriangle[Vertex]; t < FirstTriangle[Vertex + 1]; ++t)
+			{
+				int Triangle = VertexTriangles[t];
+				if (bEmitted[Triangle])
+				{
+					continue;
+				}
+				TriangleScores[Triangle] = VertexScores[Indices[3 * Triangle]] + VertexScores[Indices[3 * Triangle + 1]] + VertexScores[Indices[3 * Triangle + 2]];
+				if (TriangleScores[Triangle] > BestScore)
+				{
+					BestScore = TriangleScores[Triangle];
+					BestTriangle = Triangle;
+				}
+			}
+		}
+
+		// Nothing left around the cache, carry on from the first triangle not emitted
+		if (BestTriangle < 0)
+		{
+			while (NextUnemitted < TrianglesCount && bEmitted[NextUnemitted])
+			{
+				++NextUnemitted;
+			}
+			if (NextUnemitted == TrianglesCount)
+			{
+				break;
+			}
+			BestTriangle = NextUnemitted;
+		}
+	}
+
+	std::copy(Output.begin(), Output.end(), Indices);
+}
+
+// Cache behaviour of a generated mesh as generated and after OptimizeVertexCache
+struct FMeshCacheReport
+{
+	const char* Name;
+	FVertexCacheStats Before;
+	FVertexCacheStats After;
+};
+
+// Optimizes Indices in place
+FMeshCacheReport GetMeshCacheReport(const char* Name, int* Indices, int IndicesSize, int VerticesCount)
+{
+	FMeshCacheReport Report;
+	Report.Name = Name;
+	Report.Before = GetVertexCacheStats(Indices, IndicesSize, VerticesCount);
+	OptimizeVertexCache(Indices, IndicesSize, VerticesCount);
+	Report.After = GetVertexCacheStats(Indices, IndicesSize, VerticesCount);
+	return Report;
 }
\ No newline at end of file
@@ -2,18 +2,12 @@
 // Microsoft Visual C++ generated include file.
 // Used by Resource.rc
 //
-#define ArrowFrag                       108
-#define ArrowVert                       109
-#define PointLightVert                  111
-#define TerrainFrag                     112
-#define TerrainVert                     113
-#define PointLightFrag                  116
 
 // Next default values for new objects
 // 
 #ifdef APSTUDIO_INVOKED
 #ifndef APSTUDIO_READONLY_SYMBOLS
-#define _APS_NEXT_RESOURCE_VALUE        119
+#define _APS_NEXT_RESOURCE_VALUE        120
 #define _APS_NEXT_COMMAND_VALUE         40001
 #define _APS_NEXT_CONTROL_VALUE         1001
 #define _APS_NEXT_SYMED_VALUE           101